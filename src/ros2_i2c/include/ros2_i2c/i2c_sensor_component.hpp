@@ -0,0 +1,97 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2C__I2C_SENSOR_COMPONENT_HPP_
+#define ROS2_I2C__I2C_SENSOR_COMPONENT_HPP_
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include <rclcpp/rclcpp.hpp>
+
+#include "ros2_i2c/msg/register_sample.hpp"
+#include "ros2_i2ccpp/constants.hpp"
+#include "ros2_i2ccpp/i2c_handler.hpp"
+
+namespace ros2_i2c
+{
+
+/**
+ * Composable node that reads a register of an I2C device and publishes the raw bytes.
+ *
+ * The register is read on a timer, or only once the device reports new data through a status
+ * register (data_ready_register/data_ready_mask). The transfer reads straight into the outgoing
+ * message, which is loaned from the middleware when possible or handed over as a unique_ptr, so
+ * subscribers in the same container receive it without serialization or copies (enable
+ * use_intra_process_comms when loading the component).
+ *
+ * Parameters:
+ *   adapter_path (string, "/dev/i2c-1"), device_address (int), register_address (int),
+ *   read_size (int, up to 32 bytes), offset_width (int, 8 or 16 bits, sent big endian),
+ *   period_ms (double, 10.0), data_ready_register (int, -1 to disable), data_ready_mask (int),
+ *   latency_report_period_s (double, 5.0, 0 to disable)
+ */
+class I2CSensorComponent : public rclcpp::Node
+{
+public:
+  explicit I2CSensorComponent(const rclcpp::NodeOptions & options);
+
+private:
+  using SampleMsg = msg::RegisterSample;
+
+  void on_timer();
+
+  /**
+   * Check the status register, if configured.
+   */
+  bool is_data_ready();
+
+  /**
+   * Read the register into the message, returns false if the transfer failed.
+   */
+  bool acquire(SampleMsg & message);
+
+  [[nodiscard]] std::chrono::nanoseconds elapsed_since_acquisition() const;
+
+  /**
+   * Account the time from the end of the transfer until publish returned.
+   */
+  void record_latency(std::chrono::nanoseconds latency);
+
+  void report_latency();
+
+  std::unique_ptr<ros2_i2ccpp::ThreadUnsafeI2CHandler> handler;
+  rclcpp::Publisher<SampleMsg>::SharedPtr publisher;
+  rclcpp::TimerBase::SharedPtr timer;
+
+  uint16_t device_address{0};
+  uint16_t register_address{0};
+  uint8_t read_size{0};
+  ros2_i2ccpp::I2CRegisterOffsetFormat offset_format{
+    ros2_i2ccpp::I2CRegisterOffsetFormat::OFFSET_8BIT};
+
+  bool use_data_ready{false};
+  uint16_t data_ready_register{0};
+  uint8_t data_ready_mask{0};
+
+  uint32_t sequence{0};
+
+  // end of the last transfer, on the steady clock
+  std::chrono::steady_clock::time_point acquisition_time;
+
+  // latency since the last report
+  std::chrono::nanoseconds report_period{0};
+  std::chrono::steady_clock::time_point last_report;
+  std::chrono::nanoseconds latency_min{std::chrono::nanoseconds::max()};
+  std::chrono::nanoseconds latency_max{0};
+  std::chrono::nanoseconds latency_sum{0};
+  uint64_t latency_count{0};
+};
+
+}  // namespace ros2_i2c
+
+#endif  // ROS2_I2C__I2C_SENSOR_COMPONENT_HPP_
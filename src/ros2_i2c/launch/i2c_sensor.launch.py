@@ -0,0 +1,33 @@
+# Copyright (c) 2024 jncfa
+#
+# This software is released under the MIT License.
+# https://opensource.org/licenses/MIT
+
+from launch import LaunchDescription
+from launch_ros.actions import ComposableNodeContainer
+from launch_ros.descriptions import ComposableNode
+
+
+def generate_launch_description():
+    # consumers of the samples should be loaded in the same container to receive them without copies
+    sensor = ComposableNode(
+        package='ros2_i2c',
+        plugin='ros2_i2c::I2CSensorComponent',
+        name='i2c_sensor',
+        parameters=[{
+            'adapter_path': '/dev/i2c-1',
+            'device_address': 0x68,
+            'register_address': 0x3B,
+            'read_size': 14,
+            'period_ms': 10.0,
+        }],
+        extra_arguments=[{'use_intra_process_comms': True}])
+
+    container = ComposableNodeContainer(
+        name='i2c_container',
+        namespace='',
+        package='rclcpp_components',
+        executable='component_container',
+        composable_node_descriptions=[sensor])
+
+    return LaunchDescription([container])
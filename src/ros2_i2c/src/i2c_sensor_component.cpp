@@ -0,0 +1,197 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <rclcpp_components/register_node_macro.hpp>
+
+#include "ros2_i2c/i2c_sensor_component.hpp"
+#include "ros2_i2ccpp/exceptions.hpp"
+#include "ros2_i2ccpp/inline_transaction.hpp"
+#include "ros2_i2ccpp/register_offset.hpp"
+
+namespace ros2_i2c
+{
+
+using namespace ros2_i2ccpp;
+
+namespace
+{
+constexpr std::size_t MAX_READ_SIZE = std::tuple_size_v<msg::RegisterSample::_data_type>;
+
+// a register read needs its offset write and the read itself
+using SampleTransaction = I2CInlineTransaction<I2C_REGISTER_OFFSET_MAX_SIZE>;
+}  // namespace
+
+I2CSensorComponent::I2CSensorComponent(const rclcpp::NodeOptions & options)
+: rclcpp::Node("i2c_sensor", options)
+{
+  const auto adapter_path = declare_parameter<std::string>("adapter_path", "/dev/i2c-1");
+  const auto device_address_param = declare_parameter<int64_t>("device_address", 0);
+  const auto register_address_param = declare_parameter<int64_t>("register_address", 0);
+  const auto read_size_param = declare_parameter<int64_t>("read_size", 1);
+  const auto offset_width = declare_parameter<int64_t>("offset_width", 8);
+  const auto period_ms = declare_parameter<double>("period_ms", 10.0);
+  const auto data_ready_register_param = declare_parameter<int64_t>("data_ready_register", -1);
+  const auto data_ready_mask_param = declare_parameter<int64_t>("data_ready_mask", 0x01);
+  const auto report_period_s = declare_parameter<double>("latency_report_period_s", 5.0);
+
+  if (device_address_param < 0 || device_address_param > 0x3FF) {
+    throw std::invalid_argument("device_address must be a 7 or 10 bit address");
+  }
+  if (read_size_param <= 0 || static_cast<std::size_t>(read_size_param) > MAX_READ_SIZE) {
+    throw std::invalid_argument("read_size must be between 1 and " +
+            std::to_string(MAX_READ_SIZE));
+  }
+  if (offset_width != 8 && offset_width != 16) {
+    throw std::invalid_argument("offset_width must be 8 or 16");
+  }
+  if (period_ms <= 0.0) {
+    throw std::invalid_argument("period_ms must be positive");
+  }
+
+  device_address = static_cast<uint16_t>(device_address_param);
+  register_address = static_cast<uint16_t>(register_address_param);
+  read_size = static_cast<uint8_t>(read_size_param);
+  offset_format = offset_width == 8 ?
+    I2CRegisterOffsetFormat::OFFSET_8BIT : I2CRegisterOffsetFormat::OFFSET_16BIT_BE;
+
+  use_data_ready = data_ready_register_param >= 0;
+  data_ready_register = static_cast<uint16_t>(std::max<int64_t>(data_ready_register_param, 0));
+  data_ready_mask = static_cast<uint8_t>(data_ready_mask_param);
+
+  // check the offsets up front rather than on every cycle
+  uint8_t offset_scratch[I2C_REGISTER_OFFSET_MAX_SIZE];
+  encode_register_offset(offset_format, register_address, offset_scratch);
+  encode_register_offset(offset_format, data_ready_register, offset_scratch);
+
+  handler = std::make_unique<ThreadUnsafeI2CHandler>(adapter_path);
+
+  publisher = create_publisher<SampleMsg>("~/sample", rclcpp::SensorDataQoS());
+  report_period = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::duration<double>(report_period_s));
+  last_report = std::chrono::steady_clock::now();
+
+  timer = create_wall_timer(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<double, std::milli>(period_ms)),
+    [this] {on_timer();});
+
+  RCLCPP_INFO(get_logger(), "Reading %u bytes at register 0x%x of device 0x%x on %s (%s)",
+    read_size, register_address, device_address, adapter_path.c_str(),
+    use_data_ready ? "on data ready" : "periodic");
+}
+
+void I2CSensorComponent::on_timer()
+{
+  if (!is_data_ready()) {
+    return;
+  }
+
+  // loaned messages live in middleware memory, so the bus transfer writes straight into them
+  if (publisher->can_loan_messages()) {
+    auto message = publisher->borrow_loaned_message();
+    if (!acquire(message.get())) {
+      return;
+    }
+    message.get().acquisition_latency_ns = elapsed_since_acquisition().count();
+    publisher->publish(std::move(message));
+  } else {
+    // handing over ownership lets intra-process subscribers take the message without a copy
+    auto message = std::make_unique<SampleMsg>();
+    if (!acquire(*message)) {
+      return;
+    }
+    message->acquisition_latency_ns = elapsed_since_acquisition().count();
+    publisher->publish(std::move(message));
+  }
+  record_latency(elapsed_since_acquisition());
+
+  if (report_period.count() > 0 &&
+    std::chrono::steady_clock::now() - last_report >= report_period)
+  {
+    report_latency();
+  }
+}
+
+bool I2CSensorComponent::is_data_ready()
+{
+  if (!use_data_ready) {
+    return true;
+  }
+
+  uint8_t status = 0;
+  try {
+    SampleTransaction transaction{device_address};
+    transaction.set_offset_format(offset_format).add_read_in_place(data_ready_register, status);
+    handler->apply_transaction(transaction);
+  } catch (const exceptions::SysException & e) {
+    RCLCPP_WARN_THROTTLE(get_logger(), *get_clock(), 1000, "Status read failed: %s", e.what());
+    return false;
+  }
+  return (status & data_ready_mask) != 0;
+}
+
+bool I2CSensorComponent::acquire(SampleMsg & message)
+{
+  const auto start = std::chrono::steady_clock::now();
+  try {
+    SampleTransaction transaction{device_address};
+    transaction.set_offset_format(offset_format)
+    .add_read_in_place(register_address, message.data.data(), read_size);
+    handler->apply_transaction(transaction);
+  } catch (const exceptions::SysException & e) {
+    RCLCPP_WARN_THROTTLE(get_logger(), *get_clock(), 1000, "Register read failed: %s", e.what());
+    return false;
+  }
+  acquisition_time = std::chrono::steady_clock::now();
+
+  message.stamp = now();
+  message.device_address = device_address;
+  message.register_address = register_address;
+  message.sequence = ++sequence;
+  message.size = read_size;
+  message.transfer_duration_ns = (acquisition_time - start).count();
+  return true;
+}
+
+std::chrono::nanoseconds I2CSensorComponent::elapsed_since_acquisition() const
+{
+  return std::chrono::steady_clock::now() - acquisition_time;
+}
+
+void I2CSensorComponent::record_latency(std::chrono::nanoseconds latency)
+{
+  latency_min = std::min(latency_min, latency);
+  latency_max = std::max(latency_max, latency);
+  latency_sum += latency;
+  latency_count++;
+}
+
+void I2CSensorComponent::report_latency()
+{
+  if (latency_count > 0) {
+    RCLCPP_INFO(get_logger(),
+      "Acquisition to publish latency over %lu samples: min %.1f us, mean %.1f us, max %.1f us",
+      static_cast<unsigned long>(latency_count),
+      static_cast<double>(latency_min.count()) / 1e3,
+      static_cast<double>(latency_sum.count()) / 1e3 / static_cast<double>(latency_count),
+      static_cast<double>(latency_max.count()) / 1e3);
+  }
+
+  latency_min = std::chrono::nanoseconds::max();
+  latency_max = std::chrono::nanoseconds{0};
+  latency_sum = std::chrono::nanoseconds{0};
+  latency_count = 0;
+  last_report = std::chrono::steady_clock::now();
+}
+
+}  // namespace ros2_i2c
+
+RCLCPP_COMPONENTS_REGISTER_NODE(ros2_i2c::I2CSensorComponent)
@@ -0,0 +1,116 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "allocation_counter.hpp"
+
+namespace
+{
+
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> allocated_bytes{0};
+
+void * counted_allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t))
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+
+  void * ptr = nullptr;
+  if (alignment > alignof(std::max_align_t)) {
+    // aligned_alloc requires the size to be a multiple of the alignment
+    ptr = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+  } else {
+    ptr = std::malloc(size == 0 ? 1 : size);
+  }
+
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+}  // namespace
+
+// replace the global allocation functions to count every heap allocation
+void * operator new(std::size_t size)
+{
+  return counted_allocate(size);
+}
+void * operator new[](std::size_t size)
+{
+  return counted_allocate(size);
+}
+void * operator new(std::size_t size, std::align_val_t alignment)
+{
+  return counted_allocate(size, static_cast<std::size_t>(alignment));
+}
+void * operator new[](std::size_t size, std::align_val_t alignment)
+{
+  return counted_allocate(size, static_cast<std::size_t>(alignment));
+}
+void operator delete(void * ptr) noexcept
+{
+  std::free(ptr);
+}
+void operator delete[](void * ptr) noexcept
+{
+  std::free(ptr);
+}
+void operator delete(void * ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+void operator delete[](void * ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+void operator delete(void * ptr, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+void operator delete[](void * ptr, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+void operator delete(void * ptr, std::size_t, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+void operator delete[](void * ptr, std::size_t, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+
+namespace ros2_i2ccpp::benchmarks
+{
+
+AllocationCounter::AllocationCounter()
+: initial_allocations(allocations.load(std::memory_order_relaxed)),
+  initial_allocated_bytes(allocated_bytes.load(std::memory_order_relaxed))
+{
+}
+
+uint64_t AllocationCounter::get_allocations() const
+{
+  return allocations.load(std::memory_order_relaxed) - initial_allocations;
+}
+
+uint64_t AllocationCounter::get_allocated_bytes() const
+{
+  return allocated_bytes.load(std::memory_order_relaxed) - initial_allocated_bytes;
+}
+
+void AllocationCounter::report(benchmark::State & state) const
+{
+  state.counters["allocs/tx"] = benchmark::Counter(
+    static_cast<double>(get_allocations()), benchmark::Counter::kAvgIterations);
+  state.counters["alloc_bytes/tx"] = benchmark::Counter(
+    static_cast<double>(get_allocated_bytes()), benchmark::Counter::kAvgIterations);
+}
+
+}  // namespace ros2_i2ccpp::benchmarks
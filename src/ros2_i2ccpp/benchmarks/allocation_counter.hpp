@@ -0,0 +1,39 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP__BENCHMARKS__ALLOCATION_COUNTER_HPP_
+#define ROS2_I2CCPP__BENCHMARKS__ALLOCATION_COUNTER_HPP_
+#pragma once
+
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+namespace ros2_i2ccpp::benchmarks
+{
+
+/**
+ * Counts the heap allocations (global operator new) made while it is alive.
+ */
+class AllocationCounter {
+public:
+  AllocationCounter();
+
+  [[nodiscard]] uint64_t get_allocations() const;
+  [[nodiscard]] uint64_t get_allocated_bytes() const;
+
+  /**
+   * Report the allocations per iteration of the benchmark.
+   */
+  void report(benchmark::State & state) const;
+
+private:
+  uint64_t initial_allocations;
+  uint64_t initial_allocated_bytes;
+};
+
+}  // namespace ros2_i2ccpp::benchmarks
+
+#endif  // ROS2_I2CCPP__BENCHMARKS__ALLOCATION_COUNTER_HPP_
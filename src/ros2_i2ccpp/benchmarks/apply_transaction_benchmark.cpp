@@ -0,0 +1,407 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include <benchmark/benchmark.h>
+
+#include "ros2_i2ccpp/exceptions.hpp"
+#include "ros2_i2ccpp/i2c_handler.hpp"
+#include "ros2_i2ccpp/transaction.hpp"
+#include "ros2_i2ccpp/backend/simulated_i2c_backend.hpp"
+#include "allocation_counter.hpp"
+
+namespace ros2_i2ccpp::benchmarks
+{
+
+namespace
+{
+
+constexpr uint16_t DEVICE_ADDRESS = 0x50;
+
+/**
+ * Simulated bus with a single memory device.
+ */
+std::shared_ptr<SimulatedI2CBus> make_bus(SimulatedBusTiming timing)
+{
+  auto bus = std::make_shared<SimulatedI2CBus>(timing);
+  bus->attach_device(DEVICE_ADDRESS, std::make_shared<SimulatedI2CDevice>(65536, 2));
+  return bus;
+}
+
+void report_bus_time(benchmark::State & state, const SimulatedI2CBus & bus)
+{
+  const auto statistics = bus.get_statistics();
+  state.counters["bus_ns/tx"] = benchmark::Counter(
+    static_cast<double>(statistics.busy_time.count()), benchmark::Counter::kAvgIterations);
+  state.counters["msgs/tx"] = benchmark::Counter(
+    static_cast<double>(statistics.messages), benchmark::Counter::kAvgIterations);
+}
+
+/**
+ * Build a transaction with state.range(0) segments of PODSize bytes, alternating writes and reads,
+ * and apply it through the handler, without waiting for the modeled bus time.
+ */
+template<typename BuilderT, std::size_t PODSize>
+void BM_ApplyTransaction(benchmark::State & state)
+{
+  using PODType = std::array<uint8_t, PODSize>;
+
+  const auto segment_count = state.range(0);
+  PODType write_data{};
+  std::array<PODType, I2CConstants::I2C_TRANSACTION_IOCTL_MAX_MSGS> read_data{};
+
+  auto bus = make_bus(SimulatedBusTiming::for_speed(SimulatedBusSpeed::FAST_MODE, false));
+  ThreadUnsafeI2CHandler handler(DEVICE_ADDRESS, std::make_unique<SimulatedI2CBackend>(bus));
+  auto builder = std::make_unique<BuilderT>(DEVICE_ADDRESS);
+
+  AllocationCounter allocation_counter;
+  for (auto _ : state) {
+    for (int64_t i = 0; i < segment_count; i++) {
+      if (i % 2 == 0) {
+        builder->add_write(write_data);
+      } else {
+        builder->add_read(read_data[i]);
+      }
+    }
+
+    handler.apply_transaction(builder->getTransaction());
+  }
+  allocation_counter.report(state);
+  report_bus_time(state, *bus);
+
+  state.counters["bytes/tx"] = benchmark::Counter(
+    static_cast<double>(segment_count * PODSize));
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * segment_count * PODSize);
+}
+
+/**
+ * Same as BM_ApplyTransaction, using an inline transaction that is cleared and rebuilt.
+ */
+template<std::size_t PODSize>
+void BM_ApplyInlineTransaction(benchmark::State & state)
+{
+  using PODType = std::array<uint8_t, PODSize>;
+
+  const auto segment_count = state.range(0);
+  PODType write_data{};
+  std::array<PODType, I2CConstants::I2C_TRANSACTION_IOCTL_MAX_MSGS> read_data{};
+
+  auto bus = make_bus(SimulatedBusTiming::for_speed(SimulatedBusSpeed::FAST_MODE, false));
+  ThreadUnsafeI2CHandler handler(DEVICE_ADDRESS, std::make_unique<SimulatedI2CBackend>(bus));
+  auto transaction = std::make_unique<I2CInlineTransaction<4096>>(DEVICE_ADDRESS);
+
+  AllocationCounter allocation_counter;
+  for (auto _ : state) {
+    transaction->clear();
+    for (int64_t i = 0; i < segment_count; i++) {
+      if (i % 2 == 0) {
+        transaction->add_write(write_data);
+      } else {
+        transaction->add_read(read_data[i]);
+      }
+    }
+
+    handler.apply_transaction(*transaction);
+  }
+  allocation_counter.report(state);
+  report_bus_time(state, *bus);
+
+  state.counters["bytes/tx"] = benchmark::Counter(
+    static_cast<double>(segment_count * PODSize));
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * segment_count * PODSize);
+}
+
+/**
+ * Typical register read (write the offset, read the data), waiting for the modeled bus time.
+ * The wall time per transaction is the end-to-end latency at the given bus speed.
+ */
+template<std::size_t PODSize>
+void BM_RegisterReadRealTime(benchmark::State & state)
+{
+  using PODType = std::array<uint8_t, PODSize>;
+
+  const auto bus_speed = static_cast<uint32_t>(state.range(0));
+  PODType read_data{};
+
+  auto bus = make_bus(SimulatedBusTiming::for_speed(bus_speed, true));
+  ThreadUnsafeI2CHandler handler(DEVICE_ADDRESS, std::make_unique<SimulatedI2CBackend>(bus));
+  I2CTransactionBuilderPooled<> builder(DEVICE_ADDRESS);
+
+  AllocationCounter allocation_counter;
+  for (auto _ : state) {
+    builder.add_write(uint16_t{0x0010});
+    builder.add_read(read_data);
+    handler.apply_transaction(builder.getTransaction());
+  }
+  allocation_counter.report(state);
+  report_bus_time(state, *bus);
+
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * PODSize);
+}
+
+/**
+ * Same register read as BM_RegisterReadRealTime, with a compile-time transaction and without
+ * waiting for the modeled bus time.
+ */
+template<std::size_t PODSize>
+void BM_StaticRegisterRead(benchmark::State & state)
+{
+  using PODType = std::array<uint8_t, PODSize>;
+
+  auto bus = make_bus(SimulatedBusTiming::for_speed(SimulatedBusSpeed::FAST_MODE, false));
+  ThreadUnsafeI2CHandler handler(DEVICE_ADDRESS, std::make_unique<SimulatedI2CBackend>(bus));
+  I2CStaticTransaction<I2CWriteTransactionSegment<uint16_t>,
+    I2CReadTransactionSegment<PODType>> transaction(DEVICE_ADDRESS);
+  transaction.template set<0>(uint16_t{0x0010});
+
+  AllocationCounter allocation_counter;
+  for (auto _ : state) {
+    handler.apply_transaction(transaction);
+    benchmark::DoNotOptimize(transaction.template get<1>());
+  }
+  allocation_counter.report(state);
+  report_bus_time(state, *bus);
+
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * PODSize);
+}
+
+/**
+ * Same register read as BM_StaticRegisterRead, with a prepared transaction.
+ */
+template<std::size_t PODSize>
+void BM_PreparedRegisterRead(benchmark::State & state)
+{
+  using PODType = std::array<uint8_t, PODSize>;
+
+  PODType read_data{};
+
+  auto bus = make_bus(SimulatedBusTiming::for_speed(SimulatedBusSpeed::FAST_MODE, false));
+  ThreadUnsafeI2CHandler handler(DEVICE_ADDRESS, std::make_unique<SimulatedI2CBackend>(bus));
+  I2CTransactionBuilderPooled<> builder(DEVICE_ADDRESS);
+  builder.add_write(uint16_t{0x0010});
+  builder.add_read(read_data);
+  auto transaction = builder.prepare();
+
+  AllocationCounter allocation_counter;
+  for (auto _ : state) {
+    handler.apply_transaction(transaction);
+    benchmark::DoNotOptimize(read_data);
+  }
+  allocation_counter.report(state);
+  report_bus_time(state, *bus);
+
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * PODSize);
+}
+
+/**
+ * Same register read as BM_PreparedRegisterRead, reading in place into the destination.
+ */
+template<std::size_t PODSize>
+void BM_PreparedInPlaceRegisterRead(benchmark::State & state)
+{
+  using PODType = std::array<uint8_t, PODSize>;
+
+  PODType read_data{};
+
+  auto bus = make_bus(SimulatedBusTiming::for_speed(SimulatedBusSpeed::FAST_MODE, false));
+  ThreadUnsafeI2CHandler handler(DEVICE_ADDRESS, std::make_unique<SimulatedI2CBackend>(bus));
+  I2CTransactionBuilderPooled<> builder(DEVICE_ADDRESS);
+  builder.add_write(uint16_t{0x0010});
+  builder.add_read_in_place(read_data);
+  auto transaction = builder.prepare();
+
+  AllocationCounter allocation_counter;
+  for (auto _ : state) {
+    handler.apply_transaction(transaction);
+    benchmark::DoNotOptimize(read_data);
+  }
+  allocation_counter.report(state);
+  report_bus_time(state, *bus);
+
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * PODSize);
+}
+
+/**
+ * Write state.range(0) consecutive 16-bit registers, which are coalesced with their offset into a
+ * single message.
+ */
+void BM_RegisterWriteBurst(benchmark::State & state)
+{
+  const auto register_count = static_cast<uint16_t>(state.range(0));
+
+  auto bus = make_bus(SimulatedBusTiming::for_speed(SimulatedBusSpeed::FAST_MODE, false));
+  ThreadUnsafeI2CHandler handler(DEVICE_ADDRESS, std::make_unique<SimulatedI2CBackend>(bus));
+  I2CInlineTransaction<> transaction(DEVICE_ADDRESS);
+  transaction.set_offset_format(I2CRegisterOffsetFormat::OFFSET_16BIT_BE);
+
+  AllocationCounter allocation_counter;
+  for (auto _ : state) {
+    transaction.clear();
+    for (uint16_t i = 0; i < register_count; i++) {
+      transaction.add_write(static_cast<uint16_t>(0x0010 + 2 * i), i);
+    }
+    handler.apply_transaction(transaction);
+  }
+  allocation_counter.report(state);
+  report_bus_time(state, *bus);
+
+  state.SetItemsProcessed(state.iterations() * register_count);
+}
+
+/**
+ * Read state.range(0) SMBus words from a device, sent as a single prepared transfer instead of one
+ * I2C_SMBUS call per word.
+ */
+void BM_SMBusWordReads(benchmark::State & state)
+{
+  constexpr uint16_t SMBUS_DEVICE_ADDRESS = 0x0B;
+  const auto word_count = static_cast<uint8_t>(state.range(0));
+
+  auto bus = make_bus(SimulatedBusTiming::for_speed(SimulatedBusSpeed::FAST_MODE, false));
+  bus->attach_device(SMBUS_DEVICE_ADDRESS, std::make_shared<SimulatedI2CDevice>());
+  ThreadUnsafeI2CHandler handler(std::make_unique<SimulatedI2CBackend>(bus));
+
+  std::array<uint16_t, I2CConstants::I2C_TRANSACTION_IOCTL_MAX_MSGS / 2> words{};
+  I2CTransactionBuilder builder(SMBUS_DEVICE_ADDRESS);
+  for (uint8_t i = 0; i < word_count; i++) {
+    builder.add_smbus_read_word(static_cast<uint8_t>(2 * i), words[i]);
+  }
+  auto transaction = builder.prepare();
+
+  AllocationCounter allocation_counter;
+  for (auto _ : state) {
+    handler.apply_transaction(transaction);
+    benchmark::DoNotOptimize(words.data());
+  }
+  allocation_counter.report(state);
+  report_bus_time(state, *bus);
+  state.counters["transfers/tx"] = benchmark::Counter(
+    static_cast<double>(bus->get_statistics().transfers), benchmark::Counter::kAvgIterations);
+
+  state.SetItemsProcessed(state.iterations() * word_count);
+}
+
+/**
+ * Register read with the handler statistics on or off, to measure what recording costs.
+ */
+template<bool Statistics>
+void BM_RecordedRegisterRead(benchmark::State & state)
+{
+  std::array<uint8_t, 6> read_data{};
+  auto bus = make_bus(SimulatedBusTiming::for_speed(SimulatedBusSpeed::FAST_MODE, false));
+  ThreadUnsafeI2CHandler handler(DEVICE_ADDRESS, std::make_unique<SimulatedI2CBackend>(bus));
+  handler.enable_statistics(Statistics);
+  I2CInlineTransaction<> transaction(DEVICE_ADDRESS);
+  transaction.add_read(uint16_t{0x0010}, read_data);
+
+  AllocationCounter allocation_counter;
+  for (auto _ : state) {
+    handler.apply_transaction(transaction);
+    benchmark::DoNotOptimize(read_data);
+  }
+  allocation_counter.report(state);
+
+  const auto statistics = handler.get_statistics();
+  state.counters["transfer_p99_ns"] = static_cast<double>(
+    statistics.transfer_time.get_percentile(99).count());
+  state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * Read a register of a device that NAKs, reporting the failure by exception or by I2CResult.
+ */
+template<bool Throwing>
+void BM_NakedRegisterRead(benchmark::State & state)
+{
+  constexpr uint16_t ABSENT_DEVICE_ADDRESS = 0x51;
+
+  std::array<uint8_t, 2> read_data{};
+  auto bus = make_bus(SimulatedBusTiming::for_speed(SimulatedBusSpeed::FAST_MODE, false));
+  ThreadUnsafeI2CHandler handler(std::make_unique<SimulatedI2CBackend>(bus));
+  I2CInlineTransaction<> transaction(ABSENT_DEVICE_ADDRESS);
+  transaction.add_read(uint8_t{0x10}, read_data);
+
+  int64_t failures = 0;
+  for (auto _ : state) {
+    if constexpr (Throwing) {
+      try {
+        handler.apply_transaction(transaction);
+      } catch (const exceptions::SysException &) {
+        failures++;
+      }
+    } else {
+      if (!handler.try_apply_transaction(transaction)) {
+        failures++;
+      }
+    }
+  }
+  state.counters["failures"] = benchmark::Counter(
+    static_cast<double>(failures), benchmark::Counter::kAvgIterations);
+}
+
+void segment_counts(benchmark::internal::Benchmark * benchmark)
+{
+  for (const auto segments : {2, 8, 32, 41}) {
+    benchmark->Arg(segments);
+  }
+  benchmark->ArgName("segments");
+}
+
+void bus_speeds(benchmark::internal::Benchmark * benchmark)
+{
+  for (const auto speed : {SimulatedBusSpeed::STANDARD_MODE, SimulatedBusSpeed::FAST_MODE,
+      SimulatedBusSpeed::FAST_MODE_PLUS})
+  {
+    benchmark->Arg(speed);
+  }
+  benchmark->ArgName("bus_hz")->UseRealTime()->Unit(benchmark::kMicrosecond);
+}
+
+}  // namespace
+
+#define ROS2_I2CCPP_APPLY_BENCHMARKS(BuilderT) \
+  BENCHMARK_TEMPLATE(BM_ApplyTransaction, BuilderT, 4)->Apply(segment_counts); \
+  BENCHMARK_TEMPLATE(BM_ApplyTransaction, BuilderT, 64)->Apply(segment_counts)
+
+ROS2_I2CCPP_APPLY_BENCHMARKS(I2CTransactionBuilder);
+ROS2_I2CCPP_APPLY_BENCHMARKS(I2CTransactionBuilderSingleShot<>);
+ROS2_I2CCPP_APPLY_BENCHMARKS(I2CTransactionBuilderPooled<>);
+
+BENCHMARK_TEMPLATE(BM_ApplyInlineTransaction, 4)->Apply(segment_counts);
+BENCHMARK_TEMPLATE(BM_ApplyInlineTransaction, 64)->Apply(segment_counts);
+
+BENCHMARK_TEMPLATE(BM_StaticRegisterRead, 6);
+BENCHMARK_TEMPLATE(BM_StaticRegisterRead, 32);
+
+BENCHMARK_TEMPLATE(BM_PreparedRegisterRead, 6);
+BENCHMARK_TEMPLATE(BM_PreparedRegisterRead, 32);
+
+BENCHMARK_TEMPLATE(BM_PreparedInPlaceRegisterRead, 6);
+BENCHMARK_TEMPLATE(BM_PreparedInPlaceRegisterRead, 32);
+
+BENCHMARK(BM_RegisterWriteBurst)->Arg(1)->Arg(8)->Arg(32)->ArgName("registers");
+
+BENCHMARK(BM_SMBusWordReads)->Arg(1)->Arg(10)->ArgName("words");
+
+BENCHMARK_TEMPLATE(BM_RecordedRegisterRead, false);
+BENCHMARK_TEMPLATE(BM_RecordedRegisterRead, true);
+
+BENCHMARK_TEMPLATE(BM_NakedRegisterRead, true);
+BENCHMARK_TEMPLATE(BM_NakedRegisterRead, false);
+
+BENCHMARK_TEMPLATE(BM_RegisterReadRealTime, 6)->Apply(bus_speeds);
+BENCHMARK_TEMPLATE(BM_RegisterReadRealTime, 32)->Apply(bus_speeds);
+
+}  // namespace ros2_i2ccpp::benchmarks
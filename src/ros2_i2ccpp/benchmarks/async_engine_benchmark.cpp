@@ -0,0 +1,182 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "ros2_i2ccpp/async_engine.hpp"
+#include "ros2_i2ccpp/bulk_transfer.hpp"
+#include "ros2_i2ccpp/i2c_handler.hpp"
+#include "ros2_i2ccpp/backend/simulated_i2c_backend.hpp"
+
+namespace ros2_i2ccpp::benchmarks
+{
+
+namespace
+{
+
+constexpr uint16_t DEVICE_ADDRESS = 0x50;
+constexpr std::size_t READ_SIZE = 6;
+
+using ReadData = std::array<uint8_t, READ_SIZE>;
+
+std::shared_ptr<SimulatedI2CBus> make_bus()
+{
+  auto bus = std::make_shared<SimulatedI2CBus>(
+    SimulatedBusTiming::for_speed(SimulatedBusSpeed::FAST_MODE, false));
+  bus->attach_device(DEVICE_ADDRESS, std::make_shared<SimulatedI2CDevice>(65536, 2));
+  return bus;
+}
+
+// shared by all benchmark threads, created by the setup functions
+std::unique_ptr<ThreadSafeI2CHandler> shared_handler;
+std::unique_ptr<I2CAsyncEngine> shared_engine;
+
+void setup_handler(const benchmark::State &)
+{
+  shared_handler = std::make_unique<ThreadSafeI2CHandler>(DEVICE_ADDRESS,
+      std::make_unique<SimulatedI2CBackend>(make_bus()));
+}
+
+void teardown_handler(const benchmark::State &)
+{
+  shared_handler.reset();
+}
+
+void setup_engine(const benchmark::State &)
+{
+  shared_engine = std::make_unique<I2CAsyncEngine>(DEVICE_ADDRESS,
+      std::make_unique<SimulatedI2CBackend>(make_bus()));
+}
+
+void teardown_engine(const benchmark::State &)
+{
+  shared_engine.reset();
+}
+
+/**
+ * Every thread reads a register through a shared ThreadSafeI2CHandler, blocking on its mutex.
+ */
+void BM_ContendedRegisterRead(benchmark::State & state)
+{
+  ReadData read_data{};
+  I2CInlineTransaction<> transaction(DEVICE_ADDRESS);
+  transaction.add_read(uint16_t{0x0010}, read_data);
+
+  for (auto _ : state) {
+    shared_handler->apply_transaction(transaction);
+    benchmark::DoNotOptimize(read_data);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * Every thread reads a register through a shared I2CAsyncEngine and waits for the future.
+ */
+void BM_AsyncRegisterRead(benchmark::State & state)
+{
+  ReadData read_data{};
+  I2CInlineTransaction<> transaction(DEVICE_ADDRESS);
+  transaction.add_read(uint16_t{0x0010}, read_data);
+
+  for (auto _ : state) {
+    shared_engine->submit(transaction).get();
+    benchmark::DoNotOptimize(read_data);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * Every thread keeps state.range(0) reads in flight, as a producer that never waits on the bus.
+ */
+void BM_AsyncPipelinedRegisterRead(benchmark::State & state)
+{
+  const auto in_flight = static_cast<std::size_t>(state.range(0));
+  std::vector<ReadData> read_data(in_flight);
+  std::vector<I2CInlineTransaction<>> transactions(in_flight,
+    I2CInlineTransaction<>(DEVICE_ADDRESS));
+  std::vector<std::future<void>> futures(in_flight);
+  for (std::size_t i = 0; i < in_flight; i++) {
+    transactions[i].add_read(uint16_t{0x0010}, read_data[i]);
+  }
+
+  std::size_t next = 0;
+  for (auto _ : state) {
+    if (futures[next].valid()) {
+      futures[next].get();
+    }
+    futures[next] = shared_engine->submit(transactions[next]);
+    next = (next + 1) % in_flight;
+  }
+  for (auto & future : futures) {
+    if (future.valid()) {
+      future.get();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * Flash the same image to state.range(0) EEPROMs on one bus, the write cycles of one device
+ * overlapping with the page writes of the others.
+ */
+void BM_InterleavedMemoryWrite(benchmark::State & state)
+{
+  constexpr uint16_t MEMORY_ADDRESS = 0x50;
+  constexpr uint32_t MEMORY_SIZE = 256;
+  constexpr uint16_t PAGE_SIZE = 32;
+  constexpr std::chrono::milliseconds WRITE_CYCLE_TIME{1};
+
+  const auto device_count = static_cast<std::size_t>(state.range(0));
+  auto bus = std::make_shared<SimulatedI2CBus>(
+    SimulatedBusTiming::for_speed(SimulatedBusSpeed::FAST_MODE));
+  I2CMemoryGeometry geometry;
+  geometry.size = MEMORY_SIZE;
+  geometry.page_size = PAGE_SIZE;
+  geometry.write_cycle_time = WRITE_CYCLE_TIME;
+
+  std::vector<std::unique_ptr<I2CBulkTransfer>> transfers;
+  for (std::size_t i = 0; i < device_count; i++) {
+    geometry.device_address = static_cast<uint16_t>(MEMORY_ADDRESS + i);
+    bus->attach_device(geometry.device_address,
+      std::make_shared<SimulatedMemoryDevice>(MEMORY_SIZE, 2, PAGE_SIZE, WRITE_CYCLE_TIME));
+    transfers.push_back(std::make_unique<I2CBulkTransfer>(geometry));
+  }
+  I2CAsyncEngine engine(std::make_unique<SimulatedI2CBackend>(bus));
+
+  const std::vector<uint8_t> image(MEMORY_SIZE, 0xA5);
+  std::vector<I2CMemorySource> sources;
+  std::vector<std::future<I2CBulkTransferResult>> futures;
+  for (auto _ : state) {
+    sources.assign(device_count, I2CMemorySource(image.data(), image.size()));
+    futures.clear();
+    for (std::size_t i = 0; i < device_count; i++) {
+      futures.push_back(transfers[i]->submit_write(engine, 0, sources[i]));
+    }
+    for (auto & future : futures) {
+      future.get();
+    }
+  }
+  state.SetBytesProcessed(
+    static_cast<int64_t>(state.iterations() * device_count * MEMORY_SIZE));
+}
+
+}  // namespace
+
+BENCHMARK(BM_ContendedRegisterRead)->Setup(setup_handler)->Teardown(teardown_handler)
+->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_AsyncRegisterRead)->Setup(setup_engine)->Teardown(teardown_engine)
+->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_AsyncPipelinedRegisterRead)->Setup(setup_engine)->Teardown(teardown_engine)
+->Arg(16)->ArgName("in_flight")->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_InterleavedMemoryWrite)->Arg(1)->Arg(2)->Arg(4)->ArgName("devices")->UseRealTime();
+
+}  // namespace ros2_i2ccpp::benchmarks
@@ -0,0 +1,122 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <array>
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+#include "ros2_i2ccpp/transaction.hpp"
+#include "ros2_i2ccpp/inline_transaction.hpp"
+#include "allocation_counter.hpp"
+
+namespace ros2_i2ccpp::benchmarks
+{
+
+namespace
+{
+
+constexpr uint16_t DEVICE_ADDRESS = 0x50;
+
+/**
+ * Build a transaction with state.range(0) segments of PODSize bytes, alternating writes and reads.
+ */
+template<typename BuilderT, std::size_t PODSize>
+void BM_BuildTransaction(benchmark::State & state)
+{
+  using PODType = std::array<uint8_t, PODSize>;
+
+  const auto segment_count = state.range(0);
+  PODType write_data{};
+  std::array<PODType, I2CConstants::I2C_TRANSACTION_IOCTL_MAX_MSGS> read_data{};
+
+  // builders are long-lived, as they would be in a sensor loop
+  auto builder = std::make_unique<BuilderT>(DEVICE_ADDRESS);
+
+  AllocationCounter allocation_counter;
+  for (auto _ : state) {
+    for (int64_t i = 0; i < segment_count; i++) {
+      if (i % 2 == 0) {
+        builder->add_write(write_data);
+      } else {
+        builder->add_read(read_data[i]);
+      }
+    }
+
+    auto transaction = builder->getTransaction();
+    benchmark::DoNotOptimize(transaction.getSegments().data());
+  }
+  allocation_counter.report(state);
+
+  state.counters["bytes/tx"] = benchmark::Counter(
+    static_cast<double>(segment_count * PODSize));
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * segment_count * PODSize);
+}
+
+/**
+ * Same as BM_BuildTransaction, using an inline transaction that is cleared and rebuilt.
+ */
+template<std::size_t PODSize>
+void BM_BuildInlineTransaction(benchmark::State & state)
+{
+  using PODType = std::array<uint8_t, PODSize>;
+
+  const auto segment_count = state.range(0);
+  PODType write_data{};
+  std::array<PODType, I2CConstants::I2C_TRANSACTION_IOCTL_MAX_MSGS> read_data{};
+
+  auto transaction = std::make_unique<I2CInlineTransaction<16384>>(DEVICE_ADDRESS);
+
+  AllocationCounter allocation_counter;
+  for (auto _ : state) {
+    transaction->clear();
+    for (int64_t i = 0; i < segment_count; i++) {
+      if (i % 2 == 0) {
+        transaction->add_write(write_data);
+      } else {
+        transaction->add_read(read_data[i]);
+      }
+    }
+
+    benchmark::DoNotOptimize(transaction->get_messages());
+  }
+  allocation_counter.report(state);
+
+  state.counters["bytes/tx"] = benchmark::Counter(
+    static_cast<double>(segment_count * PODSize));
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(state.iterations() * segment_count * PODSize);
+}
+
+// segment counts, the builders accept at most I2C_TRANSACTION_IOCTL_MAX_MSGS - 1 segments
+void segment_counts(benchmark::internal::Benchmark * benchmark)
+{
+  for (const auto segments : {1, 2, 8, 16, 32, 41}) {
+    benchmark->Arg(segments);
+  }
+  benchmark->ArgName("segments");
+}
+
+}  // namespace
+
+#define ROS2_I2CCPP_BUILDER_BENCHMARKS(BuilderT) \
+  BENCHMARK_TEMPLATE(BM_BuildTransaction, BuilderT, 1)->Apply(segment_counts); \
+  BENCHMARK_TEMPLATE(BM_BuildTransaction, BuilderT, 4)->Apply(segment_counts); \
+  BENCHMARK_TEMPLATE(BM_BuildTransaction, BuilderT, 16)->Apply(segment_counts); \
+  BENCHMARK_TEMPLATE(BM_BuildTransaction, BuilderT, 64)->Apply(segment_counts); \
+  BENCHMARK_TEMPLATE(BM_BuildTransaction, BuilderT, 256)->Apply(segment_counts)
+
+ROS2_I2CCPP_BUILDER_BENCHMARKS(I2CTransactionBuilder);
+ROS2_I2CCPP_BUILDER_BENCHMARKS(I2CTransactionBuilderSingleShot<>);
+ROS2_I2CCPP_BUILDER_BENCHMARKS(I2CTransactionBuilderPooled<>);
+
+BENCHMARK_TEMPLATE(BM_BuildInlineTransaction, 1)->Apply(segment_counts);
+BENCHMARK_TEMPLATE(BM_BuildInlineTransaction, 4)->Apply(segment_counts);
+BENCHMARK_TEMPLATE(BM_BuildInlineTransaction, 16)->Apply(segment_counts);
+BENCHMARK_TEMPLATE(BM_BuildInlineTransaction, 64)->Apply(segment_counts);
+BENCHMARK_TEMPLATE(BM_BuildInlineTransaction, 256)->Apply(segment_counts);
+
+}  // namespace ros2_i2ccpp::benchmarks
@@ -0,0 +1,506 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP_ASYNC_ENGINE_HPP_
+#define ROS2_I2CCPP_ASYNC_ENGINE_HPP_
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ros2_i2ccpp/i2c_handler.hpp"
+#include "ros2_i2ccpp/impl/message_chunking.hpp"
+#include "ros2_i2ccpp/impl/mpsc_queue.hpp"
+#include "ros2_i2ccpp/impl/tracing.hpp"
+
+namespace ros2_i2ccpp
+{
+
+class I2CBackend;
+
+/**
+ * How a request is scheduled by an I2CAsyncEngine.
+ */
+struct I2CSchedulingParameters
+{
+  I2CPriorityClass priority{I2CPriorityClass::PRIORITY_NORMAL};
+
+  // requests of the same class run earliest deadline first, then in submission order
+  std::chrono::steady_clock::time_point deadline{std::chrono::steady_clock::time_point::max()};
+
+  // if set, the transaction is sent in slices of at most this many messages (split at safe
+  // boundaries, see next_chunk_size), and more urgent requests may run in between
+  uint32_t slice_messages{0};
+
+  // time the device needs after each transfer of the request to store what was written, e.g. an
+  // EEPROM page write, during which it NAKs; later requests for that device are held back until
+  // it acknowledges again, while requests for other devices keep the bus busy
+  std::chrono::nanoseconds write_cycle_time{0};
+
+  // if set, used instead of the retry policy of the priority class, and must outlive the request
+  const I2CRetryPolicy * retry_policy{nullptr};
+};
+
+/**
+ * Request queued on an I2CAsyncEngine.
+ */
+class I2CAsyncRequest : public MPSCQueueNode {
+public:
+  static constexpr uint16_t NO_DEVICE = 0xFFFF;
+
+  virtual ~I2CAsyncRequest() = default;
+
+  /**
+   * Device reached by the next execution or slice, NO_DEVICE if unknown or if there are several.
+   * Requests for a device in its write cycle are held back, see I2CSchedulingParameters.
+   */
+  virtual uint16_t get_device_address() {return NO_DEVICE;}
+
+  /**
+   * Run the request on the I/O thread.
+   */
+  virtual void execute(ThreadUnsafeI2CHandler & handler) = 0;
+
+  /**
+   * Run the next slice of at most max_messages messages, returns true once the request is done.
+   * Requests that cannot be split are run entirely.
+   */
+  virtual bool execute_slice(ThreadUnsafeI2CHandler & handler, uint32_t max_messages)
+  {
+    static_cast<void>(max_messages);
+    execute(handler);
+    return true;
+  }
+
+  /**
+   * Report the outcome of the request, error is null on success.
+   */
+  virtual void complete(std::exception_ptr error) = 0;
+
+  I2CSchedulingParameters scheduling;
+
+  // order of arrival on the I/O thread, to break ties
+  uint64_t sequence{0};
+};
+
+/**
+ * Request that applies a transaction and reports it to a callback.
+ * Transactions given as lvalues are referenced, and must outlive the request.
+ */
+template<typename TransactionT, typename CallbackT>
+class I2CAsyncTransactionRequest final : public I2CAsyncRequest {
+public:
+  template<typename T, typename C>
+  I2CAsyncTransactionRequest(T && transaction_, C && callback_)
+  : transaction(std::forward<T>(transaction_)), callback(std::forward<C>(callback_)) {}
+
+  void execute(ThreadUnsafeI2CHandler & handler) final
+  {
+    handler.apply_transaction(std::forward<TransactionT>(transaction));
+  }
+
+  bool execute_slice(ThreadUnsafeI2CHandler & handler, uint32_t max_messages) final
+  {
+    using T = std::decay_t<TransactionT>;
+    if constexpr (std::is_same_v<T, I2CTransaction>|| std::is_same_v<T, I2CPreparedTransaction>) {
+      if (messages == nullptr) {
+        bind_messages();
+      }
+      if constexpr (std::is_same_v<T, I2CPreparedTransaction>) {
+        // a prepared transaction may have been executed before
+        if (sent_messages == 0) {
+          transaction.rearm();
+        }
+      }
+
+      const auto remaining = message_count - sent_messages;
+      auto slice = next_chunk_size(messages + sent_messages, remaining,
+          std::min<uint32_t>(max_messages, I2CConstants::I2C_TRANSACTION_IOCTL_MAX_MSGS));
+      if (slice == 0) {
+        // a group is longer than the slice, send it whole
+        slice = next_chunk_size(messages + sent_messages, remaining,
+            I2CConstants::I2C_TRANSACTION_IOCTL_MAX_MSGS);
+      }
+      if (slice == 0) {
+        // the group does not fit in a single transfer either, so it can never be sent
+        ROS2_I2CCPP_THROW(exceptions::SysException(
+            "Message group does not fit in a single transfer", EMSGSIZE));
+      }
+      handler.apply_messages(messages + sent_messages, slice);
+      sent_messages += slice;
+
+      if (sent_messages < message_count) {
+        return false;
+      }
+
+      // publish the read segments, as the handler would once the transaction is applied
+      int error = 0;
+      if constexpr (std::is_same_v<T, I2CTransaction>) {
+        error = commit_segments(transaction.getSegments());
+      } else {
+        error = transaction.complete();
+      }
+      ROS2_I2CCPP_TRACEPOINT(segments_decoded, &handler, error);
+      if (error != 0) {
+        ROS2_I2CCPP_THROW(exceptions::SysException("Invalid reply from the device", error));
+      }
+      return true;
+    } else {
+      return I2CAsyncRequest::execute_slice(handler, max_messages);
+    }
+  }
+
+  uint16_t get_device_address() final
+  {
+    if (!device_address_known) {
+      device_address = find_device_address();
+      device_address_known = true;
+    }
+    return device_address;
+  }
+
+  void complete(std::exception_ptr error) final
+  {
+    callback(std::move(error));
+  }
+
+private:
+  template<typename T, typename = void>
+  struct has_messages : std::false_type {};
+
+  template<typename T>
+  struct has_messages<T, std::void_t<decltype(std::declval<T &>().get_messages())>>
+    : std::true_type {};
+
+  uint16_t find_device_address()
+  {
+    using T = std::decay_t<TransactionT>;
+    uint16_t address = NO_DEVICE;
+    const auto merge = [&address](uint16_t message_address) {
+        if (address == NO_DEVICE) {
+          address = message_address;
+          return true;
+        }
+        return address == message_address;
+      };
+
+    if constexpr (std::is_same_v<T, I2CTransaction>) {
+      for (auto & segment : transaction.getSegments()) {
+        if (!merge(segment->get_address())) {
+          return NO_DEVICE;
+        }
+      }
+    } else if constexpr (has_messages<T>::value) {
+      const auto * transaction_messages = transaction.get_messages();
+      for (uint32_t i = 0; i < transaction.get_message_count(); i++) {
+        if (!merge(transaction_messages[i].addr)) {
+          return NO_DEVICE;
+        }
+      }
+    }
+    return address;
+  }
+
+  void bind_messages()
+  {
+    if constexpr (std::is_same_v<std::decay_t<TransactionT>, I2CTransaction>) {
+      auto & segments = transaction.getSegments();
+      message_buffer.reserve(segments.size());
+      for (auto & segment : segments) {
+        message_buffer.push_back(i2c_msg{segment->get_address(), segment->get_message_flags(),
+            segment->get_data_size(), segment->get_data()});
+      }
+      messages = message_buffer.data();
+      message_count = static_cast<uint32_t>(message_buffer.size());
+    } else {
+      messages = transaction.get_messages();
+      message_count = transaction.get_message_count();
+    }
+  }
+
+  TransactionT transaction;
+  CallbackT callback;
+
+  // progress of a sliced transaction
+  std::vector<i2c_msg> message_buffer;
+  i2c_msg * messages{nullptr};
+  uint32_t message_count{0};
+  uint32_t sent_messages{0};
+
+  uint16_t device_address{NO_DEVICE};
+  bool device_address_known{false};
+};
+
+/**
+ * Counters of an I2CAsyncEngine since it was started.
+ */
+struct I2CAsyncEngineStatistics
+{
+  uint64_t completed{0};  // requests executed without errors
+  uint64_t failed{0};     // requests whose execution threw
+  std::chrono::nanoseconds busy_time{0};  // time spent executing requests
+  uint64_t ack_polls{0};  // zero-length writes sent to devices in their write cycle
+
+  // requests that completed after their deadline, per priority class
+  std::array<uint64_t, I2CPriorityClass::PRIORITY_CLASS_COUNT> deadline_misses{};
+};
+
+/**
+ * Executes transactions for a single adapter on a dedicated I/O thread.
+ *
+ * Submitting never blocks on the bus: requests are pushed to a lock-free queue and the caller is
+ * notified through a future or a callback once the transaction has been executed.
+ * Requests run by priority class, then earliest deadline first, then in submission order; sliced
+ * requests can be preempted between slices (see I2CSchedulingParameters).
+ * Requests with a write cycle time mark their device busy: it is ACK polled between the other
+ * requests, and the requests for it wait until it answers without blocking the rest of the bus.
+ * Failed transfers are retried following the retry policy of their priority class, which starts
+ * as the default single attempt (see set_retry_policy); backoffs run on the I/O thread, so the
+ * retry budget of a class also bounds how long its failures can delay more urgent requests.
+ * Callbacks run on the I/O thread and must not throw.
+ */
+class I2CAsyncEngine {
+public:
+  // minimum time between two ACK polls of a busy device
+  static constexpr std::chrono::microseconds ACK_POLL_INTERVAL{100};
+
+  I2CAsyncEngine() = delete;
+  I2CAsyncEngine(uint16_t i2c_addr, std::string i2c_adapter_path = "/dev/i2c-1");
+  I2CAsyncEngine(std::string i2c_adapter_path);
+  I2CAsyncEngine(
+    uint16_t i2c_addr, std::unique_ptr<I2CBackend> backend,
+    std::string i2c_adapter_path = "/dev/i2c-1");
+  I2CAsyncEngine(std::unique_ptr<I2CBackend> backend, std::string i2c_adapter_path = "/dev/i2c-1");
+
+  /**
+   * Execute the pending requests and stop the I/O thread.
+   */
+  ~I2CAsyncEngine();
+
+  I2CAsyncEngine(const I2CAsyncEngine &) = delete;
+  I2CAsyncEngine & operator=(const I2CAsyncEngine &) = delete;
+
+  /**
+   * Get I2C adapter functionality, queried once when the adapter was opened.
+   */
+  [[nodiscard]] uint64_t get_adapter_func() const {return adapter_func;}
+
+  [[nodiscard]] bool has_functionality(uint64_t flag) const
+  {
+    return (adapter_func & flag) > 0;
+  }
+
+  /**
+   * Number of requests submitted but not yet executed.
+   */
+  [[nodiscard]] std::size_t get_queue_depth() const
+  {
+    return pending.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Read the counters, can be called from any thread.
+   */
+  [[nodiscard]] I2CAsyncEngineStatistics get_statistics() const
+  {
+    I2CAsyncEngineStatistics statistics;
+    statistics.completed = completed.load(std::memory_order_relaxed);
+    statistics.failed = failed.load(std::memory_order_relaxed);
+    statistics.busy_time = std::chrono::nanoseconds{busy_ns.load(std::memory_order_relaxed)};
+    statistics.ack_polls = ack_polls.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < deadline_misses.size(); i++) {
+      statistics.deadline_misses[i] = deadline_misses[i].load(std::memory_order_relaxed);
+    }
+    return statistics;
+  }
+
+  /**
+   * Start or stop collecting the latency histograms and counters of the handler used by the
+   * I/O thread, see I2CHandler::enable_statistics. Can be called from any thread.
+   */
+  void enable_handler_statistics(bool enable = true) {handler->enable_statistics(enable);}
+  [[nodiscard]] I2CHandlerStatistics get_handler_statistics() const
+  {
+    return handler->get_statistics();
+  }
+
+  /**
+   * Retry policy of the requests of a priority class that do not bring their own, taken into
+   * account from the next request on. Can be called from any thread.
+   * Every class starts with the default I2CRetryPolicy, use I2CRetryPolicy::for_priority to opt
+   * into limits per class; classes with different adapter limits cost two ioctls on every switch
+   * between them, and the limits apply to every user of the adapter.
+   */
+  void set_retry_policy(I2CPriorityClass priority, const I2CRetryPolicy & policy);
+  [[nodiscard]] I2CRetryPolicy get_retry_policy(I2CPriorityClass priority) const;
+
+  /**
+   * Queue a transaction and call callback(std::exception_ptr) on the I/O thread once it has been
+   * executed. I2CTransaction must be moved in, other transactions may be passed by reference and
+   * must then outlive the request.
+   */
+  template<typename TransactionT, typename CallbackT>
+  auto submit(TransactionT && transaction, CallbackT && callback)
+  -> std::enable_if_t<std::is_invocable_v<CallbackT &, std::exception_ptr>>
+  {
+    submit(I2CSchedulingParameters{}, std::forward<TransactionT>(transaction),
+      std::forward<CallbackT>(callback));
+  }
+
+  template<typename TransactionT, typename CallbackT>
+  void submit(
+    const I2CSchedulingParameters & scheduling, TransactionT && transaction,
+    CallbackT && callback)
+  {
+    using RequestT = I2CAsyncTransactionRequest<TransactionT, std::decay_t<CallbackT>>;
+    auto request = std::make_unique<RequestT>(std::forward<TransactionT>(transaction),
+        std::forward<CallbackT>(callback));
+    request->scheduling = scheduling;
+    post(std::move(request));
+  }
+
+  /**
+   * Queue a transaction, the future is ready once it has been executed and holds its error, if any.
+   */
+  template<typename TransactionT>
+  [[nodiscard]] std::future<void> submit(TransactionT && transaction)
+  {
+    return submit(I2CSchedulingParameters{}, std::forward<TransactionT>(transaction));
+  }
+
+  template<typename TransactionT>
+  [[nodiscard]] std::future<void> submit(
+    const I2CSchedulingParameters & scheduling,
+    TransactionT && transaction)
+  {
+    std::promise<void> promise;
+    auto future = promise.get_future();
+    submit(scheduling, std::forward<TransactionT>(transaction),
+      [promise = std::move(promise)](std::exception_ptr error) mutable {
+        if (error) {
+          promise.set_exception(std::move(error));
+        } else {
+          promise.set_value();
+        }
+      });
+    return future;
+  }
+
+  /**
+   * Queue a custom request, e.g. one that applies several transactions back to back.
+   */
+  void post(std::unique_ptr<I2CAsyncRequest> request);
+
+private:
+  void run();
+
+  /**
+   * Move the queued requests to the ready heap.
+   */
+  void collect_requests();
+
+  /**
+   * Run the most urgent ready request, or its next slice.
+   * A request for a busy device is held back instead.
+   */
+  void execute_next();
+
+  /**
+   * Poll the busy devices that are due, and release the requests of those that answer.
+   */
+  void poll_busy_devices();
+
+  /**
+   * Sleep until the next busy device is due or a request comes in.
+   */
+  void wait_for_busy_devices();
+
+  [[nodiscard]] bool is_busy(uint16_t device_address) const;
+
+  // ordering of the ready heap, the most urgent request on top
+  struct RequestOrder
+  {
+    bool operator()(
+      const std::unique_ptr<I2CAsyncRequest> & a,
+      const std::unique_ptr<I2CAsyncRequest> & b) const
+    {
+      if (a->scheduling.priority != b->scheduling.priority) {
+        return a->scheduling.priority > b->scheduling.priority;
+      }
+      if (a->scheduling.deadline != b->scheduling.deadline) {
+        return a->scheduling.deadline > b->scheduling.deadline;
+      }
+      return a->sequence > b->sequence;
+    }
+  };
+
+  // device in its write cycle
+  struct BusyDevice
+  {
+    uint16_t device_address;
+    std::chrono::steady_clock::time_point ready_time;  // end of the worst case write cycle
+    std::chrono::steady_clock::time_point next_poll;
+  };
+
+  // only used by the I/O thread once it has started
+  std::unique_ptr<ThreadUnsafeI2CHandler> handler;
+  uint64_t adapter_func{0};
+
+  // cleared if the adapter can neither send zero-length messages nor quick writes, busy devices
+  // then wait the whole cycle
+  bool ack_polling{true};
+
+  // retry policies set by the users, copied by the I/O thread when they change
+  mutable std::mutex retry_policy_mutex;
+  std::array<I2CRetryPolicy, I2CPriorityClass::PRIORITY_CLASS_COUNT> retry_policies;
+  std::atomic<bool> retry_policies_changed{true};
+
+  // only used by the I/O thread
+  std::array<I2CRetryPolicy, I2CPriorityClass::PRIORITY_CLASS_COUNT> active_retry_policies;
+
+  MPSCQueue queue;
+  alignas(64) std::atomic<std::size_t> pending{0};
+
+  // only written by the I/O thread
+  alignas(64) std::atomic<uint64_t> completed{0};
+  std::atomic<uint64_t> failed{0};
+  std::atomic<int64_t> busy_ns{0};
+  std::atomic<uint64_t> ack_polls{0};
+  std::array<std::atomic<uint64_t>, I2CPriorityClass::PRIORITY_CLASS_COUNT> deadline_misses{};
+
+  // requests taken from the queue, only used by the I/O thread
+  std::vector<std::unique_ptr<I2CAsyncRequest>> ready;
+  uint64_t next_sequence{0};
+
+  // requests waiting for their device to finish its write cycle, only used by the I/O thread
+  std::vector<BusyDevice> busy_devices;
+  std::vector<std::unique_ptr<I2CAsyncRequest>> held;
+
+  // the I/O thread only parks when there is nothing to do, producers only lock to wake it up
+  std::atomic<bool> sleeping{false};
+  std::atomic<bool> stopping{false};
+  std::mutex wakeup_mutex;
+  std::condition_variable wakeup;
+
+  std::thread io_thread;
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP_ASYNC_ENGINE_HPP_
@@ -0,0 +1,88 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP__BACKEND__I2C_BACKEND_HPP_
+#define ROS2_I2CCPP__BACKEND__I2C_BACKEND_HPP_
+#pragma once
+
+extern "C"
+{
+#include <linux/i2c.h>
+}
+
+#include <cstdint>
+#include <string>
+
+namespace ros2_i2ccpp
+{
+
+/**
+ * Transport used by I2CHandlerImpl to reach an I2C adapter.
+ *
+ * Every operation mirrors the syscall it replaces: it returns a negative value on failure and
+ * leaves the reason in errno, so callers can keep reporting errors through SysException.
+ */
+class I2CBackend {
+public:
+  virtual ~I2CBackend() = default;
+
+  /**
+   * Open the adapter found at the given path.
+   */
+  virtual int open(const std::string & i2c_adapter_path) = 0;
+
+  /**
+   * Close the adapter, it can be opened again afterwards.
+   */
+  virtual int close() = 0;
+
+  [[nodiscard]] virtual bool is_opened() const = 0;
+
+  /**
+   * Query the adapter functionality (I2C_FUNCS), see I2CControllerFunctionalityFlags.
+   */
+  virtual int get_functionality(uint64_t & adapter_func) = 0;
+
+  /**
+   * Set the slave address used by the SMBus operations (I2C_SLAVE).
+   */
+  virtual int set_slave_address(uint16_t i2c_addr) = 0;
+
+  /**
+   * Enable or disable 10-bit addressing for the SMBus operations (I2C_TENBIT).
+   */
+  virtual int set_ten_bit(bool enable) = 0;
+
+  /**
+   * Enable or disable SMBus Packet Error Checking (I2C_PEC).
+   */
+  virtual int set_pec(bool enable) = 0;
+
+  /**
+   * Set how many times the adapter driver repeats a transfer that lost arbitration (I2C_RETRIES).
+   */
+  virtual int set_retries(uint32_t retries) = 0;
+
+  /**
+   * Set how long the adapter driver waits for a transfer, in 10 ms units (I2C_TIMEOUT).
+   */
+  virtual int set_timeout(uint32_t timeout) = 0;
+
+  /**
+   * Execute a combined read/write transfer (I2C_RDWR).
+   */
+  virtual int transfer(i2c_msg * messages, uint32_t message_count) = 0;
+
+  /**
+   * Execute a single SMBus protocol operation on the current slave address (I2C_SMBUS).
+   */
+  virtual int smbus_access(
+    uint8_t read_write, uint8_t command, uint32_t size,
+    i2c_smbus_data * data) = 0;
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP__BACKEND__I2C_BACKEND_HPP_
@@ -0,0 +1,59 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP__BACKEND__I2C_DEV_BACKEND_HPP_
+#define ROS2_I2CCPP__BACKEND__I2C_DEV_BACKEND_HPP_
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "ros2_i2ccpp/backend/i2c_backend.hpp"
+
+namespace ros2_i2ccpp
+{
+
+/**
+ * Backend that talks to a Linux i2c-dev character device (/dev/i2c-N).
+ */
+class I2CDevBackend : public I2CBackend {
+public:
+  I2CDevBackend() = default;
+  ~I2CDevBackend() override;
+
+  I2CDevBackend(const I2CDevBackend &) = delete;
+  I2CDevBackend & operator=(const I2CDevBackend &) = delete;
+
+  int open(const std::string & i2c_adapter_path) override;
+  int close() override;
+
+  [[nodiscard]] bool is_opened() const override {return i2c_file_desc != INVALID_FILE_DESC;}
+
+  int get_functionality(uint64_t & adapter_func) override;
+  int set_slave_address(uint16_t i2c_addr) override;
+  int set_ten_bit(bool enable) override;
+  int set_pec(bool enable) override;
+  int set_retries(uint32_t retries) override;
+  int set_timeout(uint32_t timeout) override;
+  int transfer(i2c_msg * messages, uint32_t message_count) override;
+  int smbus_access(
+    uint8_t read_write, uint8_t command, uint32_t size,
+    i2c_smbus_data * data) override;
+
+  /**
+   * File descriptor of the adapter, for callers that need to poll or inspect it.
+   */
+  [[nodiscard]] int32_t get_file_descriptor() const {return i2c_file_desc;}
+
+private:
+  static constexpr int32_t INVALID_FILE_DESC = -1;
+
+  // file descriptor to the i2c adapter/controller
+  int32_t i2c_file_desc{INVALID_FILE_DESC};
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP__BACKEND__I2C_DEV_BACKEND_HPP_
@@ -0,0 +1,70 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP__BACKEND__RECORDING_I2C_BACKEND_HPP_
+#define ROS2_I2CCPP__BACKEND__RECORDING_I2C_BACKEND_HPP_
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "ros2_i2ccpp/backend/i2c_backend.hpp"
+#include "ros2_i2ccpp/traffic_log.hpp"
+
+namespace ros2_i2ccpp
+{
+
+/**
+ * Backend that forwards every operation to another backend and records the transfers, SMBus
+ * operations and adapter state changes into a traffic log, with their timing and result.
+ *
+ * Recording copies the messages and payloads under the recorder lock, which costs a few hundred
+ * nanoseconds per transfer; the file is only written when the staging buffer fills up.
+ */
+class RecordingI2CBackend : public I2CBackend {
+public:
+  RecordingI2CBackend(
+    std::unique_ptr<I2CBackend> backend_,
+    std::shared_ptr<I2CTrafficRecorder> recorder_);
+
+  RecordingI2CBackend(const RecordingI2CBackend &) = delete;
+  RecordingI2CBackend & operator=(const RecordingI2CBackend &) = delete;
+
+  int open(const std::string & i2c_adapter_path) override;
+  int close() override;
+
+  [[nodiscard]] bool is_opened() const override {return backend->is_opened();}
+
+  int get_functionality(uint64_t & adapter_func) override;
+  int set_slave_address(uint16_t i2c_addr) override;
+  int set_ten_bit(bool enable) override;
+  int set_pec(bool enable) override;
+  int set_retries(uint32_t retries) override;
+  int set_timeout(uint32_t timeout) override;
+  int transfer(i2c_msg * messages, uint32_t message_count) override;
+  int smbus_access(
+    uint8_t read_write, uint8_t command, uint32_t size,
+    i2c_smbus_data * data) override;
+
+  [[nodiscard]] I2CBackend & get_backend() {return *backend;}
+
+private:
+  template<typename Operation>
+  int record_control(uint64_t command, uint64_t value, Operation && operation);
+
+  const std::unique_ptr<I2CBackend> backend;
+  const std::shared_ptr<I2CTrafficRecorder> recorder;
+
+  // id given by the recorder on the last open
+  uint16_t adapter{0};
+
+  // slave address of the SMBus operations, which the log keeps along with each of them
+  uint16_t slave_address{0};
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP__BACKEND__RECORDING_I2C_BACKEND_HPP_
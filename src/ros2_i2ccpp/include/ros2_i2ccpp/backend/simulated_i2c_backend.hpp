@@ -0,0 +1,259 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP__BACKEND__SIMULATED_I2C_BACKEND_HPP_
+#define ROS2_I2CCPP__BACKEND__SIMULATED_I2C_BACKEND_HPP_
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ros2_i2ccpp/backend/i2c_backend.hpp"
+#include "ros2_i2ccpp/constants.hpp"
+
+namespace ros2_i2ccpp
+{
+
+/**
+ * Standard I2C bus speeds, in Hz.
+ */
+enum SimulatedBusSpeed: uint32_t
+{
+  STANDARD_MODE = 100'000,
+  FAST_MODE = 400'000,
+  FAST_MODE_PLUS = 1'000'000
+};
+
+/**
+ * Timing model of a simulated bus.
+ *
+ * Each byte takes 9 clock cycles (8 data bits and the ACK), each message pays for a START
+ * (or repeated START) and its address byte(s), and each transfer ends with a STOP.
+ */
+struct SimulatedBusTiming
+{
+  uint32_t bus_speed_hz{SimulatedBusSpeed::FAST_MODE};
+
+  // START/repeated START setup and hold time
+  std::chrono::nanoseconds start_overhead{1'200};
+
+  // STOP setup time and bus free time before the next START
+  std::chrono::nanoseconds stop_overhead{1'900};
+
+  // fixed cost per transfer, e.g. to model the driver and syscall latency
+  std::chrono::nanoseconds transfer_overhead{0};
+
+  // block the caller for the modeled duration of each transfer
+  // if disabled, the bus time is only accounted in the statistics
+  bool real_time{true};
+
+  /**
+   * Timing with the START/STOP overheads given by the I2C specification for the given speed.
+   */
+  [[nodiscard]] static SimulatedBusTiming for_speed(uint32_t bus_speed_hz, bool real_time = true);
+
+  [[nodiscard]] std::chrono::nanoseconds byte_time() const
+  {
+    return std::chrono::nanoseconds{9'000'000'000ULL / bus_speed_hz};
+  }
+};
+
+/**
+ * Counters collected by a simulated bus.
+ */
+struct SimulatedBusStatistics
+{
+  uint64_t transfers{0};
+  uint64_t messages{0};
+  uint64_t bytes_written{0};
+  uint64_t bytes_read{0};
+  uint64_t naks{0};
+  std::chrono::nanoseconds busy_time{0};
+};
+
+/**
+ * In-memory model of an I2C device with a register file.
+ *
+ * The first bytes of each write select the register pointer (big endian), the remaining bytes are
+ * written starting at that register, and reads return the registers starting at the pointer.
+ * The pointer auto-increments and wraps around the register file.
+ * Block reads (M_RECV_LEN) take the block length from the register at the pointer.
+ *
+ * Override the virtual methods to model devices with other behavior.
+ */
+class SimulatedI2CDevice {
+public:
+  explicit SimulatedI2CDevice(uint32_t register_count = 256, uint8_t register_address_width = 1);
+  virtual ~SimulatedI2CDevice() = default;
+
+  /**
+   * Called when the device is addressed after a START, returning false NAKs the address.
+   */
+  virtual bool on_start(bool read);
+
+  /**
+   * Called with the bytes written by the master, returning false NAKs the data.
+   */
+  virtual bool on_write(const uint8_t * data, uint32_t size);
+
+  /**
+   * Called to fill the bytes read by the master.
+   */
+  virtual void on_read(uint8_t * data, uint32_t size);
+
+  /**
+   * Called when a STOP ends the communication with this device.
+   */
+  virtual void on_stop() {}
+
+  [[nodiscard]] std::vector<uint8_t> & get_registers() {return registers;}
+  [[nodiscard]] uint32_t get_register_pointer() const {return register_pointer;}
+
+protected:
+  // register file of the device
+  std::vector<uint8_t> registers;
+
+  // number of bytes used to select a register
+  uint8_t register_address_width;
+
+  // register that will be accessed next
+  uint32_t register_pointer{0};
+
+  // address bytes received since the last START
+  uint8_t received_address_bytes{0};
+};
+
+/**
+ * Model of a memory device such as an EEPROM.
+ *
+ * Writes wrap around within the page holding the first written byte, and once a STOP ends a
+ * write, the device stores the page during the write cycle time and NAKs its address meanwhile.
+ * The write cycle runs on the wall clock, also on buses that are not real time.
+ */
+class SimulatedMemoryDevice : public SimulatedI2CDevice {
+public:
+  SimulatedMemoryDevice(
+    uint32_t size, uint8_t register_address_width = 2, uint32_t page_size_ = 64,
+    std::chrono::nanoseconds write_cycle_time_ = std::chrono::milliseconds{5});
+
+  bool on_start(bool read) override;
+  bool on_write(const uint8_t * data, uint32_t size) override;
+  void on_stop() override;
+
+  [[nodiscard]] bool is_busy() const {return std::chrono::steady_clock::now() < busy_until;}
+
+private:
+  uint32_t page_size;
+  std::chrono::nanoseconds write_cycle_time;
+
+  // data was written since the last STOP, so a write cycle starts on the next one
+  bool page_written{false};
+  std::chrono::steady_clock::time_point busy_until{};
+};
+
+/**
+ * A simulated I2C bus shared by all the backends (i.e. file descriptors) that open it.
+ */
+class SimulatedI2CBus {
+public:
+  static constexpr uint64_t DEFAULT_ADAPTER_FUNC =
+    I2CControllerFunctionalityFlags::FUNC_I2C | I2CControllerFunctionalityFlags::FUNC_10BIT_ADDR |
+    I2CControllerFunctionalityFlags::FUNC_PROTOCOL_MANGLING |
+    I2CControllerFunctionalityFlags::FUNC_NOSTART |
+    I2CControllerFunctionalityFlags::FUNC_SMBUS_EMUL_ALL;
+
+  explicit SimulatedI2CBus(
+    SimulatedBusTiming timing_ = {},
+    uint64_t adapter_func_ = DEFAULT_ADAPTER_FUNC);
+
+  /**
+   * Attach a device to the bus, replacing any device at the same address.
+   */
+  void attach_device(uint16_t i2c_addr, std::shared_ptr<SimulatedI2CDevice> device);
+  void detach_device(uint16_t i2c_addr);
+  [[nodiscard]] std::shared_ptr<SimulatedI2CDevice> get_device(uint16_t i2c_addr) const;
+
+  /**
+   * Execute the messages as a combined transfer, with the semantics of I2C_RDWR.
+   */
+  int transfer(i2c_msg * messages, uint32_t message_count);
+
+  /**
+   * Modeled duration of a combined transfer on this bus.
+   */
+  [[nodiscard]] std::chrono::nanoseconds get_transfer_time(
+    const i2c_msg * messages,
+    uint32_t message_count) const;
+
+  [[nodiscard]] uint64_t get_adapter_func() const {return adapter_func;}
+  [[nodiscard]] const SimulatedBusTiming & get_timing() const {return timing;}
+  [[nodiscard]] SimulatedBusStatistics get_statistics() const;
+  void reset_statistics();
+
+private:
+  const SimulatedBusTiming timing;
+  const uint64_t adapter_func;
+
+  // held for the whole transfer, as the bus can only carry one transfer at a time
+  mutable std::mutex mut;
+
+  std::map<uint16_t, std::shared_ptr<SimulatedI2CDevice>> devices;
+  SimulatedBusStatistics statistics;
+};
+
+/**
+ * Backend that serves I2C_RDWR and SMBus operations from a simulated bus.
+ * SMBus operations are emulated with I2C messages; PEC can be enabled but is not sent on the bus.
+ */
+class SimulatedI2CBackend : public I2CBackend {
+public:
+  explicit SimulatedI2CBackend(std::shared_ptr<SimulatedI2CBus> bus_);
+
+  int open(const std::string & i2c_adapter_path) override;
+  int close() override;
+
+  [[nodiscard]] bool is_opened() const override {return opened;}
+
+  int get_functionality(uint64_t & adapter_func) override;
+  int set_slave_address(uint16_t i2c_addr) override;
+  int set_ten_bit(bool enable) override;
+  int set_pec(bool enable) override;
+  int set_retries(uint32_t retries) override;
+  int set_timeout(uint32_t timeout) override;
+  int transfer(i2c_msg * messages, uint32_t message_count) override;
+  int smbus_access(
+    uint8_t read_write, uint8_t command, uint32_t size,
+    i2c_smbus_data * data) override;
+
+  [[nodiscard]] SimulatedI2CBus & get_bus() {return *bus;}
+
+  /**
+   * Adapter limits last set on this backend, they do not change the simulation.
+   */
+  [[nodiscard]] uint32_t get_retries() const {return retries;}
+  [[nodiscard]] uint32_t get_timeout() const {return timeout;}
+
+private:
+  std::shared_ptr<SimulatedI2CBus> bus;
+  bool opened{false};
+
+  // state of the file descriptor
+  uint16_t slave_addr{0};
+  bool ten_bit{false};
+  bool pec{false};
+
+  // defaults of most adapter drivers, no retries and a 1 s timeout
+  uint32_t retries{0};
+  uint32_t timeout{100};
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP__BACKEND__SIMULATED_I2C_BACKEND_HPP_
@@ -0,0 +1,266 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP_BULK_TRANSFER_HPP_
+#define ROS2_I2CCPP_BULK_TRANSFER_HPP_
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+
+#include "ros2_i2ccpp/async_engine.hpp"
+#include "ros2_i2ccpp/constants.hpp"
+#include "ros2_i2ccpp/i2c_handler.hpp"
+
+namespace ros2_i2ccpp
+{
+
+/**
+ * Layout of a memory device (EEPROM, FRAM, ...) accessed through I2CBulkTransfer.
+ */
+struct I2CMemoryGeometry
+{
+  uint16_t device_address{0x50};
+  uint32_t size{0};        // bytes in the memory
+  uint16_t page_size{1};   // writes never cross a page boundary
+  I2CRegisterOffsetFormat offset_format{I2CRegisterOffsetFormat::OFFSET_16BIT_BE};
+
+  // worst case time the device needs to store a page, during which it NAKs its address
+  std::chrono::nanoseconds write_cycle_time{std::chrono::milliseconds{5}};
+};
+
+/**
+ * Outcome of a bulk read or write.
+ */
+struct I2CBulkTransferResult
+{
+  std::size_t bytes{0};
+  uint32_t transfers{0};
+  std::chrono::nanoseconds duration{0};
+
+  [[nodiscard]] double get_bytes_per_second() const
+  {
+    return duration.count() > 0 ?
+           static_cast<double>(bytes) * 1e9 / static_cast<double>(duration.count()) : 0.0;
+  }
+};
+
+/**
+ * Data written to a device by a bulk transfer.
+ */
+class I2CBulkSource {
+public:
+  virtual ~I2CBulkSource() = default;
+
+  /**
+   * Copy up to size bytes into data, returns the number of bytes copied, 0 once exhausted.
+   */
+  virtual std::size_t read(uint8_t * data, std::size_t size) = 0;
+};
+
+/**
+ * Destination of the data read by a bulk transfer.
+ */
+class I2CBulkSink {
+public:
+  virtual ~I2CBulkSink() = default;
+
+  /**
+   * Store the next size bytes.
+   */
+  virtual void write(const uint8_t * data, std::size_t size) = 0;
+};
+
+/**
+ * Source and sink over caller memory, e.g. a buffer or an I2CMappedFile.
+ */
+class I2CMemorySource : public I2CBulkSource {
+public:
+  I2CMemorySource(const uint8_t * data_, std::size_t size_)
+  : data(data_), size(size_) {}
+
+  std::size_t read(uint8_t * out, std::size_t max_size) override;
+
+private:
+  const uint8_t * data;
+  std::size_t size;
+  std::size_t position{0};
+};
+
+class I2CMemorySink : public I2CBulkSink {
+public:
+  I2CMemorySink(uint8_t * data_, std::size_t size_)
+  : data(data_), size(size_) {}
+
+  /**
+   * Throws if more data arrives than the memory can hold.
+   */
+  void write(const uint8_t * in, std::size_t in_size) override;
+
+private:
+  uint8_t * data;
+  std::size_t size;
+  std::size_t position{0};
+};
+
+/**
+ * Source and sink over a file descriptor (file, pipe, socket), which is not owned.
+ */
+class I2CFileSource : public I2CBulkSource {
+public:
+  explicit I2CFileSource(int file_desc_)
+  : file_desc(file_desc_) {}
+
+  std::size_t read(uint8_t * data, std::size_t size) override;
+
+private:
+  int file_desc;
+};
+
+class I2CFileSink : public I2CBulkSink {
+public:
+  explicit I2CFileSink(int file_desc_)
+  : file_desc(file_desc_) {}
+
+  void write(const uint8_t * data, std::size_t size) override;
+
+private:
+  int file_desc;
+};
+
+/**
+ * File mapped in memory, to stream an image from or to disk without intermediate copies.
+ */
+class I2CMappedFile {
+public:
+  /**
+   * Map an existing file for reading.
+   */
+  explicit I2CMappedFile(const std::string & path);
+
+  /**
+   * Map a file for writing, created or resized to the given size.
+   */
+  I2CMappedFile(const std::string & path, std::size_t size_);
+
+  ~I2CMappedFile();
+
+  I2CMappedFile(const I2CMappedFile &) = delete;
+  I2CMappedFile & operator=(const I2CMappedFile &) = delete;
+
+  [[nodiscard]] uint8_t * get_data() const {return data;}
+  [[nodiscard]] std::size_t get_size() const {return size;}
+  [[nodiscard]] bool is_writable() const {return writable;}
+
+  [[nodiscard]] I2CMemorySource make_source() const {return I2CMemorySource(data, size);}
+
+  /**
+   * Sink storing the data read into the file, throws if the file was mapped for reading.
+   */
+  [[nodiscard]] I2CMemorySink make_sink() const;
+
+private:
+  void map(int file_desc);
+
+  uint8_t * data{nullptr};
+  std::size_t size{0};
+  bool writable{false};
+};
+
+/**
+ * Streams large blocks of data to and from a memory device.
+ *
+ * Writes are split at page boundaries, one page per transfer, and the device is ACK polled after
+ * each page so that the next one goes out as soon as the page is stored rather than after the
+ * worst case write cycle time. Writes submitted to an I2CAsyncEngine let the engine use the bus
+ * for other devices during the write cycles, so flashing several memories on the same bus
+ * overlaps. Reads set the address once and then continue with sequential reads as large as the
+ * staging buffer. Data only goes through the staging buffer, so memory use is bounded regardless
+ * of the transfer size.
+ *
+ * Memories larger than the offset format can address take the upper address bits in the low bits
+ * of the device address, as 24C04-24C16 and 24CM01/02 EEPROMs do.
+ */
+class I2CBulkTransfer {
+public:
+  static constexpr std::size_t DEFAULT_STAGING_SIZE = 4096;
+
+  I2CBulkTransfer(I2CMemoryGeometry geometry_, std::size_t staging_size = DEFAULT_STAGING_SIZE);
+
+  [[nodiscard]] const I2CMemoryGeometry & get_geometry() const {return geometry;}
+
+  /**
+   * Read size bytes starting at the given memory address into the sink.
+   */
+  template<typename Mutex>
+  I2CBulkTransferResult read(
+    const I2CHandler<Mutex> & handler, uint32_t address,
+    I2CBulkSink & sink, std::size_t size);
+
+  /**
+   * Write the whole source to memory starting at the given address.
+   */
+  template<typename Mutex>
+  I2CBulkTransferResult write(
+    const I2CHandler<Mutex> & handler, uint32_t address,
+    I2CBulkSource & source);
+
+  /**
+   * Queue a write of the whole source on the engine, one page per slice.
+   * The bulk transfer and the source must outlive the request, and only one request can use the
+   * bulk transfer at a time.
+   */
+  [[nodiscard]] std::future<I2CBulkTransferResult> submit_write(
+    I2CAsyncEngine & engine, uint32_t address, I2CBulkSource & source,
+    I2CPriorityClass priority = I2CPriorityClass::PRIORITY_BULK);
+
+private:
+  class WriteRequest;
+
+  /**
+   * Write the next page from the source, returns false once the source is exhausted.
+   */
+  template<typename Mutex>
+  bool write_page(
+    const I2CHandler<Mutex> & handler, uint32_t address,
+    I2CBulkSource & source, I2CBulkTransferResult & result);
+
+  /**
+   * Wait until the device stores the page written at the given time.
+   */
+  template<typename Mutex>
+  void wait_write_cycle(
+    const I2CHandler<Mutex> & handler, uint16_t device_address,
+    std::chrono::steady_clock::time_point write_time) const;
+
+  /**
+   * Device address and encoded offset of a memory address, returns the offset size.
+   */
+  std::size_t locate(uint32_t address, uint16_t & device_address, uint8_t * offset) const;
+
+  /**
+   * Device address holding a memory address.
+   */
+  [[nodiscard]] uint16_t get_device_address(uint32_t address) const;
+
+  /**
+   * Number of memory bytes reachable with a single device address.
+   */
+  [[nodiscard]] uint32_t get_window_size() const;
+
+  I2CMemoryGeometry geometry;
+
+  // offset followed by the payload of the message in flight
+  std::unique_ptr<uint8_t[]> staging;
+  std::size_t staging_size;
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP_BULK_TRANSFER_HPP_
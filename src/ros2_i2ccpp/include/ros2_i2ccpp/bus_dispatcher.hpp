@@ -0,0 +1,130 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP_BUS_DISPATCHER_HPP_
+#define ROS2_I2CCPP_BUS_DISPATCHER_HPP_
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ros2_i2ccpp/async_engine.hpp"
+#include "ros2_i2ccpp/exceptions.hpp"
+
+namespace ros2_i2ccpp
+{
+
+class I2CBackend;
+
+/**
+ * Load of one bus of an I2CBusDispatcher.
+ */
+struct I2CBusStatistics
+{
+  uint32_t bus{0};
+  std::size_t queue_depth{0};  // requests waiting to be executed
+  I2CAsyncEngineStatistics totals;  // counters since the bus was added
+  double utilization{0.0};  // fraction of the time spent executing, since the previous sample
+};
+
+/**
+ * Owns one I2CAsyncEngine (and I/O thread) per adapter, so that transactions on different buses
+ * run in parallel while transactions on the same bus are serialized.
+ *
+ * Buses and devices must be set up before transactions are submitted; submitting is then safe
+ * from any thread. Transactions are routed either by bus number, or by device address for devices
+ * attached with attach_device.
+ */
+class I2CBusDispatcher {
+public:
+  I2CBusDispatcher() = default;
+
+  I2CBusDispatcher(const I2CBusDispatcher &) = delete;
+  I2CBusDispatcher & operator=(const I2CBusDispatcher &) = delete;
+
+  /**
+   * Open the adapter of the given bus, /dev/i2c-<bus> by default.
+   */
+  I2CAsyncEngine & add_bus(uint32_t bus);
+  I2CAsyncEngine & add_bus(uint32_t bus, std::string i2c_adapter_path);
+
+  /**
+   * Use the given backend to reach the adapter of the given bus.
+   */
+  I2CAsyncEngine & add_bus(
+    uint32_t bus, std::unique_ptr<I2CBackend> backend,
+    std::string i2c_adapter_path);
+
+  /**
+   * Route the transactions for the given device address to the given bus.
+   * An address can only be attached to a single bus.
+   */
+  void attach_device(uint16_t address, uint32_t bus);
+
+  /**
+   * Get the engine of the given bus, throws if the bus was not added.
+   */
+  [[nodiscard]] I2CAsyncEngine & get_bus(uint32_t bus) const;
+
+  /**
+   * Get the bus the given device address was attached to, throws if it was not attached.
+   */
+  [[nodiscard]] uint32_t get_device_bus(uint16_t address) const;
+
+  /**
+   * Submit to the given bus, takes the same arguments as I2CAsyncEngine::submit.
+   */
+  template<typename ... ArgsT>
+  decltype(auto) submit(uint32_t bus, ArgsT &&... args)
+  {
+    return get_bus(bus).submit(std::forward<ArgsT>(args)...);
+  }
+
+  /**
+   * Submit to the bus that the device address was attached to.
+   */
+  template<typename ... ArgsT>
+  decltype(auto) submit_to_device(uint16_t address, ArgsT &&... args)
+  {
+    return get_bus(get_device_bus(address)).submit(std::forward<ArgsT>(args)...);
+  }
+
+  /**
+   * Sample the load of every bus, in bus order.
+   * The utilization covers the time since the previous call, or since the bus was added.
+   */
+  [[nodiscard]] std::vector<I2CBusStatistics> get_statistics();
+
+private:
+  struct Bus
+  {
+    std::unique_ptr<I2CAsyncEngine> engine;
+
+    // last sample, to compute the utilization
+    std::chrono::steady_clock::time_point sample_time;
+    std::chrono::nanoseconds sample_busy_time{0};
+  };
+
+  I2CAsyncEngine & emplace_bus(uint32_t bus, std::unique_ptr<I2CAsyncEngine> engine);
+
+  std::map<uint32_t, Bus> buses;
+  std::unordered_map<uint16_t, uint32_t> device_buses;
+
+  // guards the samples, as statistics may be read from several threads
+  std::mutex statistics_mutex;
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP_BUS_DISPATCHER_HPP_
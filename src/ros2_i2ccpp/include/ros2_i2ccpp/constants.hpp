@@ -13,7 +13,9 @@ namespace ros2_i2ccpp
 enum I2CConstants: int
 {
   I2C_TRANSACTION_IOCTL_MAX_MSGS = 42,
-  SMBUS_BLOCK_MAX = 32
+  I2C_INLINE_TRANSACTION_ARENA_SIZE = 512, // Default payload capacity of an I2CInlineTransaction, in bytes
+  SMBUS_BLOCK_MAX = 32,
+  I2C_MAX_7BIT_ADDRESS = 0x7F // Addresses above this one need 10-bit addressing
 };
 
 /**
@@ -70,9 +72,41 @@ enum I2CMessageFlags: uint64_t
   M_STOP = 0x8000,      // I2C message flag to signal a stop condition even if this is not the last message. The controller must support FUNC_PROTOCOL_MANGLING to use this.
 };
 
+/**
+ * How a register offset is sent ahead of the payload, see encode_register_offset.
+ */
+enum I2CRegisterOffsetFormat: uint8_t
+{
+  OFFSET_8BIT = 0,      // Single byte offset, for devices with up to 256 registers.
+  OFFSET_16BIT_BE = 1,  // Two byte offset, most significant byte first (e.g. 24Cxx EEPROMs).
+  OFFSET_16BIT_LE = 2,  // Two byte offset, least significant byte first.
+};
+
+/**
+ * How the handler selects the device targeted by SMBus operations.
+ */
+enum I2CAddressingMode: uint8_t
+{
+  ADDRESSING_SLAVE_IOCTL = 0,  // Select the device with I2C_SLAVE (and I2C_TENBIT) whenever it changes, then use I2C_SMBUS.
+  ADDRESSING_PER_MESSAGE = 1,  // Encode SMBus operations as I2C_RDWR messages that carry their own address. The controller must support FUNC_I2C to use this.
+};
+
+/**
+ * Priority classes of an I2CAsyncEngine, requests of a lower class always run first.
+ * Retry policies can also be chosen per class, see I2CAsyncEngine::set_retry_policy.
+ */
+enum I2CPriorityClass: uint8_t
+{
+  PRIORITY_REALTIME = 0,  // e.g. IMU reads in a control loop
+  PRIORITY_HIGH = 1,
+  PRIORITY_NORMAL = 2,
+  PRIORITY_BULK = 3,      // e.g. EEPROM or display uploads
+  PRIORITY_CLASS_COUNT = 4
+};
+
 enum I2CIOControlCommands: uint64_t
 {
-  RETRIES = 0x701, // Sets the count of transfer retries in case a slave device does not acknowledge a transaction.
+  RETRIES = 0x701, // Sets how many times the adapter driver repeats a transfer that lost arbitration (-EAGAIN).
   TIMEOUT = 0x702, // Sets the transfer timeout in 10ms units.
   SLAVE = 0x703, // Sets the slave address.
   SLAVE_FORCE = 0x706, // Forces setting the slave address.
@@ -6,10 +6,23 @@
 #ifndef ROS2_I2CCPP__EXCEPTIONS_HPP_
 #define ROS2_I2CCPP__EXCEPTIONS_HPP_
 
+#include <cstdio>
+#include <cstdlib>
 #include <stdexcept>
 #include <errno.h>
+#include <string>
 #include <system_error>
 
+/**
+ * Throw an exception, or report it and abort when built with -fno-exceptions, where the library
+ * is meant to be used through the non-throwing try_ operations.
+ */
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+#define ROS2_I2CCPP_THROW(exception) throw exception
+#else
+#define ROS2_I2CCPP_THROW(exception) ::ros2_i2ccpp::exceptions::abort_with(exception)
+#endif
+
 namespace ros2_i2ccpp::exceptions
 {
 
@@ -45,6 +58,60 @@ class IllegalOperationException : public std::runtime_error
   using runtime_error::runtime_error;
 };
 
+[[noreturn]] inline void abort_with(const std::exception & exception) noexcept
+{
+  std::fprintf(stderr, "ros2_i2ccpp: %s\n", exception.what());
+  std::abort();
+}
+
+/**
+ * Category of the errors found by the handler itself before reaching the adapter, e.g. an adapter
+ * that is not opened or lacks the needed functionality. Values are errno values, which compare
+ * equal to the matching std::errc like the errors reported by the kernel.
+ */
+class PreconditionErrorCategory : public std::error_category
+{
+public:
+  const char * name() const noexcept override {return "ros2_i2ccpp";}
+
+  std::string message(int condition) const override
+  {
+    return std::generic_category().message(condition);
+  }
+
+  std::error_condition default_error_condition(int condition) const noexcept override
+  {
+    return std::error_condition{condition, std::generic_category()};
+  }
+};
+
+inline const std::error_category & precondition_category() noexcept
+{
+  static const PreconditionErrorCategory category;
+  return category;
+}
+
+/**
+ * Throw the exception matching the error of a non-throwing operation: IllegalOperationException
+ * for the checks of the handler (see precondition_category), SysException otherwise, so that
+ * errors reported by the kernel keep their error code.
+ */
+[[noreturn]] inline void throw_error(const std::error_code & error, const std::string & what)
+{
+  if (error.category() != precondition_category()) {
+    ROS2_I2CCPP_THROW(SysException(error, what));
+  }
+
+  switch (error.value()) {
+    case EBADF:
+      ROS2_I2CCPP_THROW(IllegalOperationException("File descriptor is invalid"));
+    case EOPNOTSUPP:
+      ROS2_I2CCPP_THROW(IllegalOperationException("Adapter does not support this operation!"));
+    default:
+      ROS2_I2CCPP_THROW(IllegalOperationException(what + ": " + error.message()));
+  }
+}
+
 } // namespace ros2_i2ccpp::exceptions
 
 #endif //ROS2_I2CCPP__EXCEPTIONS_HPP_
@@ -2,40 +2,69 @@
 #define __I2C_HANDLER_HPP__
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <mutex>
 #include <memory>
 #include <string>
+#include <thread>
 #include <type_traits>
 
 #include "ros2_i2ccpp/constants.hpp"
+#include "ros2_i2ccpp/lock_policy.hpp"
+#include "ros2_i2ccpp/result.hpp"
+#include "ros2_i2ccpp/retry_policy.hpp"
+#include "ros2_i2ccpp/statistics.hpp"
 #include "ros2_i2ccpp/transaction.hpp"
+#include "ros2_i2ccpp/inline_transaction.hpp"
+#include "ros2_i2ccpp/static_transaction.hpp"
+#include "ros2_i2ccpp/prepared_transaction.hpp"
+#include "ros2_i2ccpp/impl/tracing.hpp"
 
 namespace ros2_i2ccpp
 {
 
 class I2CHandlerImpl;
+class I2CBackend;
 
 template<typename Mutex>
 class I2CHandler{
+public:
   I2CHandler() = delete;
   I2CHandler(uint16_t i2c_addr, std::string i2c_adapter_path = "/dev/i2c-1");
   I2CHandler(std::string i2c_adapter_path);
 
+  /**
+    * Use the given backend to reach the adapter, e.g. a SimulatedI2CBackend.
+    */
+  I2CHandler(
+    uint16_t i2c_addr, std::unique_ptr<I2CBackend> backend,
+    std::string i2c_adapter_path = "/dev/i2c-1");
+  I2CHandler(std::unique_ptr<I2CBackend> backend, std::string i2c_adapter_path = "/dev/i2c-1");
+  ~I2CHandler();
+
   /**
     * Get I2C adapter functionality, use I2CControllerFunctionalityFlags constants to check what functionality is supported.
+    * The capability queries never take the handler lock, so they do not wait for transactions.
     */
-  [[nodiscard]] uint64_t get_adapter_func() const;
+  [[nodiscard]] uint64_t get_adapter_func() const {return adapter_func;}
 
   /**
     * Indicate the current I2C device address that is being managed.
     */
-  [[nodiscard]] uint64_t get_current_device_addr() const;
+  [[nodiscard]] uint64_t get_current_device_addr() const
+  {
+    return current_device_addr.load(std::memory_order_acquire);
+  }
 
   /**
     * Check if the adapter has the functionality indicated by that flag or combination of flags.
     */
-  [[nodiscard]] bool has_functionality(uint64_t flag) const;
+  [[nodiscard]] bool has_functionality(uint64_t flag) const
+  {
+    return (adapter_func & flag) > 0;
+  }
 
   /**
     * Check if the adapter has the functionality indicated by these flags
@@ -49,26 +78,356 @@ class I2CHandler{
     return has_functionality((... | flags));
   }
 
+  /**
+    * Every way of applying a transaction has a try_ variant that reports failures through an
+    * I2CResult instead of throwing, e.g. for retry loops on a noisy bus (see I2CResult).
+    * Transactions are retried following the retry policy of the handler, or the one given for that
+    * transaction (see I2CRetryPolicy).
+    */
   void apply_transaction(I2CTransaction && transaction) const;
+  void apply_transaction(I2CTransaction && transaction, const I2CRetryPolicy & policy) const;
+  I2CResult<void> try_apply_transaction(I2CTransaction && transaction) const;
+  I2CResult<void> try_apply_transaction(
+    I2CTransaction && transaction,
+    const I2CRetryPolicy & policy) const;
+
+  /**
+    * Execute an inline transaction, the read results are available once this returns.
+    * The transaction is not consumed and can be executed again.
+    */
+  template<std::size_t ArenaSize>
+  void apply_transaction(I2CInlineTransaction<ArenaSize> & transaction) const
+  {
+    try_apply_transaction(transaction).value("Error executing ioctl request");
+  }
+
+  template<std::size_t ArenaSize>
+  void apply_transaction(
+    I2CInlineTransaction<ArenaSize> & transaction,
+    const I2CRetryPolicy & policy) const
+  {
+    try_apply_transaction(transaction, policy).value("Error executing ioctl request");
+  }
+
+  template<std::size_t ArenaSize>
+  void apply_transaction(I2CInlineTransaction<ArenaSize> && transaction) const
+  {
+    apply_transaction(transaction);
+  }
+
+  template<std::size_t ArenaSize>
+  I2CResult<void> try_apply_transaction(I2CInlineTransaction<ArenaSize> & transaction) const
+  {
+    return try_apply(transaction, nullptr);
+  }
+
+  template<std::size_t ArenaSize>
+  I2CResult<void> try_apply_transaction(
+    I2CInlineTransaction<ArenaSize> & transaction,
+    const I2CRetryPolicy & policy) const
+  {
+    return try_apply(transaction, &policy);
+  }
+
+  /**
+    * Execute a prepared transaction and refresh the objects bound to its read segments.
+    * The transaction is not consumed and can be executed again.
+    */
+  void apply_transaction(I2CPreparedTransaction & transaction) const
+  {
+    try_apply_transaction(transaction).value("Error executing ioctl request");
+  }
+
+  void apply_transaction(
+    I2CPreparedTransaction & transaction,
+    const I2CRetryPolicy & policy) const
+  {
+    try_apply_transaction(transaction, policy).value("Error executing ioctl request");
+  }
+
+  I2CResult<void> try_apply_transaction(I2CPreparedTransaction & transaction) const
+  {
+    return try_apply(transaction, nullptr);
+  }
+
+  I2CResult<void> try_apply_transaction(
+    I2CPreparedTransaction & transaction,
+    const I2CRetryPolicy & policy) const
+  {
+    return try_apply(transaction, &policy);
+  }
+
+  /**
+    * Execute a transaction with a compile-time layout, the read results are available once this
+    * returns.
+    */
+  template<typename ... SegmentsT>
+  void apply_transaction(I2CStaticTransaction<SegmentsT...> & transaction) const
+  {
+    try_apply_transaction(transaction).value("Error executing ioctl request");
+  }
+
+  template<typename ... SegmentsT>
+  void apply_transaction(
+    I2CStaticTransaction<SegmentsT...> & transaction,
+    const I2CRetryPolicy & policy) const
+  {
+    try_apply_transaction(transaction, policy).value("Error executing ioctl request");
+  }
+
+  template<typename ... SegmentsT>
+  I2CResult<void> try_apply_transaction(I2CStaticTransaction<SegmentsT...> & transaction) const
+  {
+    return try_apply(transaction, nullptr);
+  }
+
+  template<typename ... SegmentsT>
+  I2CResult<void> try_apply_transaction(
+    I2CStaticTransaction<SegmentsT...> & transaction,
+    const I2CRetryPolicy & policy) const
+  {
+    return try_apply(transaction, &policy);
+  }
+
+  /**
+    * Execute a contiguous array of messages as a single transaction.
+    * If chunking is allowed, longer transactions are split into several transfers.
+    */
+  void apply_messages(
+    i2c_msg * messages, uint32_t message_count,
+    bool allow_chunking = false) const;
+  I2CResult<void> try_apply_messages(
+    i2c_msg * messages, uint32_t message_count,
+    bool allow_chunking = false) const;
+  I2CResult<void> try_apply_messages(
+    i2c_msg * messages, uint32_t message_count,
+    bool allow_chunking, const I2CRetryPolicy & policy) const;
+
+  /**
+    * Check whether a device acknowledges its address, see I2CHandlerImpl::poll_ack.
+    */
+  [[nodiscard]] bool poll_ack(uint16_t i2c_addr) const;
+  [[nodiscard]] I2CResult<bool> try_poll_ack(uint16_t i2c_addr) const;
 
   /**
     * Set ten bit functionality.
     */
   void set_pec(bool enable);
 
+  /**
+    * Choose how SMBus operations select their device, see I2CAddressingMode.
+    */
+  void set_addressing_mode(I2CAddressingMode mode);
+
+  /**
+    * Retry policy of the transactions applied without one, a single attempt with the driver
+    * defaults unless set.
+    */
+  void set_retry_policy(const I2CRetryPolicy & policy);
+  [[nodiscard]] I2CRetryPolicy get_retry_policy() const;
+
+  /**
+    * Start or stop collecting statistics, see I2CStatisticsRecorder.
+    * They are off by default, and what was collected is kept while they are off.
+    */
+  void enable_statistics(bool enable = true);
+
+  /**
+    * Snapshot of the statistics, can be called from any thread without locking the handler.
+    */
+  [[nodiscard]] I2CHandlerStatistics get_statistics() const;
+
 private:
+  I2CResult<void> try_apply(I2CTransaction && transaction, const I2CRetryPolicy * policy) const;
+
+  template<std::size_t ArenaSize>
+  I2CResult<void> try_apply(
+    I2CInlineTransaction<ArenaSize> & transaction,
+    const I2CRetryPolicy * policy) const
+  {
+    return apply_with_retries(policy, [this, &transaction]() {
+        auto result = transfer(transaction.get_messages(), transaction.get_message_count(), false);
+        if (result) {
+          transaction.complete();
+          ROS2_I2CCPP_TRACEPOINT(segments_decoded, this, 0);
+        }
+        return result;
+      });
+  }
+
+  I2CResult<void> try_apply(
+    I2CPreparedTransaction & transaction,
+    const I2CRetryPolicy * policy) const
+  {
+    // chunks that went out are not sent again by the next attempt
+    uint32_t sent_messages = 0;
+    return apply_with_retries(policy, [this, &transaction, &sent_messages]() -> I2CResult<void> {
+        transaction.rearm(sent_messages);
+        auto result = transfer(transaction.get_messages() + sent_messages,
+          transaction.get_message_count() - sent_messages, transaction.is_chunking_allowed(),
+          &sent_messages);
+        if (!result) {
+          return result;
+        }
+        const auto error = transaction.complete();
+        ROS2_I2CCPP_TRACEPOINT(segments_decoded, this, error);
+        if (error != 0) {
+          return make_i2c_error(error);
+        }
+        return {};
+      });
+  }
+
+  template<typename ... SegmentsT>
+  I2CResult<void> try_apply(
+    I2CStaticTransaction<SegmentsT...> & transaction,
+    const I2CRetryPolicy * policy) const
+  {
+    return apply_with_retries(policy, [this, &transaction]() {
+        return transfer(transaction.get_messages(), transaction.get_message_count(), false);
+      });
+  }
+
+  /**
+    * Run attempt() with the lock held until it succeeds or the retry policy gives up, the policy of
+    * the handler is used if none is given. The lock is released while backing off, so that other
+    * threads can use the bus meanwhile.
+    */
+  template<typename AttemptT>
+  I2CResult<void> apply_with_retries(const I2CRetryPolicy * policy, AttemptT && attempt) const
+  {
+    RecordedLock lock{*this};
+    const auto effective = policy != nullptr ? *policy : retry_policy;
+
+    // only read the clock if there can be a retry
+    std::chrono::steady_clock::time_point first_attempt;
+    if (effective.max_attempts > 1 && effective.retry_budget.count() > 0) {
+      first_attempt = std::chrono::steady_clock::now();
+    }
+
+    for (uint32_t attempt_count = 1; ; attempt_count++) {
+      auto result = set_adapter_limits(effective);
+      if (result) {
+        result = attempt();
+      }
+      if (result || attempt_count >= effective.max_attempts ||
+        !I2CRetryPolicy::is_retryable(result.error().value()))
+      {
+        return result;
+      }
+
+      const auto backoff = effective.get_backoff(attempt_count);
+      if (effective.retry_budget.count() > 0 &&
+        std::chrono::steady_clock::now() + backoff > first_attempt + effective.retry_budget)
+      {
+        return result;
+      }
+
+      lock.unlock();
+      std::this_thread::sleep_for(backoff);
+      lock.lock();
+    }
+  }
+
+  /**
+    * Lock of the handler mutex, timing the wait and how long it is held if statistics are enabled.
+    * The lock_wait, lock_acquired and lock_released tracepoints surround the wait and the release.
+    */
+  class RecordedLock {
+  public:
+    explicit RecordedLock(const I2CHandler & handler_)
+    : handler(handler_)
+    {
+      lock();
+    }
+
+    ~RecordedLock()
+    {
+      if (locked) {
+        unlock();
+      }
+    }
+
+    RecordedLock(const RecordedLock &) = delete;
+    RecordedLock & operator=(const RecordedLock &) = delete;
+
+    void lock()
+    {
+      ROS2_I2CCPP_TRACEPOINT(lock_wait, &handler);
+      recorder = handler.statistics.load(std::memory_order_acquire);
+      if (recorder == nullptr) {
+        handler.mut.lock();
+      } else {
+        const auto start = std::chrono::steady_clock::now();
+        handler.mut.lock();
+        acquired = std::chrono::steady_clock::now();
+        recorder->record_lock_wait(acquired - start);
+      }
+      locked = true;
+      ROS2_I2CCPP_TRACEPOINT(lock_acquired, &handler);
+    }
+
+    void unlock()
+    {
+      // recorded before the release, the shard belongs to this thread either way
+      if (recorder != nullptr) {
+        recorder->record_lock_hold(std::chrono::steady_clock::now() - acquired);
+      }
+      locked = false;
+      handler.mut.unlock();
+      ROS2_I2CCPP_TRACEPOINT(lock_released, &handler);
+    }
+
+  private:
+    const I2CHandler & handler;
+
+    // recorder of the statistics when the lock was taken, so the wait and hold are paired
+    I2CStatisticsRecorder * recorder{nullptr};
+    std::chrono::steady_clock::time_point acquired;
+    bool locked{false};
+  };
+
+  /**
+    * Execute the messages once, the lock must be held.
+    * If given, sent_messages is advanced past the chunks that went out, see
+    * I2CHandlerImpl::try_process_i2c_transaction_chunked.
+    */
+  I2CResult<void> transfer(
+    i2c_msg * messages, uint32_t message_count, bool allow_chunking,
+    uint32_t * sent_messages = nullptr) const;
+
+  /**
+    * Apply the adapter limits of the policy, the lock must be held.
+    */
+  I2CResult<void> set_adapter_limits(const I2CRetryPolicy & policy) const;
+
   mutable Mutex mut;
   std::unique_ptr<I2CHandlerImpl> handler;
-};
 
-struct null_mutex
-{
-  void lock() {}
-  void unlock() {}
+  // the adapter is only opened on construction, so its functionality never changes afterwards
+  const uint64_t adapter_func;
+
+  // copy of the device address of the implementation, updated with the lock held
+  std::atomic<uint64_t> current_device_addr;
+
+  I2CRetryPolicy retry_policy;
+
+  // shards are only allocated by the threads that record, so an idle recorder costs little
+  const std::unique_ptr<I2CStatisticsRecorder> statistics_recorder{
+    std::make_unique<I2CStatisticsRecorder>()};
+
+  // statistics_recorder while statistics are enabled, null otherwise
+  std::atomic<I2CStatisticsRecorder *> statistics{nullptr};
 };
 
 using ThreadSafeI2CHandler = I2CHandler<std::mutex>;
 using ThreadUnsafeI2CHandler = I2CHandler<null_mutex>;
 
+// shared with real-time threads, which should not wait behind preempted lower priority threads
+using PriorityInheritanceI2CHandler = I2CHandler<priority_inheritance_mutex>;
+
+// shared by threads that mostly contend on short critical sections
+using SpinThenParkI2CHandler = I2CHandler<spin_then_park_mutex>;
+
 } // namespace ros2_i2ccpp
 #endif // __I2C_HANDLER_HPP__
@@ -8,12 +8,18 @@ extern "C"
 #include <linux/i2c.h>
 }
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 #include <string>
 #include <bit>
 
+#include "ros2_i2ccpp/constants.hpp"
+#include "ros2_i2ccpp/result.hpp"
+#include "ros2_i2ccpp/retry_policy.hpp"
 #include "ros2_i2ccpp/transaction.hpp"
+#include "ros2_i2ccpp/backend/i2c_backend.hpp"
 
 namespace ros2_i2ccpp
 {
@@ -22,9 +28,17 @@ class I2CHandlerImpl{
 public:
   I2CHandlerImpl(uint16_t i2c_addr, std::string i2c_adapter_path = "/dev/i2c-1");
   I2CHandlerImpl(std::string i2c_adapter_path);
+
+  /**
+   * Use the given backend to reach the adapter, instead of the i2c-dev character device.
+   */
+  I2CHandlerImpl(
+    uint16_t i2c_addr, std::unique_ptr<I2CBackend> backend_,
+    std::string i2c_adapter_path = "/dev/i2c-1");
+  I2CHandlerImpl(std::unique_ptr<I2CBackend> backend_, std::string i2c_adapter_path = "/dev/i2c-1");
   ~I2CHandlerImpl();
 
-  [[nodiscard]] inline bool is_opened() const {return i2c_file_desc != INVALID_FILE_DESC;}
+  [[nodiscard]] inline bool is_opened() const {return backend->is_opened();}
   [[nodiscard]] inline uint64_t get_adapter_func() const {return adapter_func;}
   [[nodiscard]] inline uint64_t get_current_device_addr() const {return cached_i2c_addr;}
   [[nodiscard]] inline bool has_functionality(uint64_t flag) const
@@ -32,57 +46,128 @@ public:
     return (adapter_func & flag) > 0;
   }
 
+  /**
+   * Every operation has a try_ variant that reports failures through an I2CResult instead of
+   * throwing, for retry loops on a noisy bus and for builds without exceptions.
+   * The variants that return vectors only exist as throwing operations, as they allocate anyway.
+   */
   void write_quick(uint8_t value) const;
+  I2CResult<void> try_write_quick(uint8_t value) const;
   inline void write_quick(uint16_t i2c_addr, uint8_t value)
   {
     set_i2c_device(i2c_addr);
     write_quick(value);
   }
-
+  inline I2CResult<void> try_write_quick(uint16_t i2c_addr, uint8_t value)
+  {
+    if (auto selected = try_set_i2c_device(i2c_addr); !selected) {
+      return selected;
+    }
+    return try_write_quick(value);
+  }
 
   [[nodiscard]] uint8_t read_byte() const;
+  [[nodiscard]] I2CResult<uint8_t> try_read_byte() const;
   [[nodiscard]] inline uint8_t read_byte(const uint16_t i2c_addr)
   {
     set_i2c_device(i2c_addr);
     return read_byte();
   }
+  [[nodiscard]] inline I2CResult<uint8_t> try_read_byte(const uint16_t i2c_addr)
+  {
+    if (auto selected = try_set_i2c_device(i2c_addr); !selected) {
+      return selected.error();
+    }
+    return try_read_byte();
+  }
 
   void write_byte(uint8_t value) const;
+  I2CResult<void> try_write_byte(uint8_t value) const;
   inline void write_byte(uint16_t i2c_addr, uint8_t value)
   {
     set_i2c_device(i2c_addr);
     write_byte(value);
   }
+  inline I2CResult<void> try_write_byte(uint16_t i2c_addr, uint8_t value)
+  {
+    if (auto selected = try_set_i2c_device(i2c_addr); !selected) {
+      return selected;
+    }
+    return try_write_byte(value);
+  }
 
   [[nodiscard]] uint8_t read_byte_at(uint16_t register_addr) const;
+  [[nodiscard]] I2CResult<uint8_t> try_read_byte_at(uint16_t register_addr) const;
   [[nodiscard]] inline uint8_t read_byte_at(uint16_t i2c_addr, uint16_t register_addr)
   {
     set_i2c_device(i2c_addr);
     return read_byte_at(register_addr);
   }
+  [[nodiscard]] inline I2CResult<uint8_t> try_read_byte_at(
+    uint16_t i2c_addr,
+    uint16_t register_addr)
+  {
+    if (auto selected = try_set_i2c_device(i2c_addr); !selected) {
+      return selected.error();
+    }
+    return try_read_byte_at(register_addr);
+  }
 
   void write_byte_at(uint16_t register_addr, uint8_t value) const;
+  I2CResult<void> try_write_byte_at(uint16_t register_addr, uint8_t value) const;
   inline void write_byte_at(uint16_t i2c_addr, uint16_t register_addr, uint8_t value)
   {
     set_i2c_device(i2c_addr);
     write_byte_at(register_addr, value);
   }
+  inline I2CResult<void> try_write_byte_at(
+    uint16_t i2c_addr, uint16_t register_addr,
+    uint8_t value)
+  {
+    if (auto selected = try_set_i2c_device(i2c_addr); !selected) {
+      return selected;
+    }
+    return try_write_byte_at(register_addr, value);
+  }
 
   [[nodiscard]] uint16_t read_word(uint16_t register_addr) const;
+  [[nodiscard]] I2CResult<uint16_t> try_read_word(uint16_t register_addr) const;
   [[nodiscard]] inline uint16_t read_word(uint16_t i2c_addr, uint16_t register_addr)
   {
     set_i2c_device(i2c_addr);
     return read_word(register_addr);
   }
+  [[nodiscard]] inline I2CResult<uint16_t> try_read_word(
+    uint16_t i2c_addr,
+    uint16_t register_addr)
+  {
+    if (auto selected = try_set_i2c_device(i2c_addr); !selected) {
+      return selected.error();
+    }
+    return try_read_word(register_addr);
+  }
 
   void write_word(uint16_t register_addr, uint16_t value) const;
+  I2CResult<void> try_write_word(uint16_t register_addr, uint16_t value) const;
   inline void write_word(uint16_t i2c_addr, uint16_t register_addr, uint16_t value)
   {
     set_i2c_device(i2c_addr);
     write_word(register_addr, value);
   }
+  inline I2CResult<void> try_write_word(
+    uint16_t i2c_addr, uint16_t register_addr,
+    uint16_t value)
+  {
+    if (auto selected = try_set_i2c_device(i2c_addr); !selected) {
+      return selected;
+    }
+    return try_write_word(register_addr, value);
+  }
 
   [[nodiscard]] uint16_t process_call(uint16_t register_addr, uint16_t value) const;
+  [[nodiscard]] I2CResult<uint16_t> try_process_call(
+    uint16_t register_addr,
+    uint16_t value) const;
   [[nodiscard]] inline uint16_t process_call(
     uint16_t i2c_addr, uint16_t register_addr,
     uint16_t value)
@@ -90,6 +175,15 @@ public:
     set_i2c_device(i2c_addr);
     return process_call(register_addr, value);
   }
+  [[nodiscard]] inline I2CResult<uint16_t> try_process_call(
+    uint16_t i2c_addr, uint16_t register_addr,
+    uint16_t value)
+  {
+    if (auto selected = try_set_i2c_device(i2c_addr); !selected) {
+      return selected.error();
+    }
+    return try_process_call(register_addr, value);
+  }
 
   [[nodiscard]] uint16_t block_process_call(
     uint16_t register_addr,
@@ -103,6 +197,33 @@ public:
     return block_process_call(register_addr, value);
   }
 
+  /**
+   * Block process call without heap allocations, the reply replaces the contents of reply.
+   * Returns the length of the reply.
+   */
+  uint8_t block_process_call(
+    uint16_t register_addr, const uint8_t * data, std::size_t size,
+    I2CSMBusBlock & reply) const;
+  I2CResult<uint8_t> try_block_process_call(
+    uint16_t register_addr, const uint8_t * data, std::size_t size,
+    I2CSMBusBlock & reply) const;
+  inline uint8_t block_process_call(
+    uint16_t i2c_addr, uint16_t register_addr,
+    const uint8_t * data, std::size_t size, I2CSMBusBlock & reply)
+  {
+    set_i2c_device(i2c_addr);
+    return block_process_call(register_addr, data, size, reply);
+  }
+  inline I2CResult<uint8_t> try_block_process_call(
+    uint16_t i2c_addr, uint16_t register_addr,
+    const uint8_t * data, std::size_t size, I2CSMBusBlock & reply)
+  {
+    if (auto selected = try_set_i2c_device(i2c_addr); !selected) {
+      return selected.error();
+    }
+    return try_block_process_call(register_addr, data, size, reply);
+  }
+
   [[nodiscard]] std::vector<uint8_t> read_block_data(uint8_t register_addr) const;
   [[nodiscard]] inline std::vector<uint8_t> read_block_data(
     uint16_t i2c_addr,
@@ -124,17 +245,177 @@ public:
     write_block_data(register_addr, data);
   }
 
+  /**
+   * Read block data using the SMBus protocol without heap allocations.
+   * Returns the length of the block.
+   */
+  uint8_t read_block_data(uint8_t register_addr, I2CSMBusBlock & block) const;
+  I2CResult<uint8_t> try_read_block_data(uint8_t register_addr, I2CSMBusBlock & block) const;
+  inline uint8_t read_block_data(
+    uint16_t i2c_addr, uint8_t register_addr,
+    I2CSMBusBlock & block)
+  {
+    set_i2c_device(i2c_addr);
+    return read_block_data(register_addr, block);
+  }
+  inline I2CResult<uint8_t> try_read_block_data(
+    uint16_t i2c_addr, uint8_t register_addr,
+    I2CSMBusBlock & block)
+  {
+    if (auto selected = try_set_i2c_device(i2c_addr); !selected) {
+      return selected.error();
+    }
+    return try_read_block_data(register_addr, block);
+  }
+
+  /**
+   * Send block data using the SMBus protocol, from up to 32 bytes of caller storage.
+   */
+  void write_block_data(uint8_t register_addr, const uint8_t * data, std::size_t size) const;
+  I2CResult<void> try_write_block_data(
+    uint8_t register_addr, const uint8_t * data,
+    std::size_t size) const;
+  inline void write_block_data(
+    uint16_t i2c_addr, uint8_t register_addr,
+    const uint8_t * data, std::size_t size)
+  {
+    set_i2c_device(i2c_addr);
+    write_block_data(register_addr, data, size);
+  }
+  inline I2CResult<void> try_write_block_data(
+    uint16_t i2c_addr, uint8_t register_addr,
+    const uint8_t * data, std::size_t size)
+  {
+    if (auto selected = try_set_i2c_device(i2c_addr); !selected) {
+      return selected;
+    }
+    return try_write_block_data(register_addr, data, size);
+  }
+
+  /**
+   * Read size bytes (up to 32) starting at the register, without a length byte (I2C block read).
+   */
+  void read_i2c_block_data(uint8_t register_addr, uint8_t * data, std::size_t size) const;
+  I2CResult<void> try_read_i2c_block_data(
+    uint8_t register_addr, uint8_t * data,
+    std::size_t size) const;
+  inline void read_i2c_block_data(
+    uint16_t i2c_addr, uint8_t register_addr,
+    uint8_t * data, std::size_t size)
+  {
+    set_i2c_device(i2c_addr);
+    read_i2c_block_data(register_addr, data, size);
+  }
+  inline I2CResult<void> try_read_i2c_block_data(
+    uint16_t i2c_addr, uint8_t register_addr,
+    uint8_t * data, std::size_t size)
+  {
+    if (auto selected = try_set_i2c_device(i2c_addr); !selected) {
+      return selected;
+    }
+    return try_read_i2c_block_data(register_addr, data, size);
+  }
+
+  template<std::size_t Size>
+  void read_i2c_block_data(uint8_t register_addr, std::array<uint8_t, Size> & data) const
+  {
+    static_assert(Size > 0 && Size <= I2CConstants::SMBUS_BLOCK_MAX,
+        "I2C blocks hold between 1 and 32 bytes");
+    read_i2c_block_data(register_addr, data.data(), Size);
+  }
+
+  /**
+   * Write size bytes (up to 32) starting at the register, without a length byte (I2C block write).
+   */
+  void write_i2c_block_data(uint8_t register_addr, const uint8_t * data, std::size_t size) const;
+  I2CResult<void> try_write_i2c_block_data(
+    uint8_t register_addr, const uint8_t * data,
+    std::size_t size) const;
+  inline void write_i2c_block_data(
+    uint16_t i2c_addr, uint8_t register_addr,
+    const uint8_t * data, std::size_t size)
+  {
+    set_i2c_device(i2c_addr);
+    write_i2c_block_data(register_addr, data, size);
+  }
+  inline I2CResult<void> try_write_i2c_block_data(
+    uint16_t i2c_addr, uint8_t register_addr,
+    const uint8_t * data, std::size_t size)
+  {
+    if (auto selected = try_set_i2c_device(i2c_addr); !selected) {
+      return selected;
+    }
+    return try_write_i2c_block_data(register_addr, data, size);
+  }
+
+  template<std::size_t Size>
+  void write_i2c_block_data(uint8_t register_addr, const std::array<uint8_t, Size> & data) const
+  {
+    static_assert(Size > 0 && Size <= I2CConstants::SMBUS_BLOCK_MAX,
+        "I2C blocks hold between 1 and 32 bytes");
+    write_i2c_block_data(register_addr, data.data(), Size);
+  }
+
   /**
    * Execute a given I2C transaction.
    */
   template<typename Alloc = std::allocator<i2c_msg>>
-  void process_i2c_transaction(std::vector<i2c_msg, Alloc> & messages) const;
+  void process_i2c_transaction(std::vector<i2c_msg, Alloc> & messages) const
+  {
+    process_i2c_transaction(messages.data(), static_cast<uint32_t>(messages.size()));
+  }
+
+  /**
+   * Execute a given I2C transaction from a contiguous array of messages.
+   */
+  void process_i2c_transaction(i2c_msg * messages, uint32_t message_count) const;
+  I2CResult<void> try_process_i2c_transaction(i2c_msg * messages, uint32_t message_count) const;
+
+  /**
+   * Execute a transaction of any length, split into the fewest possible transfers.
+   * Messages are only split at safe boundaries, so combined write+read pairs and M_NOSTART
+   * continuations always stay in the same transfer.
+   * If given, sent_messages receives the number of messages of the transfers that succeeded, so
+   * that a failed transaction can be resumed without repeating them.
+   */
+  void process_i2c_transaction_chunked(i2c_msg * messages, uint32_t message_count) const;
+  I2CResult<void> try_process_i2c_transaction_chunked(
+    i2c_msg * messages,
+    uint32_t message_count, uint32_t * sent_messages = nullptr) const;
+
+  /**
+   * Check whether a device acknowledges its address, with a zero-length write (ACK polling).
+   * Adapters that cannot send zero-length messages, such as SMBus-only controllers, send an SMBus
+   * quick write instead when they support it.
+   * Returns false if it NAKs, e.g. while an EEPROM stores a page, and throws on other errors.
+   */
+  [[nodiscard]] bool poll_ack(uint16_t i2c_addr);
+  [[nodiscard]] I2CResult<bool> try_poll_ack(uint16_t i2c_addr);
 
   /**
    * Set Packet Error Checking (PEC).
    */
   void set_pec(bool enable);
 
+  /**
+   * Choose how SMBus operations reach their device.
+   * With ADDRESSING_PER_MESSAGE, switching between devices costs no extra syscalls and 10-bit
+   * addresses are flagged on each message instead of through I2C_TENBIT.
+   */
+  void set_addressing_mode(I2CAddressingMode mode);
+  [[nodiscard]] I2CAddressingMode get_addressing_mode() const {return addressing_mode;}
+
+  /**
+   * Apply the adapter retries and timeout of the policy, the ioctls are only issued on changes.
+   */
+  void set_adapter_limits(const I2CRetryPolicy & policy);
+  I2CResult<void> try_set_adapter_limits(const I2CRetryPolicy & policy);
+
+  /**
+   * Backend used to reach the adapter.
+   */
+  [[nodiscard]] I2CBackend & get_backend() const {return *backend;}
+
 private:
   /**
     * Initialize communication with I2C adapter.
@@ -152,6 +433,7 @@ private:
     * Set the device address for future operations.
     */
   void set_i2c_device(uint16_t i2c_addr);
+  I2CResult<void> try_set_i2c_device(uint16_t i2c_addr);
 
   /**
     * Close communication with I2C adapter.
@@ -161,26 +443,67 @@ private:
   /**
     * Set ten bit functionality.
     */
-  void set_ten_bit(bool enable) const;
-  inline void set_ten_bit_if_needed(uint16_t i2c_addr) const
+  I2CResult<void> try_set_ten_bit(bool enable) const;
+  inline I2CResult<void> try_set_ten_bit_if_needed(uint16_t i2c_addr)
   {
-    // check if the i2c address needs 10-bit enabled (>7-bit)
-    if (i2c_addr >= 0b1'000'000) {
-      set_ten_bit(true);
+    // check if the i2c address needs 10-bit enabled (>7-bit), and only touch it on changes
+    const bool ten_bit = i2c_addr > I2CConstants::I2C_MAX_7BIT_ADDRESS;
+    if (ten_bit != ten_bit_enabled) {
+      if (auto result = try_set_ten_bit(ten_bit); !result) {
+        return result;
+      }
+      ten_bit_enabled = ten_bit;
     }
+    return {};
   }
 
-  static constexpr int32_t INVALID_FILE_DESC = -1;
+  /**
+    * ACK poll a device with an SMBus quick write, see try_poll_ack.
+    */
+  I2CResult<bool> try_poll_ack_quick(uint16_t i2c_addr);
+
+  /**
+    * Check that the adapter is opened and has the functionality, returns 0 or the errno to report.
+    */
+  [[nodiscard]] int check_operation(uint64_t flag) const;
+
+  /**
+    * Execute an SMBus operation on the current device, returns 0 or the errno of the failure.
+    */
+  int smbus_access(
+    uint8_t read_write, uint8_t command, uint32_t size,
+    i2c_smbus_data * data) const;
+
+  /**
+    * Execute an SMBus operation on the current device with the current addressing mode.
+    * Returns a negative value and sets errno if it fails.
+    */
+  int32_t dispatch_smbus_access(
+    uint8_t read_write, uint8_t command, uint32_t size,
+    i2c_smbus_data * data) const;
+
   static constexpr uint16_t INVALID_I2C_ADDR = 0xFFFF;
 
-  // file descriptor to the i2c adapter/controller
-  int32_t i2c_file_desc{INVALID_FILE_DESC};
+  // transport to the i2c adapter/controller
+  std::unique_ptr<I2CBackend> backend;
 
   // address of the current device we are managing
   uint16_t cached_i2c_addr{INVALID_I2C_ADDR};
 
   // functionality of the i2c adapter
   uint64_t adapter_func{0};
+
+  I2CAddressingMode addressing_mode{I2CAddressingMode::ADDRESSING_SLAVE_IOCTL};
+
+  // I2C_TENBIT state, to only issue the ioctl when it changes
+  bool ten_bit_enabled{false};
+
+  // I2C_PEC state, also applied to the SMBus operations sent as messages
+  bool pec_enabled{false};
+
+  // I2C_RETRIES and I2C_TIMEOUT last set, negative while left to the driver
+  int64_t adapter_retries{-1};
+  int64_t adapter_timeout_units{-1};
 };
 
 }
@@ -0,0 +1,39 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP__IMPL__MESSAGE_CHUNKING_HPP_
+#define ROS2_I2CCPP__IMPL__MESSAGE_CHUNKING_HPP_
+#pragma once
+
+extern "C"
+{
+#include <linux/i2c.h>
+}
+
+#include <cstdint>
+
+namespace ros2_i2ccpp
+{
+
+/**
+ * Check if a message must be sent in the same transfer as the message before it, either because
+ * it continues it without a START (M_NOSTART), or because it is the read of a combined write+read
+ * to the same device (e.g. setting a register pointer and reading from it).
+ */
+[[nodiscard]] bool is_atomic_continuation(const i2c_msg & previous, const i2c_msg & message);
+
+/**
+ * Number of messages that can be sent in the next transfer, at most max_messages, without
+ * splitting an atomic group of messages.
+ * Packing the groups greedily gives the fewest possible transfers.
+ * Returns 0 if the first group alone does not fit in max_messages.
+ */
+[[nodiscard]] uint32_t next_chunk_size(
+  const i2c_msg * messages, uint32_t message_count,
+  uint32_t max_messages);
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP__IMPL__MESSAGE_CHUNKING_HPP_
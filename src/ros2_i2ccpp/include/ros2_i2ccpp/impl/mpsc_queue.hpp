@@ -0,0 +1,93 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP__IMPL__MPSC_QUEUE_HPP_
+#define ROS2_I2CCPP__IMPL__MPSC_QUEUE_HPP_
+#pragma once
+
+#include <atomic>
+
+namespace ros2_i2ccpp
+{
+
+/**
+ * Node of an MPSCQueue, to be inherited by the queued type.
+ */
+struct MPSCQueueNode
+{
+  std::atomic<MPSCQueueNode *> next{nullptr};
+};
+
+/**
+ * Intrusive multi-producer single-consumer queue (D. Vyukov's algorithm).
+ *
+ * Pushing is wait-free (a single exchange), popping is lock-free and must only be done by one
+ * thread. The queue does not own its nodes.
+ */
+class MPSCQueue {
+public:
+  MPSCQueue() = default;
+
+  MPSCQueue(const MPSCQueue &) = delete;
+  MPSCQueue & operator=(const MPSCQueue &) = delete;
+
+  /**
+   * Push a node, from any thread.
+   */
+  void push(MPSCQueueNode * node)
+  {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    MPSCQueueNode * previous = head.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+  }
+
+  /**
+   * Pop the oldest node, from the consumer thread only.
+   * Returns nullptr if the queue is empty, or if the next node is still being pushed.
+   */
+  MPSCQueueNode * pop()
+  {
+    MPSCQueueNode * current = tail;
+    MPSCQueueNode * next = current->next.load(std::memory_order_acquire);
+
+    if (current == &stub) {
+      if (next == nullptr) {
+        return nullptr;
+      }
+      tail = next;
+      current = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+
+    if (next != nullptr) {
+      tail = next;
+      return current;
+    }
+
+    // a producer has exchanged the head but not linked its node yet
+    if (current != head.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+
+    // current is the last node, put the stub behind it so it can be handed out
+    push(&stub);
+    next = current->next.load(std::memory_order_acquire);
+    if (next != nullptr) {
+      tail = next;
+      return current;
+    }
+    return nullptr;
+  }
+
+private:
+  // producers push to the head, the consumer pops from the tail
+  alignas(64) std::atomic<MPSCQueueNode *> head{&stub};
+  alignas(64) MPSCQueueNode * tail{&stub};
+  MPSCQueueNode stub;
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP__IMPL__MPSC_QUEUE_HPP_
@@ -0,0 +1,86 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP__IMPL__SMBUS_TRANSFER_HPP_
+#define ROS2_I2CCPP__IMPL__SMBUS_TRANSFER_HPP_
+#pragma once
+
+extern "C"
+{
+#include <linux/i2c.h>
+}
+
+#include <array>
+#include <cstdint>
+
+namespace ros2_i2ccpp
+{
+
+/**
+ * Compute the SMBus Packet Error Checking (CRC-8, x^8 + x^2 + x + 1) over a buffer.
+ */
+[[nodiscard]] uint8_t smbus_pec(uint8_t crc, const uint8_t * data, uint32_t size);
+
+/**
+ * Compute the SMBus PEC of a message, including its address byte.
+ */
+[[nodiscard]] uint8_t smbus_message_pec(uint8_t crc, const i2c_msg & message);
+
+/**
+ * An SMBus operation encoded as plain I2C messages, following the same layout as the kernel
+ * SMBus emulation layer (i2c_smbus_xfer_emulated).
+ *
+ * This allows SMBus operations to be executed through I2C_RDWR, where each message carries its own
+ * slave address.
+ */
+class SMBusTransfer {
+public:
+  SMBusTransfer() = default;
+
+  // messages point to the internal buffers
+  SMBusTransfer(const SMBusTransfer &) = delete;
+  SMBusTransfer & operator=(const SMBusTransfer &) = delete;
+
+  /**
+   * Encode an SMBus operation using the I2C_SMBUS ioctl arguments.
+   * Returns a negative value and sets errno if the operation is invalid.
+   */
+  int encode(
+    uint16_t i2c_addr, uint16_t flags, uint8_t read_write, uint8_t command, uint32_t size,
+    const i2c_smbus_data * data, bool pec = false);
+
+  /**
+   * Decode the result of the transfer back into the I2C_SMBUS data layout and check the PEC.
+   * Returns a negative value and sets errno if the received data is invalid.
+   */
+  int decode(i2c_smbus_data * data);
+
+  [[nodiscard]] i2c_msg * get_messages() {return messages.data();}
+  [[nodiscard]] uint32_t get_message_count() const {return message_count;}
+
+private:
+  /**
+   * Turn a read into an SMBus block read, whose length is given by the first byte received.
+   */
+  static void set_recv_len(i2c_msg & message);
+
+  std::array<i2c_msg, 2> messages{};
+  uint32_t message_count{0};
+
+  // operation that was encoded
+  uint8_t read_write{I2C_SMBUS_WRITE};
+  uint32_t size{0};
+  bool use_pec{false};
+
+  // running PEC of the write message, when it is followed by a read
+  uint8_t partial_pec{0};
+
+  std::array<uint8_t, I2C_SMBUS_BLOCK_MAX + 3> write_buffer{};
+  std::array<uint8_t, I2C_SMBUS_BLOCK_MAX + 2> read_buffer{};
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP__IMPL__SMBUS_TRANSFER_HPP_
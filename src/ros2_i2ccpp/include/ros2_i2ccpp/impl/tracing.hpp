@@ -0,0 +1,26 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP__IMPL__TRACING_HPP_
+#define ROS2_I2CCPP__IMPL__TRACING_HPP_
+#pragma once
+
+/**
+ * Static tracepoints (USDT) of the ros2_i2ccpp provider, e.g.
+ * ROS2_I2CCPP_TRACEPOINT(i2c_transfer_enter, this, address, message_count).
+ *
+ * A probe is a single nop plus an ELF note until a tracer attaches to it (LTTng through
+ * --userspace-probe=sdt:..., perf, bpftrace or SystemTap), and its arguments must be integers or
+ * pointers that are already at hand. Without ROS2_I2CCPP_TRACEPOINTS or sys/sdt.h, the probes and
+ * their arguments compile to nothing.
+ */
+#if defined(ROS2_I2CCPP_TRACEPOINTS) && __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define ROS2_I2CCPP_TRACEPOINT(name, ...) STAP_PROBEV(ros2_i2ccpp, name, __VA_ARGS__)
+#else
+#define ROS2_I2CCPP_TRACEPOINT(name, ...) static_cast<void>(0)
+#endif
+
+#endif  // ROS2_I2CCPP__IMPL__TRACING_HPP_
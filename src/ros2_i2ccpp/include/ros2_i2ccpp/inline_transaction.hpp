@@ -0,0 +1,332 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP_INLINE_TRANSACTION_HPP_
+#define ROS2_I2CCPP_INLINE_TRANSACTION_HPP_
+#pragma once
+
+extern "C"
+{
+#include <linux/i2c.h>
+}
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <type_traits>
+
+#include "ros2_i2ccpp/constants.hpp"
+#include "ros2_i2ccpp/exceptions.hpp"
+#include "ros2_i2ccpp/register_offset.hpp"
+
+namespace ros2_i2ccpp
+{
+
+/**
+ * Transaction that keeps its i2c_msg array and payloads inline, in a fixed capacity arena.
+ *
+ * Building and executing it does not allocate nor dispatch virtually; read results are copied to
+ * the destination objects once the transaction is completed by the handler.
+ * Unlike I2CTransaction, it can be cleared and rebuilt without releasing its storage.
+ */
+template<std::size_t ArenaSize = I2CConstants::I2C_INLINE_TRANSACTION_ARENA_SIZE>
+class I2CInlineTransaction {
+public:
+  static constexpr std::size_t MAX_MESSAGES = I2CConstants::I2C_TRANSACTION_IOCTL_MAX_MSGS;
+
+  explicit I2CInlineTransaction(uint16_t device_address_)
+  : device_address(device_address_) {}
+
+  // messages point into the arena, so copies have to be rebased
+  I2CInlineTransaction(const I2CInlineTransaction & other)
+  {
+    *this = other;
+  }
+
+  I2CInlineTransaction & operator=(const I2CInlineTransaction & other)
+  {
+    if (this == &other) {
+      return *this;
+    }
+
+    device_address = other.device_address;
+    offset_format = other.offset_format;
+    current_offset = other.current_offset;
+    message_count = other.message_count;
+    arena_size = other.arena_size;
+    std::memcpy(arena.data(), other.arena.data(), arena_size);
+    for (uint32_t i = 0; i < message_count; i++) {
+      outputs[i] = other.outputs[i];
+      messages[i] = other.messages[i];
+      if (other.owns_buffer(other.messages[i])) {
+        messages[i].buf = arena.data() + (other.messages[i].buf - other.arena.data());
+      }
+    }
+    return *this;
+  }
+
+  /**
+   * Set how register offsets are sent, 16-bit little endian by default.
+   */
+  I2CInlineTransaction & set_offset_format(I2CRegisterOffsetFormat format)
+  {
+    offset_format = format;
+    current_offset.reset();
+    return *this;
+  }
+
+  /**
+   * Write the given data. Consecutive writes without flags are merged into a single message.
+   */
+  template<typename PODType, typename ...MessageFlagsT>
+  I2CInlineTransaction & add_write(const PODType & pod, MessageFlagsT... flags)
+  {
+    static_assert(std::conjunction_v<std::is_same<I2CMessageFlags, MessageFlagsT>...>,
+        "These should be all I2CMessageFlags!");
+    static_assert(std::is_standard_layout_v<PODType>&& std::is_trivially_copyable_v<PODType>,
+        "Type data must be of a POD type and trivially copyable");
+
+    // the device pointer is unknown after a raw write
+    current_offset.reset();
+
+    uint8_t * buffer = (sizeof...(flags) == 0 && can_append_write()) ?
+      extend_last_write(sizeof(PODType)) :
+      emplace_message(sizeof(PODType), nullptr, flags ...).buf;
+    std::memcpy(buffer, &pod, sizeof(PODType));
+    return *this;
+  }
+
+  /**
+   * Write the given data to a register, sending the offset and the data in a single message.
+   * A write that continues where the previous one ended is appended to it, without the offset.
+   */
+  template<typename PODType, typename ...MessageFlagsT>
+  I2CInlineTransaction & add_write(uint16_t offset, const PODType & pod, MessageFlagsT... flags)
+  {
+    static_assert(std::conjunction_v<std::is_same<I2CMessageFlags, MessageFlagsT>...>,
+        "These should be all I2CMessageFlags!");
+    static_assert(std::is_standard_layout_v<PODType>&& std::is_trivially_copyable_v<PODType>,
+        "Type data must be of a POD type and trivially copyable");
+
+    uint8_t * buffer;
+    if (sizeof...(flags) == 0 && can_append_write() && current_offset == offset) {
+      buffer = extend_last_write(sizeof(PODType));
+    } else {
+      // the device reads the offset from the first bytes of the message
+      const auto offset_size = register_offset_size(offset_format);
+      buffer = emplace_message(offset_size + sizeof(PODType), nullptr, flags ...).buf;
+      encode_register_offset(offset_format, offset, buffer);
+      buffer += offset_size;
+    }
+    std::memcpy(buffer, &pod, sizeof(PODType));
+
+    // assume the device auto increments its pointer
+    current_offset = static_cast<uint16_t>(offset + sizeof(PODType));
+    return *this;
+  }
+
+  template<typename PODType, typename ...MessageFlagsT>
+  I2CInlineTransaction & add_read(PODType & pod, MessageFlagsT... flags)
+  {
+    static_assert(std::conjunction_v<std::is_same<I2CMessageFlags, MessageFlagsT>...>,
+        "These should be all I2CMessageFlags!");
+    static_assert(std::is_standard_layout_v<PODType>&& std::is_trivially_copyable_v<PODType>,
+        "Type data must be of a POD type and trivially copyable");
+
+    emplace_message(sizeof(PODType), &pod, I2CMessageFlags::M_RD, flags ...);
+    return *this;
+  }
+
+  template<typename PODType, typename ...MessageFlagsT>
+  I2CInlineTransaction & add_read(uint16_t offset, PODType & pod, MessageFlagsT... flags)
+  {
+    // write the offset, then read with a repeated start
+    emplace_offset(offset);
+    return add_read(pod, flags ...);
+  }
+
+  /**
+   * Read into the given object without staging it in the arena, the object must outlive the
+   * transaction.
+   */
+  template<typename PODType, typename ...MessageFlagsT>
+  auto add_read_in_place(PODType & pod, MessageFlagsT... flags)
+  -> std::enable_if_t<std::conjunction_v<std::is_same<I2CMessageFlags, MessageFlagsT>...>,
+    I2CInlineTransaction &>
+  {
+    static_assert(std::is_trivially_copyable_v<PODType>&& !std::is_pointer_v<PODType>,
+        "Type data must be trivially copyable");
+    return add_read_in_place(reinterpret_cast<uint8_t *>(&pod), sizeof(PODType), flags ...);
+  }
+
+  /**
+   * Read into the given bytes without staging them in the arena, the bytes must outlive the
+   * transaction.
+   */
+  template<typename ...MessageFlagsT>
+  I2CInlineTransaction & add_read_in_place(
+    uint8_t * data, std::size_t size,
+    MessageFlagsT... flags)
+  {
+    static_assert(std::conjunction_v<std::is_same<I2CMessageFlags, MessageFlagsT>...>,
+        "These should be all I2CMessageFlags!");
+    if (size > UINT16_MAX) {
+      ROS2_I2CCPP_THROW(
+        exceptions::IllegalOperationException("Message is too large for a single segment!"));
+    }
+
+    auto & message = emplace_message(0, nullptr, I2CMessageFlags::M_RD, flags ...);
+    message.buf = data;
+    message.len = static_cast<uint16_t>(size);
+    return *this;
+  }
+
+  template<typename PODType, typename ...MessageFlagsT>
+  auto add_read_in_place(
+    uint16_t offset, PODType & pod,
+    MessageFlagsT... flags)
+  -> std::enable_if_t<std::conjunction_v<std::is_same<I2CMessageFlags, MessageFlagsT>...>,
+    I2CInlineTransaction &>
+  {
+    emplace_offset(offset);
+    return add_read_in_place(pod, flags ...);
+  }
+
+  template<typename ...MessageFlagsT>
+  I2CInlineTransaction & add_read_in_place(
+    uint16_t offset, uint8_t * data, std::size_t size,
+    MessageFlagsT... flags)
+  {
+    emplace_offset(offset);
+    return add_read_in_place(data, size, flags ...);
+  }
+
+  /**
+   * Copy the data received by the read messages to their destinations.
+   * Called by the handler once the transaction has been executed.
+   */
+  void complete() const
+  {
+    for (uint32_t i = 0; i < message_count; i++) {
+      if (outputs[i] != nullptr) {
+        std::memcpy(outputs[i], messages[i].buf, messages[i].len);
+      }
+    }
+  }
+
+  /**
+   * Remove all messages, keeping the device address.
+   */
+  void clear()
+  {
+    message_count = 0;
+    arena_size = 0;
+    current_offset.reset();
+  }
+
+  [[nodiscard]] i2c_msg * get_messages() {return messages.data();}
+  [[nodiscard]] uint32_t get_message_count() const {return message_count;}
+  [[nodiscard]] std::size_t get_payload_size() const {return arena_size;}
+  [[nodiscard]] uint16_t get_device_address() const {return device_address;}
+
+private:
+  [[nodiscard]] bool owns_buffer(const i2c_msg & message) const
+  {
+    return std::greater_equal<const uint8_t *>{}(message.buf, arena.data()) &&
+           std::less<const uint8_t *>{}(message.buf, arena.data() + ArenaSize);
+  }
+
+  /**
+   * Check if the last message is a plain write whose payload ends the arena, so it can grow.
+   */
+  [[nodiscard]] bool can_append_write() const
+  {
+    if (message_count == 0) {
+      return false;
+    }
+    const auto & last = messages[message_count - 1];
+    return last.flags == 0 && owns_buffer(last) && last.buf + last.len == arena.data() + arena_size;
+  }
+
+  uint8_t * extend_last_write(std::size_t size)
+  {
+    auto & last = messages[message_count - 1];
+    if (arena_size + size > ArenaSize) {
+      ROS2_I2CCPP_THROW(exceptions::IllegalOperationException(
+          "Not enough space left in the transaction arena!"));
+    }
+    if (last.len + size > UINT16_MAX) {
+      ROS2_I2CCPP_THROW(
+        exceptions::IllegalOperationException("Message is too large for a single segment!"));
+    }
+
+    uint8_t * buffer = arena.data() + arena_size;
+    last.len = static_cast<uint16_t>(last.len + size);
+    arena_size += size;
+    return buffer;
+  }
+
+  /**
+   * Write a register offset in its own message, e.g. ahead of a read.
+   */
+  void emplace_offset(uint16_t offset)
+  {
+    auto & message = emplace_message(register_offset_size(offset_format), nullptr);
+    encode_register_offset(offset_format, offset, message.buf);
+  }
+
+  template<typename ...MessageFlagsT>
+  i2c_msg & emplace_message(std::size_t size, void * output, MessageFlagsT... flags)
+  {
+    if (message_count >= MAX_MESSAGES) {
+      ROS2_I2CCPP_THROW(exceptions::IllegalOperationException(
+          "Unable to push any more messages to the transaction queue!"));
+    }
+    if (arena_size + size > ArenaSize) {
+      ROS2_I2CCPP_THROW(exceptions::IllegalOperationException(
+          "Not enough space left in the transaction arena!"));
+    }
+
+    uint16_t message_flags = 0;
+    if constexpr (sizeof...(flags) > 0) {
+      message_flags = (... | flags);
+    }
+
+    outputs[message_count] = output;
+    auto & message = messages[message_count++];
+    message = i2c_msg{device_address, message_flags, static_cast<uint16_t>(size),
+      arena.data() + arena_size};
+    arena_size += size;
+    return message;
+  }
+
+  // i2c slave address that the transaction will apply to
+  uint16_t device_address{0};
+
+  // how register offsets are sent
+  I2CRegisterOffsetFormat offset_format{I2CRegisterOffsetFormat::OFFSET_16BIT_LE};
+
+  // offset of the device pointer after the last register write, if known
+  std::optional<uint16_t> current_offset;
+
+  uint32_t message_count{0};
+  std::size_t arena_size{0};
+
+  // only the first message_count entries are initialized, to keep construction cheap
+  std::array<i2c_msg, MAX_MESSAGES> messages;
+
+  // destination of each read message, nullptr for writes
+  std::array<void *, MAX_MESSAGES> outputs;
+
+  // payloads of all messages, packed back to back
+  alignas(std::max_align_t) std::array<uint8_t, ArenaSize> arena;
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP_INLINE_TRANSACTION_HPP_
@@ -0,0 +1,110 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP__LOCK_POLICY_HPP_
+#define ROS2_I2CCPP__LOCK_POLICY_HPP_
+#pragma once
+
+extern "C"
+{
+#include <pthread.h>
+}
+
+#include <atomic>
+#include <cstdint>
+
+namespace ros2_i2ccpp
+{
+
+// mutex types I2CHandler is built with besides std::mutex, all of them Lockable
+
+/**
+ * No locking at all, for handlers used by a single thread (e.g. the async engine I/O thread).
+ */
+struct null_mutex
+{
+  void lock() {}
+  bool try_lock() {return true;}
+  void unlock() {}
+};
+
+/**
+ * Futex based mutex that spins for a while before putting the waiter to sleep.
+ *
+ * Most transactions hold the handler for tens to hundreds of microseconds, so a thread that finds
+ * it locked usually sleeps; but short critical sections (e.g. changing the retry policy) are
+ * over before a context switch would be, and spinning avoids paying for it. Spinning is skipped on
+ * single CPU machines, where the owner cannot make progress meanwhile.
+ */
+class spin_then_park_mutex {
+public:
+  // a few microseconds at most, about what a futex sleep and wake-up cost
+  static constexpr uint32_t SPIN_COUNT = 64;
+
+  spin_then_park_mutex() = default;
+  spin_then_park_mutex(const spin_then_park_mutex &) = delete;
+  spin_then_park_mutex & operator=(const spin_then_park_mutex &) = delete;
+
+  void lock()
+  {
+    uint32_t expected = UNLOCKED;
+    if (!state.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire,
+      std::memory_order_relaxed))
+    {
+      lock_contended();
+    }
+  }
+
+  bool try_lock()
+  {
+    uint32_t expected = UNLOCKED;
+    return state.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire,
+             std::memory_order_relaxed);
+  }
+
+  void unlock()
+  {
+    if (state.exchange(UNLOCKED, std::memory_order_release) == CONTENDED) {
+      wake();
+    }
+  }
+
+private:
+  static constexpr uint32_t UNLOCKED = 0;
+  static constexpr uint32_t LOCKED = 1;
+  static constexpr uint32_t CONTENDED = 2;  // locked, and a thread may be sleeping on it
+
+  void lock_contended();
+  void wake();
+
+  std::atomic<uint32_t> state{UNLOCKED};
+};
+
+/**
+ * Mutex with the priority inheritance protocol (PTHREAD_PRIO_INHERIT).
+ *
+ * While a real-time thread waits for the handler, the thread holding it runs at the priority of
+ * the waiter, so a lower priority thread in the middle of a transaction cannot be preempted by
+ * medium priority threads and hold the real-time one back (priority inversion).
+ */
+class priority_inheritance_mutex {
+public:
+  priority_inheritance_mutex();
+  ~priority_inheritance_mutex();
+
+  priority_inheritance_mutex(const priority_inheritance_mutex &) = delete;
+  priority_inheritance_mutex & operator=(const priority_inheritance_mutex &) = delete;
+
+  void lock();
+  bool try_lock();
+  void unlock();
+
+private:
+  pthread_mutex_t mutex;
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP__LOCK_POLICY_HPP_
@@ -0,0 +1,227 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP_POLLING_ENGINE_HPP_
+#define ROS2_I2CCPP_POLLING_ENGINE_HPP_
+#pragma once
+
+extern "C"
+{
+#include <linux/i2c.h>
+}
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "ros2_i2ccpp/constants.hpp"
+#include "ros2_i2ccpp/i2c_handler.hpp"
+#include "ros2_i2ccpp/register_offset.hpp"
+#include "ros2_i2ccpp/triple_buffer.hpp"
+
+namespace ros2_i2ccpp
+{
+
+class I2CBackend;
+
+/**
+ * Register read periodically by an I2CPollingEngine, and the latest value read from it.
+ * Only one thread may read a given register.
+ */
+class I2CPolledRegister {
+public:
+  I2CPolledRegister(uint16_t device_address_, uint16_t register_address_, std::size_t size)
+  : device_address(device_address_), register_address(register_address_), samples(size) {}
+
+  /**
+   * Pick up the latest value, returns false if none was read since the last update.
+   * Never blocks the acquisition thread.
+   */
+  bool update() {return samples.update();}
+
+  /**
+   * Latest value picked up by update.
+   */
+  [[nodiscard]] const uint8_t * get_data() const {return samples.get_read_buffer();}
+  [[nodiscard]] std::size_t get_size() const {return samples.get_size();}
+
+  template<typename PODType>
+  [[nodiscard]] PODType get() const
+  {
+    static_assert(std::is_trivially_copyable_v<PODType>, "Type data must be trivially copyable");
+    PODType value{};
+    std::memcpy(&value, get_data(), std::min(sizeof(PODType), get_size()));
+    return value;
+  }
+
+  /**
+   * Time at which the latest value was received.
+   */
+  [[nodiscard]] std::chrono::steady_clock::time_point get_timestamp() const
+  {
+    return samples.get_read_timestamp();
+  }
+
+  /**
+   * Number of values read so far when the latest one was received, 0 before the first update.
+   */
+  [[nodiscard]] uint64_t get_sequence() const {return samples.get_read_sequence();}
+
+  /**
+   * Number of reads that failed.
+   */
+  [[nodiscard]] uint64_t get_error_count() const {return errors.load(std::memory_order_relaxed);}
+
+  [[nodiscard]] uint16_t get_device_address() const {return device_address;}
+  [[nodiscard]] uint16_t get_register_address() const {return register_address;}
+
+private:
+  friend class I2CPollingEngine;
+
+  uint16_t device_address;
+  uint16_t register_address;
+  TripleBuffer samples;
+  std::atomic<uint64_t> errors{0};
+};
+
+/**
+ * Counters of an I2CPollingEngine since it was started.
+ */
+struct I2CPollingStatistics
+{
+  uint64_t ticks{0};      // times the engine woke up to read due registers
+  uint64_t transfers{0};  // I2C_RDWR transfers sent, including the ones that failed
+  uint64_t reads{0};      // register reads that succeeded
+  uint64_t errors{0};     // register reads that failed
+  uint64_t overruns{0};   // periods skipped because the engine was late
+};
+
+/**
+ * Reads registers periodically on a dedicated acquisition thread.
+ *
+ * Reads are due on multiples of their period since the engine was started, so registers with
+ * commensurate periods fall on the same ticks. Everything due on a tick is packed into as few
+ * I2C_RDWR transfers as possible (an offset write and a read per register, for any device), and
+ * the results are published to lock-free triple buffers.
+ * If a transfer fails, its registers are read again one by one so that a single faulty device
+ * does not hide the others.
+ */
+class I2CPollingEngine {
+public:
+  I2CPollingEngine() = delete;
+  I2CPollingEngine(std::string i2c_adapter_path);
+  I2CPollingEngine(std::unique_ptr<I2CBackend> backend, std::string i2c_adapter_path = "/dev/i2c-1");
+
+  /**
+   * Stop the acquisition thread.
+   */
+  ~I2CPollingEngine();
+
+  I2CPollingEngine(const I2CPollingEngine &) = delete;
+  I2CPollingEngine & operator=(const I2CPollingEngine &) = delete;
+
+  /**
+   * Read size bytes at the given register of the given device every period.
+   */
+  std::shared_ptr<I2CPolledRegister> add_register(
+    uint16_t device_address, uint16_t register_address,
+    std::size_t size, std::chrono::nanoseconds period,
+    I2CRegisterOffsetFormat offset_format = I2CRegisterOffsetFormat::OFFSET_8BIT);
+
+  /**
+   * Stop reading the given register.
+   */
+  void remove_register(const std::shared_ptr<I2CPolledRegister> & polled_register);
+
+  /**
+   * Reads due within this tolerance of a tick are done on that tick, to share transfers.
+   */
+  void set_tick_tolerance(std::chrono::nanoseconds tolerance);
+
+  [[nodiscard]] I2CPollingStatistics get_statistics() const;
+
+  /**
+   * Start or stop collecting the latency histograms and counters of the handler used by the
+   * acquisition thread, see I2CHandler::enable_statistics. Can be called from any thread.
+   */
+  void enable_handler_statistics(bool enable = true) {handler->enable_statistics(enable);}
+  [[nodiscard]] I2CHandlerStatistics get_handler_statistics() const
+  {
+    return handler->get_statistics();
+  }
+
+private:
+  struct Poll
+  {
+    std::shared_ptr<I2CPolledRegister> polled_register;
+    std::array<uint8_t, I2C_REGISTER_OFFSET_MAX_SIZE> offset{};
+    uint16_t offset_size{0};
+    uint16_t size{0};
+    std::chrono::nanoseconds period{0};
+    std::chrono::steady_clock::time_point next_due;
+  };
+
+  void run();
+
+  /**
+   * Apply the registers added and removed since the last tick, with the changes locked.
+   */
+  void apply_changes();
+
+  /**
+   * Read all registers due before the horizon.
+   */
+  void execute_tick(std::chrono::steady_clock::time_point horizon);
+
+  /**
+   * Send the reads of the given polls, which have 2 messages each starting at messages.
+   */
+  void transfer(Poll ** polls, i2c_msg * messages, uint32_t poll_count);
+
+  void publish(Poll & poll, std::chrono::steady_clock::time_point timestamp);
+
+  // only used by the acquisition thread once it has started
+  std::unique_ptr<ThreadUnsafeI2CHandler> handler;
+
+  std::chrono::steady_clock::time_point epoch;
+
+  // changes requested by other threads, picked up between ticks so they never wait for the bus
+  std::mutex changes_mutex;
+  std::condition_variable changes_made;
+  std::vector<Poll> added_polls;
+  std::vector<std::shared_ptr<I2CPolledRegister>> removed_registers;
+  std::chrono::nanoseconds tick_tolerance{std::chrono::microseconds{100}};
+  bool stopping{false};
+
+  // only used by the acquisition thread
+  std::vector<Poll> polls;
+
+  // scratch storage of a tick, sized for all polls
+  std::vector<Poll *> due_polls;
+  std::vector<i2c_msg> messages;
+
+  std::atomic<uint64_t> ticks{0};
+  std::atomic<uint64_t> transfers{0};
+  std::atomic<uint64_t> reads{0};
+  std::atomic<uint64_t> errors{0};
+  std::atomic<uint64_t> overruns{0};
+
+  std::thread acquisition_thread;
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP_POLLING_ENGINE_HPP_
@@ -0,0 +1,89 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP_PREPARED_TRANSACTION_HPP_
+#define ROS2_I2CCPP_PREPARED_TRANSACTION_HPP_
+#pragma once
+
+extern "C"
+{
+#include <linux/i2c.h>
+}
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+#include "ros2_i2ccpp/transaction.hpp"
+
+namespace ros2_i2ccpp
+{
+
+/**
+ * A transaction that is built once and executed as many times as needed, e.g. a sensor poll.
+ *
+ * The i2c_msg array is built when the transaction is prepared and keeps pointing at the segment
+ * buffers, so executing it again does not allocate. Read segments stay bound to the objects given
+ * to the builder, which are refreshed after every execution. Destroying the transaction leaves
+ * them untouched, so they may go away before it does.
+ */
+class I2CPreparedTransaction {
+public:
+  I2CPreparedTransaction(
+    std::pmr::memory_resource & mr,
+    std::pmr::vector<std::shared_ptr<I2CTransactionSegment>> && segments,
+    bool allow_chunking_ = false);
+
+  // the messages point to the segment buffers, which do not move with the transaction
+  I2CPreparedTransaction(I2CPreparedTransaction && other) noexcept = default;
+  I2CPreparedTransaction & operator=(I2CPreparedTransaction && other) noexcept = default;
+
+  I2CPreparedTransaction(const I2CPreparedTransaction &) = delete;
+  I2CPreparedTransaction & operator=(const I2CPreparedTransaction &) = delete;
+
+  /**
+   * Restore the segment buffers that the last execution overwrote, see
+   * I2CTransactionSegment::rearm. Called by the handler before every execution, from the first
+   * message that is sent.
+   */
+  void rearm(uint32_t first_message = 0);
+
+  /**
+   * Refresh the objects bound to the read segments with the last received data.
+   * Called by the handler after every execution, returns 0 or the errno of an invalid reply.
+   */
+  int complete();
+
+  [[nodiscard]] i2c_msg * get_messages() {return messages.data();}
+  [[nodiscard]] uint32_t get_message_count() const
+  {
+    return static_cast<uint32_t>(messages.size());
+  }
+
+  std::pmr::vector<std::shared_ptr<I2CTransactionSegment>> & getSegments()
+  {
+    return transaction_segments;
+  }
+
+  /**
+   * Check if the transaction may be split into several transfers.
+   */
+  [[nodiscard]] bool is_chunking_allowed() const {return allow_chunking;}
+
+private:
+  // list of transaction segments, owning the message buffers
+  std::pmr::vector<std::shared_ptr<I2CTransactionSegment>> transaction_segments;
+
+  // messages built from the segments
+  std::pmr::vector<i2c_msg> messages;
+
+  // whether the transaction may be split into several transfers
+  bool allow_chunking{false};
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP_PREPARED_TRANSACTION_HPP_
@@ -0,0 +1,255 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP_REGISTER_CACHE_HPP_
+#define ROS2_I2CCPP_REGISTER_CACHE_HPP_
+#pragma once
+
+extern "C"
+{
+#include <linux/i2c.h>
+}
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ros2_i2ccpp/constants.hpp"
+#include "ros2_i2ccpp/i2c_handler.hpp"
+#include "ros2_i2ccpp/inline_transaction.hpp"
+#include "ros2_i2ccpp/register_offset.hpp"
+
+namespace ros2_i2ccpp
+{
+
+/**
+ * Counters of an I2CRegisterCache since it was created.
+ */
+struct I2CRegisterCacheStatistics
+{
+  uint64_t hits{0};           // reads served from the cache
+  uint64_t misses{0};         // reads that went to the device
+  uint64_t elided_writes{0};  // writes skipped because the device already held the value
+  uint64_t writes{0};         // registers written to the device, including flushed ones
+  uint64_t flushes{0};        // flushes that had something to write
+};
+
+/**
+ * Shadow copy of the byte registers of a single device.
+ *
+ * Registers are cacheable by default: once read or written, their value is served locally and
+ * writes of the value they already hold are skipped. Registers the device changes on its own
+ * (status, data, clear-on-read) must be marked volatile, so they always go to the device.
+ * Writes can also be staged and flushed later, in a single transaction where consecutive dirty
+ * registers share one message (this needs a device that auto-increments its register pointer,
+ * see set_auto_increment).
+ *
+ * The cache assumes it is the only writer of the device registers, and is not thread safe.
+ */
+class I2CRegisterCache {
+public:
+  I2CRegisterCache(
+    uint16_t device_address_, std::size_t register_count,
+    I2CRegisterOffsetFormat offset_format_ = I2CRegisterOffsetFormat::OFFSET_8BIT);
+
+  [[nodiscard]] uint16_t get_device_address() const {return device_address;}
+  [[nodiscard]] std::size_t get_register_count() const {return values.size();}
+
+  /**
+   * Mark a register, or the registers in [first, last], as volatile or cacheable.
+   * Making a register volatile forgets its cached value, but not a staged write.
+   */
+  void set_volatile(uint16_t register_address, bool is_volatile = true);
+  void set_volatile(uint16_t first, uint16_t last, bool is_volatile = true);
+  [[nodiscard]] bool is_volatile(uint16_t register_address) const;
+
+  /**
+   * Merge writes to consecutive registers into a single message when flushing (on by default).
+   */
+  void set_auto_increment(bool enable) {auto_increment = enable;}
+
+  /**
+   * Record the value of a cacheable register without touching the device, e.g. a reset default.
+   */
+  void set_known_value(uint16_t register_address, uint8_t value);
+
+  /**
+   * Forget the cached value of a register, or of all registers (e.g. after a device reset).
+   * Staged writes are kept.
+   */
+  void invalidate(uint16_t register_address);
+  void invalidate();
+
+  /**
+   * Get the cached value of a register, returns false if it is not known.
+   */
+  bool get_cached_value(uint16_t register_address, uint8_t & value) const;
+
+  /**
+   * Read a register, from the cache if its value is known or a write to it is staged.
+   * Volatile registers with a staged write are read from the device, and keep the staged value.
+   */
+  template<typename Mutex>
+  uint8_t read(const I2CHandler<Mutex> & handler, uint16_t register_address)
+  {
+    uint8_t value = 0;
+    if (get_cached_value(register_address, value)) {
+      statistics.hits++;
+      return value;
+    }
+    if ((states[register_address] & (DIRTY | VOLATILE)) == DIRTY) {
+      statistics.hits++;
+      return values[register_address];
+    }
+
+    check_register(register_address);
+    I2CInlineTransaction<I2C_REGISTER_OFFSET_MAX_SIZE> transaction{device_address};
+    transaction.set_offset_format(offset_format).add_read_in_place(register_address, value);
+    handler.apply_transaction(transaction);
+
+    statistics.misses++;
+    if ((states[register_address] & DIRTY) == 0) {
+      store(register_address, value);
+    }
+    return value;
+  }
+
+  /**
+   * Write a register now, unless the device is known to hold that value already.
+   * Any staged write to the register is superseded.
+   */
+  template<typename Mutex>
+  void write(const I2CHandler<Mutex> & handler, uint16_t register_address, uint8_t value)
+  {
+    if (is_write_elided(register_address, value)) {
+      return;
+    }
+
+    I2CInlineTransaction<I2C_REGISTER_OFFSET_MAX_SIZE + 1> transaction{device_address};
+    transaction.set_offset_format(offset_format).add_write(register_address, value);
+    handler.apply_transaction(transaction);
+
+    statistics.writes++;
+    store(register_address, value);
+  }
+
+  /**
+   * Replace the bits of a register selected by the mask, reading it only if its value is unknown.
+   */
+  template<typename Mutex>
+  void update_bits(
+    const I2CHandler<Mutex> & handler, uint16_t register_address,
+    uint8_t mask, uint8_t bits)
+  {
+    const auto current = read_for_update(handler, register_address);
+    write(handler, register_address, static_cast<uint8_t>((current & ~mask) | (bits & mask)));
+  }
+
+  /**
+   * Stage a write for the next flush, unless the device is known to hold that value already.
+   */
+  void stage(uint16_t register_address, uint8_t value);
+
+  /**
+   * Stage an update of the bits selected by the mask, reading the register only if its value is
+   * unknown.
+   */
+  template<typename Mutex>
+  void stage_bits(
+    const I2CHandler<Mutex> & handler, uint16_t register_address,
+    uint8_t mask, uint8_t bits)
+  {
+    const auto current = read_for_update(handler, register_address);
+    stage(register_address, static_cast<uint8_t>((current & ~mask) | (bits & mask)));
+  }
+
+  [[nodiscard]] std::size_t get_dirty_count() const {return dirty_count;}
+
+  /**
+   * Write all staged registers in a single transaction, returns the number of registers written.
+   * If the transfer fails, the registers stay staged so that the flush can be retried.
+   */
+  template<typename Mutex>
+  std::size_t flush(const I2CHandler<Mutex> & handler)
+  {
+    if (dirty_count == 0) {
+      return 0;
+    }
+
+    prepare_flush();
+    handler.apply_messages(
+      flush_messages.data(), static_cast<uint32_t>(flush_messages.size()), true);
+    return complete_flush();
+  }
+
+  /**
+   * Drop the staged writes, the device keeps its current values.
+   */
+  void discard();
+
+  [[nodiscard]] const I2CRegisterCacheStatistics & get_statistics() const {return statistics;}
+
+private:
+  enum RegisterState: uint8_t
+  {
+    KNOWN = 0x1,     // the cached value matches the device
+    DIRTY = 0x2,     // the cached value is staged for the next flush
+    VOLATILE = 0x4,  // the device may change the value on its own
+  };
+
+  void check_register(uint16_t register_address) const;
+
+  /**
+   * Record a value the device now holds.
+   */
+  void store(uint16_t register_address, uint8_t value);
+
+  /**
+   * Check whether a write can be skipped, and drop any staged write it supersedes.
+   */
+  bool is_write_elided(uint16_t register_address, uint8_t value);
+
+  /**
+   * Current value of a register for a read-modify-write, which includes a staged write.
+   */
+  template<typename Mutex>
+  uint8_t read_for_update(const I2CHandler<Mutex> & handler, uint16_t register_address)
+  {
+    check_register(register_address);
+    if ((states[register_address] & DIRTY) != 0) {
+      statistics.hits++;
+      return values[register_address];
+    }
+    return read(handler, register_address);
+  }
+
+  /**
+   * Encode the staged registers into flush_messages.
+   */
+  void prepare_flush();
+
+  /**
+   * Mark the staged registers as written, returns how many there were.
+   */
+  std::size_t complete_flush();
+
+  uint16_t device_address;
+  I2CRegisterOffsetFormat offset_format;
+  bool auto_increment{true};
+
+  std::vector<uint8_t> values;
+  std::vector<uint8_t> states;
+  std::size_t dirty_count{0};
+
+  // storage of the last flush, kept to avoid reallocating
+  std::vector<uint8_t> flush_buffer;
+  std::vector<i2c_msg> flush_messages;
+
+  I2CRegisterCacheStatistics statistics;
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP_REGISTER_CACHE_HPP_
@@ -0,0 +1,60 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP_REGISTER_OFFSET_HPP_
+#define ROS2_I2CCPP_REGISTER_OFFSET_HPP_
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ros2_i2ccpp/constants.hpp"
+#include "ros2_i2ccpp/exceptions.hpp"
+
+namespace ros2_i2ccpp
+{
+
+// largest encoded register offset, in bytes
+constexpr std::size_t I2C_REGISTER_OFFSET_MAX_SIZE = 2;
+
+/**
+ * Number of bytes used to send an offset in the given format.
+ */
+[[nodiscard]] constexpr std::size_t register_offset_size(I2CRegisterOffsetFormat format)
+{
+  return format == I2CRegisterOffsetFormat::OFFSET_8BIT ? 1 : 2;
+}
+
+/**
+ * Write the offset in the given format to out, which must hold I2C_REGISTER_OFFSET_MAX_SIZE bytes.
+ * Returns the number of bytes written.
+ */
+inline std::size_t encode_register_offset(
+  I2CRegisterOffsetFormat format, uint16_t offset,
+  uint8_t * out)
+{
+  switch (format) {
+    case I2CRegisterOffsetFormat::OFFSET_8BIT:
+      if (offset > UINT8_MAX) {
+        ROS2_I2CCPP_THROW(
+          exceptions::IllegalOperationException("Register offset does not fit in 8 bits!"));
+      }
+      out[0] = static_cast<uint8_t>(offset);
+      return 1;
+    case I2CRegisterOffsetFormat::OFFSET_16BIT_BE:
+      out[0] = static_cast<uint8_t>(offset >> 8);
+      out[1] = static_cast<uint8_t>(offset & 0xFF);
+      return 2;
+    case I2CRegisterOffsetFormat::OFFSET_16BIT_LE:
+    default:
+      out[0] = static_cast<uint8_t>(offset & 0xFF);
+      out[1] = static_cast<uint8_t>(offset >> 8);
+      return 2;
+  }
+}
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP_REGISTER_OFFSET_HPP_
@@ -0,0 +1,112 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP__RESULT_HPP_
+#define ROS2_I2CCPP__RESULT_HPP_
+#pragma once
+
+#include <system_error>
+#include <utility>
+
+#include "ros2_i2ccpp/exceptions.hpp"
+
+namespace ros2_i2ccpp
+{
+
+/**
+ * Error code of a failed operation, from its errno.
+ */
+inline std::error_code make_i2c_error(int error_number) noexcept
+{
+  return std::error_code{error_number, std::generic_category()};
+}
+
+/**
+ * Error code of a request the handler refused before reaching the adapter, see
+ * exceptions::precondition_category.
+ */
+inline std::error_code make_i2c_precondition_error(int error_number) noexcept
+{
+  return std::error_code{error_number, exceptions::precondition_category()};
+}
+
+/**
+ * Outcome of a non-throwing operation (the try_ variants), either a value or an errno-based error.
+ *
+ * Besides the errors of the syscalls, operations report EBADF if the adapter is not opened,
+ * EOPNOTSUPP if the adapter lacks the needed functionality and EMSGSIZE if the request does not
+ * fit in a single SMBus or I2C transfer.
+ * These come from the checks of the handler and are thrown as IllegalOperationException, while the
+ * errors of the syscalls are thrown as SysException.
+ */
+template<typename T>
+class I2CResult {
+public:
+  I2CResult(T value_) noexcept
+  : stored_value(std::move(value_)) {}
+
+  I2CResult(std::error_code error_) noexcept
+  : stored_error(error_) {}
+
+  [[nodiscard]] bool has_value() const noexcept {return !stored_error;}
+  explicit operator bool() const noexcept {return has_value();}
+
+  [[nodiscard]] const std::error_code & error() const noexcept {return stored_error;}
+
+  /**
+   * Get the value, throws the exception matching the error if there is none (see throw_error).
+   */
+  [[nodiscard]] const T & value(const char * what = "I2C operation failed") const
+  {
+    if (stored_error) {
+      exceptions::throw_error(stored_error, what);
+    }
+    return stored_value;
+  }
+
+  [[nodiscard]] T value_or(T fallback) const noexcept
+  {
+    return stored_error ? std::move(fallback) : stored_value;
+  }
+
+  // unchecked access, only valid if has_value()
+  [[nodiscard]] const T & operator*() const noexcept {return stored_value;}
+  [[nodiscard]] const T * operator->() const noexcept {return &stored_value;}
+
+private:
+  T stored_value{};
+  std::error_code stored_error;
+};
+
+template<>
+class I2CResult<void> {
+public:
+  I2CResult() noexcept = default;
+
+  I2CResult(std::error_code error_) noexcept
+  : stored_error(error_) {}
+
+  [[nodiscard]] bool has_value() const noexcept {return !stored_error;}
+  explicit operator bool() const noexcept {return has_value();}
+
+  [[nodiscard]] const std::error_code & error() const noexcept {return stored_error;}
+
+  /**
+   * Throw the exception matching the error, if any (see throw_error).
+   */
+  void value(const char * what = "I2C operation failed") const
+  {
+    if (stored_error) {
+      exceptions::throw_error(stored_error, what);
+    }
+  }
+
+private:
+  std::error_code stored_error;
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP__RESULT_HPP_
@@ -0,0 +1,93 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP__RETRY_POLICY_HPP_
+#define ROS2_I2CCPP__RETRY_POLICY_HPP_
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#include "ros2_i2ccpp/constants.hpp"
+
+namespace ros2_i2ccpp
+{
+
+/**
+ * How hard a handler tries before reporting a failed transfer.
+ *
+ * The adapter limits are applied through I2C_RETRIES and I2C_TIMEOUT, and only when they change.
+ * The kernel keeps them per adapter, so they are shared by every open of /dev/i2c-N: changing them
+ * also changes the limits of the other processes using the bus. The kernel only repeats
+ * transfers that lost arbitration, so NAKs and timeouts are retried in userspace: the transaction
+ * is attempted again after an exponential backoff, during which the handler is unlocked, until
+ * max_attempts is reached or the next attempt would start after the retry budget. Transactions
+ * split into several transfers resume at the transfer that failed.
+ * Only transient errors are retried (see is_retryable), and writes are repeated as well, so
+ * transactions retried this way should be idempotent.
+ *
+ * The default policy makes a single attempt and leaves the adapter limits to the driver.
+ */
+struct I2CRetryPolicy
+{
+  static constexpr int32_t DRIVER_DEFAULT_RETRIES = -1;
+
+  // I2C_RETRIES, or DRIVER_DEFAULT_RETRIES to leave it untouched
+  int32_t adapter_retries{DRIVER_DEFAULT_RETRIES};
+
+  // I2C_TIMEOUT, rounded up to 10 ms, or zero to leave it untouched
+  // this bounds how long a slave stretching the clock can keep the bus
+  std::chrono::milliseconds adapter_timeout{0};
+
+  // attempts of the whole transaction, including the first one
+  uint32_t max_attempts{1};
+
+  // wait before the second attempt, doubled after each failure up to max_backoff
+  std::chrono::microseconds initial_backoff{100};
+  std::chrono::microseconds max_backoff{std::chrono::milliseconds{2}};
+
+  // no attempt starts later than this after the first one, zero for no limit
+  std::chrono::microseconds retry_budget{0};
+
+  /**
+   * Whether a failure with this errno may succeed if attempted again: NAKs (ENXIO, EREMOTEIO),
+   * lost arbitration (EAGAIN), timeouts (ETIMEDOUT), bus errors (EIO) and corrupted replies
+   * (EPROTO, EBADMSG). Misuse, missing functionality and closed adapters are not retried.
+   */
+  [[nodiscard]] static bool is_retryable(int error);
+
+  /**
+   * Suggested policy for requests of a priority class: the more urgent the class, the shorter the
+   * adapter timeout and the retry budget, so a misbehaving device cannot stretch their tail
+   * latency. They retry writes as well and set the adapter limits, so they are only used where
+   * the caller opts into them.
+   */
+  [[nodiscard]] static I2CRetryPolicy for_priority(I2CPriorityClass priority);
+
+  /**
+   * Wait after the given failed attempt, counting from 1.
+   */
+  [[nodiscard]] std::chrono::microseconds get_backoff(uint32_t attempt) const
+  {
+    auto backoff = initial_backoff;
+    for (uint32_t i = 1; i < attempt && backoff < max_backoff; i++) {
+      backoff *= 2;
+    }
+    return std::min(backoff, max_backoff);
+  }
+
+  /**
+   * I2C_TIMEOUT argument of adapter_timeout, in 10 ms units.
+   */
+  [[nodiscard]] uint32_t get_adapter_timeout_units() const
+  {
+    return static_cast<uint32_t>((adapter_timeout.count() + 9) / 10);
+  }
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP__RETRY_POLICY_HPP_
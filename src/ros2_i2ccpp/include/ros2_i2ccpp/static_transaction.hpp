@@ -0,0 +1,191 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP_STATIC_TRANSACTION_HPP_
+#define ROS2_I2CCPP_STATIC_TRANSACTION_HPP_
+#pragma once
+
+extern "C"
+{
+#include <linux/i2c.h>
+}
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+
+#include "ros2_i2ccpp/constants.hpp"
+#include "ros2_i2ccpp/transaction.hpp"
+
+namespace ros2_i2ccpp
+{
+
+/**
+ * Add message flags to a segment of an I2CStaticTransaction, e.g.
+ * I2CStaticSegmentFlags<I2CReadTransactionSegment<uint8_t>, I2CMessageFlags::M_STOP>.
+ */
+template<typename SegmentT, uint16_t Flags>
+struct I2CStaticSegmentFlags {};
+
+/**
+ * Describes how a segment type is laid out in an I2CStaticTransaction.
+ */
+template<typename SegmentT>
+struct I2CStaticSegmentTraits;
+
+template<typename PODType>
+struct I2CStaticSegmentTraits<I2CWriteTransactionSegment<PODType>>
+{
+  static_assert(std::is_standard_layout_v<PODType>&& std::is_trivially_copyable_v<PODType>,
+      "Type data must be of a POD type and trivially copyable");
+
+  using pod_type = PODType;
+  static constexpr bool is_read = false;
+  static constexpr uint16_t flags = 0;
+};
+
+template<typename PODType>
+struct I2CStaticSegmentTraits<I2CReadTransactionSegment<PODType>>
+{
+  static_assert(std::is_standard_layout_v<PODType>&& std::is_trivially_copyable_v<PODType>,
+      "Type data must be of a POD type and trivially copyable");
+
+  using pod_type = PODType;
+  static constexpr bool is_read = true;
+  static constexpr uint16_t flags = I2CMessageFlags::M_RD;
+};
+
+template<typename SegmentT, uint16_t Flags>
+struct I2CStaticSegmentTraits<I2CStaticSegmentFlags<SegmentT, Flags>>
+  : I2CStaticSegmentTraits<SegmentT>
+{
+  static constexpr uint16_t flags = I2CStaticSegmentTraits<SegmentT>::flags | Flags;
+};
+
+/**
+ * Transaction whose shape is fixed at compile time, e.g. a register read:
+ *
+ *   I2CStaticTransaction<I2CWriteTransactionSegment<uint8_t>,
+ *     I2CReadTransactionSegment<ImuSample>> read_imu(0x68);
+ *   read_imu.set<0>(uint8_t{0x3B});
+ *   handler.apply_transaction(read_imu);
+ *   const auto sample = read_imu.get<1>();
+ *
+ * The message lengths, flags and buffer offsets are computed at compile time, and all payloads
+ * share a single packed buffer, so executing it is a single ioctl without any bookkeeping.
+ */
+template<typename ... SegmentsT>
+class I2CStaticTransaction {
+public:
+  static constexpr std::size_t MESSAGE_COUNT = sizeof...(SegmentsT);
+
+  static_assert(MESSAGE_COUNT > 0, "A transaction needs at least one segment!");
+  static_assert(MESSAGE_COUNT <= I2CConstants::I2C_TRANSACTION_IOCTL_MAX_MSGS,
+      "Too many segments for a single transaction!");
+
+  template<std::size_t I>
+  using pod_type = typename I2CStaticSegmentTraits<
+    std::tuple_element_t<I, std::tuple<SegmentsT...>>>::pod_type;
+
+  static constexpr std::array<uint16_t, MESSAGE_COUNT> MESSAGE_SIZES{
+    static_cast<uint16_t>(sizeof(typename I2CStaticSegmentTraits<SegmentsT>::pod_type))...};
+
+  static constexpr std::array<bool, MESSAGE_COUNT> IS_READ{
+    I2CStaticSegmentTraits<SegmentsT>::is_read ...};
+
+  static constexpr std::array<std::size_t, MESSAGE_COUNT> BUFFER_OFFSETS = [] {
+      std::array<std::size_t, MESSAGE_COUNT> offsets{};
+      std::size_t offset = 0;
+      for (std::size_t i = 0; i < MESSAGE_COUNT; i++) {
+        offsets[i] = offset;
+        offset += MESSAGE_SIZES[i];
+      }
+      return offsets;
+    }();
+
+  static constexpr std::size_t BUFFER_SIZE =
+    BUFFER_OFFSETS[MESSAGE_COUNT - 1] + MESSAGE_SIZES[MESSAGE_COUNT - 1];
+
+  /**
+   * Message layout without the address and buffer, which are only known at runtime.
+   */
+  static constexpr std::array<i2c_msg, MESSAGE_COUNT> MESSAGE_LAYOUT{
+    i2c_msg{0, I2CStaticSegmentTraits<SegmentsT>::flags,
+      static_cast<uint16_t>(sizeof(typename I2CStaticSegmentTraits<SegmentsT>::pod_type)),
+      nullptr}...};
+
+  explicit I2CStaticTransaction(uint16_t device_address_)
+  {
+    bind(device_address_);
+  }
+
+  // messages point into the buffer, so copies have to be rebound
+  I2CStaticTransaction(const I2CStaticTransaction & other)
+  : buffer(other.buffer)
+  {
+    bind(other.messages[0].addr);
+  }
+
+  I2CStaticTransaction & operator=(const I2CStaticTransaction & other)
+  {
+    buffer = other.buffer;
+    bind(other.messages[0].addr);
+    return *this;
+  }
+
+  /**
+   * Set the data sent by the I-th segment, which must be a write.
+   */
+  template<std::size_t I>
+  I2CStaticTransaction & set(const pod_type<I> & value)
+  {
+    static_assert(!IS_READ[I], "Only write segments can be set!");
+    std::memcpy(buffer.data() + BUFFER_OFFSETS[I], &value, sizeof(pod_type<I>));
+    return *this;
+  }
+
+  /**
+   * Get the data of the I-th segment, i.e. what was received for read segments.
+   */
+  template<std::size_t I>
+  [[nodiscard]] pod_type<I> get() const
+  {
+    pod_type<I> value;
+    get<I>(value);
+    return value;
+  }
+
+  template<std::size_t I>
+  void get(pod_type<I> & value) const
+  {
+    std::memcpy(&value, buffer.data() + BUFFER_OFFSETS[I], sizeof(pod_type<I>));
+  }
+
+  [[nodiscard]] i2c_msg * get_messages() {return messages.data();}
+  [[nodiscard]] static constexpr uint32_t get_message_count() {return MESSAGE_COUNT;}
+  [[nodiscard]] uint16_t get_device_address() const {return messages[0].addr;}
+
+private:
+  void bind(uint16_t device_address)
+  {
+    for (std::size_t i = 0; i < MESSAGE_COUNT; i++) {
+      messages[i] = MESSAGE_LAYOUT[i];
+      messages[i].addr = device_address;
+      messages[i].buf = buffer.data() + BUFFER_OFFSETS[i];
+    }
+  }
+
+  std::array<i2c_msg, MESSAGE_COUNT> messages;
+
+  // payloads of all segments, packed back to back
+  std::array<uint8_t, BUFFER_SIZE> buffer{};
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP_STATIC_TRANSACTION_HPP_
@@ -0,0 +1,202 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP__STATISTICS_HPP_
+#define ROS2_I2CCPP__STATISTICS_HPP_
+#pragma once
+
+extern "C"
+{
+#include <linux/i2c.h>
+}
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ros2_i2ccpp
+{
+
+/**
+ * Latency histogram with logarithmic buckets, each power of two split in 8 linear sub-buckets
+ * (as in HdrHistogram), so values are kept within 12.5% from 1 ns up to about a minute.
+ */
+class I2CLatencyHistogram {
+public:
+  static constexpr uint32_t SUB_BUCKET_BITS = 3;
+  static constexpr uint32_t SUB_BUCKET_COUNT = 1U << SUB_BUCKET_BITS;
+
+  // values from 2^MAX_EXPONENT ns (~69 s) on go to the last bucket
+  static constexpr uint32_t MAX_EXPONENT = 36;
+  static constexpr std::size_t BUCKET_COUNT =
+    SUB_BUCKET_COUNT + (MAX_EXPONENT - SUB_BUCKET_BITS) * SUB_BUCKET_COUNT;
+
+  /**
+   * Bucket holding a value in nanoseconds.
+   */
+  [[nodiscard]] static std::size_t get_bucket(uint64_t value);
+
+  /**
+   * Smallest value held by a bucket, in nanoseconds.
+   */
+  [[nodiscard]] static uint64_t get_bucket_start(std::size_t bucket);
+
+  void record(std::chrono::nanoseconds value);
+
+  /**
+   * Add the samples of another histogram.
+   */
+  void merge(const I2CLatencyHistogram & other);
+
+  [[nodiscard]] uint64_t get_count() const {return count;}
+  [[nodiscard]] std::chrono::nanoseconds get_min() const;
+  [[nodiscard]] std::chrono::nanoseconds get_max() const {return std::chrono::nanoseconds{max};}
+  [[nodiscard]] std::chrono::nanoseconds get_mean() const;
+
+  /**
+   * Value below which the given percentage of the samples fall, e.g. 99.9, up to bucket precision.
+   */
+  [[nodiscard]] std::chrono::nanoseconds get_percentile(double percentile) const;
+
+  [[nodiscard]] const std::array<uint64_t, BUCKET_COUNT> & get_buckets() const {return buckets;}
+
+private:
+  friend class I2CStatisticsRecorder;
+
+  std::array<uint64_t, BUCKET_COUNT> buckets{};
+  uint64_t count{0};
+  uint64_t sum{0};
+  uint64_t min{UINT64_MAX};
+  uint64_t max{0};
+};
+
+/**
+ * Counters of the transactions sent to a device, the first one addressed by each transaction.
+ */
+struct I2CDeviceStatistics
+{
+  uint64_t transactions{0};
+  uint64_t messages{0};
+  uint64_t bytes_written{0};
+  uint64_t bytes_read{0};
+  uint64_t errors{0};
+
+  // time spent in the adapter driver, from the ioctl to its return
+  I2CLatencyHistogram transfer_time;
+};
+
+/**
+ * Counters of an I2CHandler since its statistics were enabled.
+ * Every attempt of a retried transaction counts as a transaction.
+ */
+struct I2CHandlerStatistics
+{
+  uint64_t transactions{0};
+  uint64_t messages{0};
+  uint64_t bytes_written{0};
+  uint64_t bytes_read{0};
+
+  // failed transactions by errno
+  std::map<int, uint64_t> errors;
+
+  // time waiting for the handler mutex, and holding it, e.g. for a transaction and its retries
+  I2CLatencyHistogram lock_wait_time;
+  I2CLatencyHistogram lock_hold_time;
+  I2CLatencyHistogram transfer_time;
+
+  std::map<uint16_t, I2CDeviceStatistics> devices;
+};
+
+/**
+ * Collects the statistics of a handler.
+ *
+ * Every thread records into its own cache-line aligned shard, with relaxed stores since it is the
+ * only writer, so recording never contends with other threads nor with get_statistics, which
+ * merges the shards without stopping the recording threads.
+ */
+class I2CStatisticsRecorder {
+public:
+  I2CStatisticsRecorder();
+  ~I2CStatisticsRecorder();
+
+  I2CStatisticsRecorder(const I2CStatisticsRecorder &) = delete;
+  I2CStatisticsRecorder & operator=(const I2CStatisticsRecorder &) = delete;
+
+  void record_lock_wait(std::chrono::nanoseconds wait_time);
+  void record_lock_hold(std::chrono::nanoseconds hold_time);
+
+  /**
+   * Record a transaction, error is its errno or 0 if it succeeded.
+   */
+  void record_transfer(
+    const i2c_msg * messages, uint32_t message_count,
+    std::chrono::nanoseconds transfer_time, int error);
+
+  [[nodiscard]] I2CHandlerStatistics get_statistics() const;
+
+private:
+  // errno values past the last one are counted together
+  static constexpr std::size_t ERRNO_COUNT = 136;
+
+  // histogram written by a single thread
+  struct Histogram
+  {
+    void record(uint64_t value);
+    void read(I2CLatencyHistogram & histogram) const;
+
+    std::array<std::atomic<uint64_t>, I2CLatencyHistogram::BUCKET_COUNT> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> min{UINT64_MAX};
+    std::atomic<uint64_t> max{0};
+  };
+
+  struct DeviceShard
+  {
+    std::atomic<uint64_t> transactions{0};
+    std::atomic<uint64_t> messages{0};
+    std::atomic<uint64_t> bytes_written{0};
+    std::atomic<uint64_t> bytes_read{0};
+    std::atomic<uint64_t> errors{0};
+    Histogram transfer_time;
+  };
+
+  struct alignas(64) Shard
+  {
+    std::atomic<uint64_t> transactions{0};
+    std::atomic<uint64_t> messages{0};
+    std::atomic<uint64_t> bytes_written{0};
+    std::atomic<uint64_t> bytes_read{0};
+    std::array<std::atomic<uint64_t>, ERRNO_COUNT + 1> errors{};
+    Histogram lock_wait_time;
+    Histogram lock_hold_time;
+    Histogram transfer_time;
+
+    // indexed by the 10-bit device address, allocated on first use by the owning thread
+    std::array<std::atomic<DeviceShard *>, 1024> devices{};
+    std::vector<std::unique_ptr<DeviceShard>> device_storage;
+  };
+
+  /**
+   * Shard of the calling thread, created on its first use.
+   */
+  Shard & get_shard();
+
+  // tells recorders apart in the per-thread shard caches, never reused
+  const uint64_t id;
+
+  mutable std::mutex shards_mutex;
+  std::vector<std::unique_ptr<Shard>> shards;
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP__STATISTICS_HPP_
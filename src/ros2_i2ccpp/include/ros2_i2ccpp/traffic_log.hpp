@@ -0,0 +1,290 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP__TRAFFIC_LOG_HPP_
+#define ROS2_I2CCPP__TRAFFIC_LOG_HPP_
+#pragma once
+
+extern "C"
+{
+#include <linux/i2c.h>
+}
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ros2_i2ccpp/statistics.hpp"
+
+namespace ros2_i2ccpp
+{
+
+class I2CBackend;
+
+/**
+ * Binary log of the traffic of one or more adapters, written by RecordingI2CBackend.
+ *
+ * The file is an I2CTrafficLogHeader followed by records, each an I2CTrafficRecord and a body
+ * padded to 8 bytes, so the log can be mapped and walked in place. Every field is in the byte
+ * order of the machine that wrote it, which the byte order mark of the header gives away.
+ *
+ * Bodies by record type:
+ * - RECORD_ADAPTER: the adapter path, count bytes long.
+ * - RECORD_TRANSFER: count I2CTrafficMessage, then the payload of each message as left by the
+ *   transfer (what was written, or what was read). M_RECV_LEN messages thus hold the block count
+ *   received in their first byte, rather than the bytes read besides the block.
+ * - RECORD_SMBUS: an I2CTrafficSMBusCall, then the i2c_smbus_data before and after the call.
+ * - RECORD_CONTROL: an I2CTrafficControl.
+ */
+enum I2CTrafficRecordType: uint16_t
+{
+  RECORD_ADAPTER = 0,   // an adapter was opened, later records refer to it by its id
+  RECORD_TRANSFER = 1,  // combined transfer (I2C_RDWR)
+  RECORD_SMBUS = 2,     // SMBus operation (I2C_SMBUS)
+  RECORD_CONTROL = 3,   // change of the adapter state (I2C_SLAVE, I2C_TENBIT, I2C_PEC, ...)
+};
+
+struct I2CTrafficLogHeader
+{
+  static constexpr char MAGIC[8] = {'I', '2', 'C', 'T', 'R', 'A', 'F', '\0'};
+  static constexpr uint32_t VERSION = 1;
+  static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t header_size;
+  uint32_t byte_order;  // BYTE_ORDER_MARK, reads back swapped on a machine of the other order
+  uint32_t reserved;
+
+  // CLOCK_MONOTONIC (as the record timestamps and LTTng) and CLOCK_REALTIME when recording started
+  int64_t monotonic_start_ns;
+  int64_t realtime_start_ns;
+};
+
+struct I2CTrafficRecord
+{
+  uint32_t size;         // of the whole record, padding included
+  uint16_t type;         // I2CTrafficRecordType
+  uint16_t adapter;      // id of the adapter, in order of the RECORD_ADAPTER records
+  int64_t timestamp_ns;  // CLOCK_MONOTONIC when the call started
+  int64_t duration_ns;
+  int32_t result;        // 0 or the errno of the failure
+  uint32_t count;        // messages of a transfer, length of an adapter path
+};
+
+struct I2CTrafficMessage
+{
+  uint16_t addr;
+  uint16_t flags;
+  uint16_t len;
+  uint16_t reserved;
+};
+
+struct I2CTrafficSMBusCall
+{
+  uint16_t addr;       // slave address selected when the call was made
+  uint8_t read_write;
+  uint8_t command;
+  uint32_t size;       // SMBus protocol, e.g. I2C_SMBUS_BYTE_DATA
+};
+
+struct I2CTrafficControl
+{
+  uint64_t command;    // I2CIOControlCommands
+  uint64_t value;
+};
+
+static_assert(sizeof(I2CTrafficLogHeader) == 40 && sizeof(I2CTrafficRecord) == 32 &&
+  sizeof(I2CTrafficMessage) == 8 && sizeof(I2CTrafficSMBusCall) == 8 &&
+  sizeof(I2CTrafficControl) == 16, "the log layout must not depend on the compiler");
+
+/**
+ * Writes a traffic log, can be shared by several RecordingI2CBackend and used from any thread.
+ *
+ * Records are appended to a staging buffer, which is written to the file whenever it fills up, on
+ * flush and on destruction, so recording only costs a copy and a lock most of the time.
+ */
+class I2CTrafficRecorder {
+public:
+  static constexpr std::size_t DEFAULT_BUFFER_SIZE = 1 << 20;
+
+  explicit I2CTrafficRecorder(
+    const std::string & path,
+    std::size_t buffer_size = DEFAULT_BUFFER_SIZE);
+  ~I2CTrafficRecorder();
+
+  I2CTrafficRecorder(const I2CTrafficRecorder &) = delete;
+  I2CTrafficRecorder & operator=(const I2CTrafficRecorder &) = delete;
+
+  /**
+   * Record that an adapter was opened, returns the id of its later records.
+   */
+  uint16_t add_adapter(const std::string & i2c_adapter_path);
+
+  void record_transfer(
+    uint16_t adapter, std::chrono::steady_clock::time_point start,
+    std::chrono::nanoseconds duration, int result, const i2c_msg * messages,
+    uint32_t message_count);
+
+  void record_smbus(
+    uint16_t adapter, std::chrono::steady_clock::time_point start,
+    std::chrono::nanoseconds duration, int result, const I2CTrafficSMBusCall & call,
+    const i2c_smbus_data & data_before, const i2c_smbus_data & data_after);
+
+  void record_control(
+    uint16_t adapter, std::chrono::steady_clock::time_point start,
+    std::chrono::nanoseconds duration, int result, uint64_t command, uint64_t value);
+
+  /**
+   * Write the staged records to the file.
+   */
+  void flush();
+
+private:
+  /**
+   * Start a record with a body of body_size bytes, returns where the body goes.
+   * The lock must be held.
+   */
+  uint8_t * append(
+    uint16_t type, uint16_t adapter, std::chrono::steady_clock::time_point start,
+    std::chrono::nanoseconds duration, int result, uint32_t count, std::size_t body_size);
+
+  void write_staged();
+
+  int file_desc;
+  std::mutex mut;
+  std::vector<uint8_t> staging;
+  std::size_t staged{0};
+  uint16_t adapter_count{0};
+};
+
+/**
+ * A record of a mapped log, pointing into the mapping.
+ */
+struct I2CTrafficEntry
+{
+  const I2CTrafficRecord * record{nullptr};
+  const uint8_t * body{nullptr};
+
+  [[nodiscard]] I2CTrafficRecordType get_type() const
+  {
+    return static_cast<I2CTrafficRecordType>(record->type);
+  }
+
+  [[nodiscard]] std::chrono::nanoseconds get_duration() const
+  {
+    return std::chrono::nanoseconds{record->duration_ns};
+  }
+
+  // RECORD_TRANSFER, the payloads of the messages follow each other
+  [[nodiscard]] const I2CTrafficMessage * get_messages() const;
+  [[nodiscard]] const uint8_t * get_payloads() const;
+
+  // RECORD_SMBUS
+  [[nodiscard]] const I2CTrafficSMBusCall & get_smbus_call() const;
+  [[nodiscard]] const i2c_smbus_data & get_smbus_data_before() const;
+  [[nodiscard]] const i2c_smbus_data & get_smbus_data_after() const;
+
+  // RECORD_CONTROL
+  [[nodiscard]] const I2CTrafficControl & get_control() const;
+
+  // RECORD_ADAPTER
+  [[nodiscard]] std::string get_adapter_path() const;
+};
+
+/**
+ * Read-only mapping of a traffic log.
+ */
+class I2CTrafficLog {
+public:
+  explicit I2CTrafficLog(const std::string & path);
+  ~I2CTrafficLog();
+
+  I2CTrafficLog(const I2CTrafficLog &) = delete;
+  I2CTrafficLog & operator=(const I2CTrafficLog &) = delete;
+
+  [[nodiscard]] const I2CTrafficLogHeader & get_header() const;
+
+  /**
+   * Entry after the given one, or the first one if entry is empty.
+   * Returns false at the end of the log, or at a record cut short, e.g. by a crash.
+   */
+  bool next(I2CTrafficEntry & entry) const;
+
+  /**
+   * Paths of the adapters, indexed by their id.
+   */
+  [[nodiscard]] std::vector<std::string> get_adapters() const;
+
+private:
+  const uint8_t * data{nullptr};
+  std::size_t size{0};
+};
+
+/**
+ * How an I2CTrafficReplayer re-issues a log.
+ */
+struct I2CTrafficReplayOptions
+{
+  // 1 keeps the original pace, 2 replays twice as fast, 0 sends every record right away
+  double speed{1.0};
+
+  // only replay the records of this adapter id, or of every adapter if negative
+  int32_t adapter{-1};
+};
+
+/**
+ * Outcome of a replay, to compare the recorded and replayed timings.
+ */
+struct I2CTrafficReplayResult
+{
+  uint64_t records{0};
+  uint64_t transfers{0};
+  uint64_t smbus_calls{0};
+
+  // records that failed where they had succeeded, or the opposite
+  uint64_t result_mismatches{0};
+
+  // reads that returned other data than recorded
+  uint64_t data_mismatches{0};
+
+  // time the replayed calls were started after their scheduled time
+  I2CLatencyHistogram lag;
+
+  I2CLatencyHistogram recorded_duration;
+  I2CLatencyHistogram replayed_duration;
+  std::chrono::nanoseconds elapsed{0};
+};
+
+/**
+ * Re-issues the transfers and SMBus operations of a log through a backend, e.g. an I2CDevBackend
+ * on a desk setup or a SimulatedI2CBackend, along with the adapter state changes they relied on.
+ * The backend must be opened.
+ */
+class I2CTrafficReplayer {
+public:
+  I2CTrafficReplayer(const I2CTrafficLog & log_, I2CBackend & backend_);
+
+  I2CTrafficReplayResult replay(const I2CTrafficReplayOptions & options = {});
+
+private:
+  int replay_transfer(const I2CTrafficEntry & entry, I2CTrafficReplayResult & result);
+  int replay_smbus(const I2CTrafficEntry & entry, I2CTrafficReplayResult & result);
+  int replay_control(const I2CTrafficEntry & entry);
+
+  const I2CTrafficLog & log;
+  I2CBackend & backend;
+
+  // message headers and buffers of the transfer being replayed
+  std::vector<i2c_msg> messages;
+  std::vector<uint8_t> buffers;
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP__TRAFFIC_LOG_HPP_
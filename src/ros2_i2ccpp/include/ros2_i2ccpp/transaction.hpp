@@ -2,22 +2,30 @@
 #define ROS2_I2CCPP_TRANSACTION_HPP_
 #pragma once
 
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
 #include <cstdint>
 #include <type_traits>
 #include <utility>
 #include <memory_resource>
 #include <memory>
 #include <array>
+#include <optional>
+#include <vector>
 
 #include "ros2_i2ccpp/constants.hpp"
 #include "ros2_i2ccpp/exceptions.hpp"
 #include "ros2_i2ccpp/pmr_shared_ptr.hpp"
 #include "ros2_i2ccpp/bit_cast.hpp"
-class i2c_msg;
+#include "ros2_i2ccpp/register_offset.hpp"
+#include "ros2_i2ccpp/impl/smbus_transfer.hpp"
 
 namespace ros2_i2ccpp
 {
 
+class I2CPreparedTransaction;
+
 
 class I2CTransactionSegment{
 public:
@@ -37,12 +45,24 @@ public:
   virtual uint8_t * get_data() = 0;
   virtual uint16_t get_data_size() const = 0;
 
+  /**
+   * Publish the data received by this segment to its destination, if it has one.
+   * Returns 0, or the errno describing why the data received is invalid.
+   */
+  virtual int commit() {return 0;}
+
+  /**
+   * Restore the bytes of the buffer that the adapter reads before filling it, if the previous
+   * execution overwrote them. Called before every execution, including retries.
+   */
+  virtual void rearm() {}
+
   uint16_t get_address() const {return address;}
   uint16_t get_message_flags() const {return message_flags;}
 
 private:
   uint16_t address;
-  uint16_t message_flags;
+  uint16_t message_flags{0};
 };
 
 template<typename PODType>
@@ -60,9 +80,10 @@ public:
     append_flags(I2CMessageFlags::M_RD, std::forward<MessageFlagsT>(flags)...);
   }
 
-  ~I2CReadTransactionSegment()
+  int commit() final
   {
     data = bit_cast<PODType>(buffer);
+    return 0;
   }
 
   uint8_t * get_data() final
@@ -77,11 +98,51 @@ public:
 
 private:
   // to avoid UB, we make a buffer to access the data as uint8_t*
-  // and when the segment is destroyed, we copy everything to data
+  // and once the transaction has been executed, commit() copies everything to data
   PODType & data;
   std::array<uint8_t, sizeof(PODType)> buffer;
 };
 
+/**
+ * Read segment that points the message straight at caller-provided storage, so the received data
+ * is written in place and is visible as soon as the transaction has been executed.
+ * The storage must outlive the transaction.
+ */
+class I2CInPlaceReadTransactionSegment : public I2CTransactionSegment {
+public:
+  template<typename ...MessageFlagsT>
+  I2CInPlaceReadTransactionSegment(
+    uint16_t address_, uint8_t * data_, std::size_t size_,
+    MessageFlagsT... flags)
+  : I2CTransactionSegment(address_), data(data_), size(checked_size(size_))
+  {
+    append_flags(I2CMessageFlags::M_RD, std::forward<MessageFlagsT>(flags)...);
+  }
+
+  uint8_t * get_data() final
+  {
+    return data;
+  }
+
+  uint16_t get_data_size() const final
+  {
+    return size;
+  }
+
+private:
+  static uint16_t checked_size(std::size_t size)
+  {
+    if (size > UINT16_MAX) {
+      ROS2_I2CCPP_THROW(
+        exceptions::IllegalOperationException("Message is too large for a single segment!"));
+    }
+    return static_cast<uint16_t>(size);
+  }
+
+  uint8_t * data;
+  uint16_t size;
+};
+
 template<typename PODType>
 class I2CWriteTransactionSegment : public I2CTransactionSegment {
   static_assert(std::is_standard_layout_v<PODType>&& std::is_trivially_copyable_v<PODType>,
@@ -111,25 +172,196 @@ private:
   std::array<uint8_t, sizeof(PODType)> buffer;
 };
 
+/**
+ * Write segment with a growable payload, so that a register offset and its data, or consecutive
+ * writes to the same device, are sent as a single message.
+ */
+class I2CBufferWriteTransactionSegment : public I2CTransactionSegment {
+public:
+  template<typename ...MessageFlagsT>
+  I2CBufferWriteTransactionSegment(
+    uint16_t address_, std::pmr::memory_resource & mr,
+    MessageFlagsT... flags)
+  : I2CTransactionSegment(address_), buffer(&mr)
+  {
+    append_flags(flags ...);
+  }
+
+  void append(const uint8_t * data, std::size_t size)
+  {
+    if (buffer.size() + size > UINT16_MAX) {
+      ROS2_I2CCPP_THROW(
+        exceptions::IllegalOperationException("Message is too large for a single segment!"));
+    }
+    buffer.insert(buffer.end(), data, data + size);
+  }
+
+  uint8_t * get_data() final
+  {
+    return buffer.data();
+  }
+
+  uint16_t get_data_size() const final
+  {
+    return static_cast<uint16_t>(buffer.size());
+  }
+
+private:
+  std::pmr::vector<uint8_t> buffer;
+};
+
+/**
+ * Data of an SMBus block, up to SMBUS_BLOCK_MAX bytes.
+ */
+struct I2CSMBusBlock
+{
+  uint8_t length{0};
+  std::array<uint8_t, I2CConstants::SMBUS_BLOCK_MAX> data{};
+};
+
+/**
+ * Read part of an SMBus operation, laid out as in the kernel SMBus emulation.
+ *
+ * The data is decoded into the destination on commit, which fails with EPROTO if the block length
+ * received is invalid and with EBADMSG if the PEC does not match. Blocks (SMBus block read and
+ * block process call) are read with M_RECV_LEN, so the adapter must support it
+ * (see FUNC_SMBUS_READ_BLOCK_DATA).
+ */
+template<typename DestinationT>
+class I2CSMBusReadTransactionSegment : public I2CTransactionSegment {
+  static_assert(std::is_same_v<DestinationT, uint8_t>|| std::is_same_v<DestinationT, uint16_t>||
+    std::is_same_v<DestinationT, I2CSMBusBlock>,
+      "SMBus reads return a byte, a word or a block");
+
+  static constexpr bool IS_BLOCK = std::is_same_v<DestinationT, I2CSMBusBlock>;
+
+public:
+  /**
+   * If use_pec_ is set, initial_pec_ must hold the PEC of the write message sent before the read.
+   */
+  I2CSMBusReadTransactionSegment(
+    uint16_t address_, DestinationT & destination_,
+    bool use_pec_, uint8_t initial_pec_)
+  : I2CTransactionSegment(address_), destination(destination_), use_pec(use_pec_),
+    initial_pec(initial_pec_)
+  {
+    if constexpr (IS_BLOCK) {
+      append_flags(I2CMessageFlags::M_RD, I2CMessageFlags::M_RECV_LEN);
+    } else {
+      append_flags(I2CMessageFlags::M_RD);
+    }
+    rearm();
+  }
+
+  uint8_t * get_data() final
+  {
+    return buffer.data();
+  }
+
+  uint16_t get_data_size() const final
+  {
+    // i2c-dev wants room for the largest block on top of the bytes read besides it
+    const uint16_t size = IS_BLOCK ? I2CConstants::SMBUS_BLOCK_MAX + 1 : sizeof(DestinationT);
+    return use_pec ? size + 1 : size;
+  }
+
+  void rearm() final
+  {
+    if constexpr (IS_BLOCK) {
+      // M_RECV_LEN messages hold the bytes read besides the block in buf[0] (count and PEC),
+      // which the count received replaces
+      buffer[0] = use_pec ? 2 : 1;
+    }
+  }
+
+  int commit() final
+  {
+    uint16_t size = sizeof(DestinationT);
+    if constexpr (IS_BLOCK) {
+      if (buffer[0] == 0 || buffer[0] > I2CConstants::SMBUS_BLOCK_MAX) {
+        return EPROTO;
+      }
+      size = static_cast<uint16_t>(buffer[0] + 1);
+    }
+
+    if (use_pec) {
+      const i2c_msg received{get_address(), get_message_flags(), size, buffer.data()};
+      if (buffer[size] != smbus_message_pec(initial_pec, received)) {
+        return EBADMSG;
+      }
+    }
+
+    if constexpr (IS_BLOCK) {
+      destination.length = buffer[0];
+      std::copy_n(buffer.begin() + 1, buffer[0], destination.data.begin());
+    } else if constexpr (std::is_same_v<DestinationT, uint16_t>) {
+      // SMBus words are sent least significant byte first
+      destination = static_cast<uint16_t>(buffer[0] | (buffer[1] << 8));
+    } else {
+      destination = buffer[0];
+    }
+    return 0;
+  }
+
+private:
+  DestinationT & destination;
+  bool use_pec;
+  uint8_t initial_pec;
+
+  // count, data and PEC
+  std::array<uint8_t, I2CConstants::SMBUS_BLOCK_MAX + 2> buffer{};
+};
+
+/**
+ * Commit the segments of an executed transaction, returns 0 or the errno of the first segment whose
+ * data is invalid. All segments are committed either way.
+ */
+template<typename SegmentsT>
+int commit_segments(SegmentsT & segments)
+{
+  int result = 0;
+  for (auto & segment : segments) {
+    const auto error = segment->commit();
+    if (result == 0) {
+      result = error;
+    }
+  }
+  return result;
+}
+
+/**
+ * Rearm the segments of a transaction before executing it, from the first one that is sent.
+ */
+template<typename SegmentsT>
+void rearm_segments(SegmentsT & segments, std::size_t first = 0)
+{
+  for (auto it = segments.begin() + first; it != segments.end(); ++it) {
+    (*it)->rearm();
+  }
+}
+
 class I2CTransaction{
 public:
   // need to fulfill rule of 5
 
   I2CTransaction(
     std::pmr::memory_resource & mr,
-    std::pmr::vector<std::shared_ptr<I2CTransactionSegment>> && messages)
-  :mem_resource(mr), transaction_segments(std::move(messages)) {}
+    std::pmr::vector<std::shared_ptr<I2CTransactionSegment>> && messages,
+    bool allow_chunking_ = false)
+  :mem_resource(mr), transaction_segments(std::move(messages)), allow_chunking(allow_chunking_) {}
 
   ~I2CTransaction() = default;
 
   I2CTransaction(I2CTransaction && other) noexcept
   : mem_resource(other.mem_resource),
-    transaction_segments(std::exchange(other.transaction_segments, {})) {}
+    transaction_segments(std::exchange(other.transaction_segments, {})),
+    allow_chunking(other.allow_chunking) {}
 
   I2CTransaction & operator=(I2CTransaction && other) noexcept
   {
     transaction_segments = std::exchange(other.transaction_segments, {});
     mem_resource = other.mem_resource;
+    allow_chunking = other.allow_chunking;
 
     return *this;
   }
@@ -143,12 +375,20 @@ public:
     return transaction_segments;
   }
 
+  /**
+   * Check if the transaction may be split into several transfers.
+   */
+  bool is_chunking_allowed() const {return allow_chunking;}
+
 private:
   // memory resource that will be used for all memory allocations
   std::reference_wrapper<std::pmr::memory_resource> mem_resource;
 
   // list of transaction segments
   std::pmr::vector<std::shared_ptr<I2CTransactionSegment>> transaction_segments;
+
+  // whether the transaction may be split into several transfers
+  bool allow_chunking{false};
 };
 
 /**
@@ -159,26 +399,61 @@ public:
   I2CTransactionBuilderImpl(std::pmr::memory_resource & mr, uint16_t device_address_)
   : device_address(device_address_), transaction_segments(&mr), mem_resource(mr) {}
 
+  /**
+   * Set how register offsets are sent, 16-bit little endian by default.
+   */
+  I2CTransactionBuilderImpl & set_offset_format(I2CRegisterOffsetFormat format)
+  {
+    offset_format = format;
+    current_offset.reset();
+    return *this;
+  }
+
+  /**
+   * Write the given data. Consecutive writes without flags are merged into a single message.
+   */
   template<typename PODType, typename ...MessageFlagsT>
   I2CTransactionBuilderImpl & add_write(const PODType & pod, MessageFlagsT... flags)
   {
     static_assert(std::conjunction_v<std::is_same<I2CMessageFlags, MessageFlagsT>...>,
         "These should be all I2CMessageFlags!");
-    return add_write_impl(pod, std::forward<MessageFlagsT>(flags)...);
+    static_assert(std::is_standard_layout_v<PODType>&& std::is_trivially_copyable_v<PODType>,
+        "Type data must be of a POD type and trivially copyable");
+
+    // the device pointer is unknown after a raw write
+    current_offset.reset();
+
+    if (sizeof...(flags) > 0 || open_write == nullptr) {
+      start_write(flags ...);
+    }
+    append_write(reinterpret_cast<const uint8_t *>(&pod), sizeof(PODType), flags ...);
+    return *this;
   }
 
+  /**
+   * Write the given data to a register, sending the offset and the data in a single message.
+   * A write that continues where the previous one ended is appended to it, without the offset.
+   */
   template<typename PODType, typename ...MessageFlagsT>
   I2CTransactionBuilderImpl & add_write(
     uint16_t offset, const PODType & pod,
     MessageFlagsT... flags)
   {
-    if (current_offset != offset) {
-      // add an extra write to change the current offset
-      add_write_impl(offset);
-      current_offset = offset;
+    static_assert(std::conjunction_v<std::is_same<I2CMessageFlags, MessageFlagsT>...>,
+        "These should be all I2CMessageFlags!");
+    static_assert(std::is_standard_layout_v<PODType>&& std::is_trivially_copyable_v<PODType>,
+        "Type data must be of a POD type and trivially copyable");
+
+    if (sizeof...(flags) > 0 || open_write == nullptr || current_offset != offset) {
+      // start a new message, as the device reads the offset from its first bytes
+      start_write(flags ...);
+      append_offset(offset);
     }
+    append_write(reinterpret_cast<const uint8_t *>(&pod), sizeof(PODType), flags ...);
 
-    return add_write_impl(pod, std::forward<MessageFlagsT>(flags)...);
+    // assume the device auto increments its pointer
+    current_offset = static_cast<uint16_t>(offset + sizeof(PODType));
+    return *this;
   }
 
   template<typename PODType, typename ...MessageFlagsT>
@@ -186,38 +461,272 @@ public:
   {
     static_assert(std::conjunction_v<std::is_same<I2CMessageFlags, MessageFlagsT>...>,
         "These should be all I2CMessageFlags!");
+    advance_offset(sizeof(PODType));
     return add_read_impl(pod, std::forward<MessageFlagsT>(flags)...);
   }
 
+  /**
+   * Read from a register, the offset is only written if the device pointer is elsewhere.
+   */
   template<typename PODType, typename ...MessageFlagsT>
   I2CTransactionBuilderImpl & add_read(uint16_t offset, PODType & pod, MessageFlagsT... flags)
+  {
+    select_offset(offset);
+    return add_read(pod, flags ...);
+  }
+
+  /**
+   * Read into the given object without intermediate copies, the object must outlive the transaction.
+   */
+  template<typename PODType, typename ...MessageFlagsT>
+  auto add_read_in_place(PODType & pod, MessageFlagsT... flags)
+  -> std::enable_if_t<std::conjunction_v<std::is_same<I2CMessageFlags, MessageFlagsT>...>,
+    I2CTransactionBuilderImpl &>
+  {
+    static_assert(std::is_trivially_copyable_v<PODType>&& !std::is_pointer_v<PODType>,
+        "Type data must be trivially copyable");
+    return add_read_in_place(reinterpret_cast<uint8_t *>(&pod), sizeof(PODType), flags ...);
+  }
+
+  /**
+   * Read into the given bytes without intermediate copies, the bytes must outlive the transaction.
+   */
+  template<typename ...MessageFlagsT>
+  I2CTransactionBuilderImpl & add_read_in_place(
+    uint8_t * data, std::size_t size,
+    MessageFlagsT... flags)
   {
     static_assert(std::conjunction_v<std::is_same<I2CMessageFlags, MessageFlagsT>...>,
         "These should be all I2CMessageFlags!");
+    emplace_transaction<I2CInPlaceReadTransactionSegment>(device_address, data, size, flags ...);
+    advance_offset(size);
+    return *this;
+  }
+
+  template<typename PODType, typename ...MessageFlagsT>
+  I2CTransactionBuilderImpl & add_read_in_place(
+    uint16_t offset, PODType & pod,
+    MessageFlagsT... flags)
+  {
+    select_offset(offset);
+    return add_read_in_place(pod, flags ...);
+  }
+
+  /**
+   * Send and check a PEC byte on the SMBus operations added afterwards.
+   */
+  I2CTransactionBuilderImpl & set_smbus_pec(bool enable)
+  {
+    use_smbus_pec = enable;
+    return *this;
+  }
+
+  /**
+   * SMBus operations, sent as I2C messages like the kernel SMBus emulation does, so that any
+   * number of them can share a single transfer. Reads are available once the transaction has
+   * been applied.
+   */
+  I2CTransactionBuilderImpl & add_smbus_read_byte(uint8_t command, uint8_t & value)
+  {
+    return finish_smbus_read(emplace_smbus_write(command), value);
+  }
+
+  I2CTransactionBuilderImpl & add_smbus_write_byte(uint8_t command, uint8_t value)
+  {
+    auto & segment = emplace_smbus_write(command);
+    segment.append(&value, 1);
+    return finish_smbus_write(segment);
+  }
+
+  I2CTransactionBuilderImpl & add_smbus_read_word(uint8_t command, uint16_t & value)
+  {
+    return finish_smbus_read(emplace_smbus_write(command), value);
+  }
+
+  I2CTransactionBuilderImpl & add_smbus_write_word(uint8_t command, uint16_t value)
+  {
+    auto & segment = emplace_smbus_write(command);
+    append_smbus_word(segment, value);
+    return finish_smbus_write(segment);
+  }
+
+  I2CTransactionBuilderImpl & add_smbus_process_call(
+    uint8_t command, uint16_t value,
+    uint16_t & reply)
+  {
+    auto & segment = emplace_smbus_write(command);
+    append_smbus_word(segment, value);
+    return finish_smbus_read(segment, reply);
+  }
+
+  I2CTransactionBuilderImpl & add_smbus_read_block(uint8_t command, I2CSMBusBlock & block)
+  {
+    return finish_smbus_read(emplace_smbus_write(command), block);
+  }
+
+  I2CTransactionBuilderImpl & add_smbus_write_block(
+    uint8_t command, const uint8_t * data,
+    std::size_t size)
+  {
+    auto & segment = emplace_smbus_write(command);
+    append_smbus_block(segment, data, size);
+    return finish_smbus_write(segment);
+  }
+
+  I2CTransactionBuilderImpl & add_smbus_block_process_call(
+    uint8_t command, const uint8_t * data, std::size_t size,
+    I2CSMBusBlock & reply)
+  {
+    auto & segment = emplace_smbus_write(command);
+    append_smbus_block(segment, data, size);
+    return finish_smbus_read(segment, reply);
+  }
+
+  /**
+   * Allow transactions longer than I2C_TRANSACTION_IOCTL_MAX_MSGS, which are then split into the
+   * fewest possible transfers at safe boundaries (combined write+read pairs are never split).
+   * Meant for bulk uploads, as the transaction is no longer atomic on the bus.
+   */
+  I2CTransactionBuilderImpl & enable_chunking(bool enable = true)
+  {
+    allow_chunking = enable;
+    return *this;
+  }
+
+  I2CTransaction getTransaction();
+
+  /**
+   * Build a transaction that can be executed repeatedly, see I2CPreparedTransaction.
+   */
+  I2CPreparedTransaction prepare();
+
+private:
+  /**
+   * Start a new write message, which later writes can be appended to.
+   */
+  template<typename ...MessageFlagsT>
+  void start_write(MessageFlagsT... flags)
+  {
+    open_write = emplace_transaction<I2CBufferWriteTransactionSegment>(device_address,
+        mem_resource, flags ...).get();
+  }
 
+  /**
+   * Append the bytes to the open write message.
+   */
+  template<typename ...MessageFlagsT>
+  void append_write(const uint8_t * data, std::size_t size, MessageFlagsT...)
+  {
+    open_write->append(data, size);
+
+    // flagged messages must keep their own boundaries
+    if constexpr (sizeof...(MessageFlagsT) > 0) {
+      open_write = nullptr;
+    }
+  }
+
+  /**
+   * Point the device at the offset with a write message, unless it already points there.
+   * The read that follows it is sent with a repeated START, as the direction changes.
+   */
+  void select_offset(uint16_t offset)
+  {
     if (current_offset != offset) {
-      // add an extra write to change the current offset
-      add_write_impl(offset);
+      start_write();
+      append_offset(offset);
       current_offset = offset;
+    }
+  }
 
-      // do not send start for this case
-      return add_read_impl(pod, I2CMessageFlags::M_NOSTART, std::forward<MessageFlagsT>(flags)...);
+  /**
+   * Move the known device pointer past the bytes read, as the device auto increments it.
+   */
+  void advance_offset(std::size_t size)
+  {
+    if (current_offset) {
+      current_offset = static_cast<uint16_t>(*current_offset + size);
     }
+  }
 
-    return add_read_impl(pod, std::forward<MessageFlagsT>(flags)...);
+  /**
+   * Append the register offset in the configured format to the open write message.
+   */
+  void append_offset(uint16_t offset)
+  {
+    std::array<uint8_t, I2C_REGISTER_OFFSET_MAX_SIZE> encoded{};
+    open_write->append(encoded.data(),
+        encode_register_offset(offset_format, offset, encoded.data()));
   }
 
-  I2CTransaction getTransaction();
+  static void append_smbus_word(I2CBufferWriteTransactionSegment & segment, uint16_t value)
+  {
+    // SMBus words are sent least significant byte first
+    const std::array<uint8_t, 2> data{static_cast<uint8_t>(value & 0xFF),
+      static_cast<uint8_t>(value >> 8)};
+    segment.append(data.data(), data.size());
+  }
 
-private:
-  template<typename PODType, typename ...MessageFlagsT>
-  I2CTransactionBuilderImpl & add_write_impl(const PODType & pod, MessageFlagsT... flags)
+  static void append_smbus_block(
+    I2CBufferWriteTransactionSegment & segment, const uint8_t * data,
+    std::size_t size)
   {
-    static_assert(std::conjunction_v<std::is_same<I2CMessageFlags, MessageFlagsT>...>,
-        "These should be all I2CMessageFlags!");
-    emplace_transaction<I2CWriteTransactionSegment<PODType>>(device_address,
-        pod, flags ...);
+    if (size == 0 || size > I2CConstants::SMBUS_BLOCK_MAX) {
+      ROS2_I2CCPP_THROW(
+        exceptions::IllegalOperationException("SMBus blocks hold between 1 and 32 bytes!"));
+    }
+    const auto count = static_cast<uint8_t>(size);
+    segment.append(&count, 1);
+    segment.append(data, size);
+  }
+
+  /**
+   * Add the write message of an SMBus operation, which starts with the command and is never merged
+   * with other writes.
+   */
+  I2CBufferWriteTransactionSegment & emplace_smbus_write(uint8_t command)
+  {
+    // the device pointer is unknown after an SMBus operation
+    current_offset.reset();
 
+    auto & segment = *emplace_transaction<I2CBufferWriteTransactionSegment>(device_address,
+        mem_resource);
+    segment.append(&command, 1);
+    return segment;
+  }
+
+  /**
+   * PEC of a message that was already fully built.
+   */
+  static uint8_t message_pec(I2CTransactionSegment & segment)
+  {
+    const i2c_msg message{segment.get_address(), segment.get_message_flags(),
+      segment.get_data_size(), segment.get_data()};
+    return smbus_message_pec(0, message);
+  }
+
+  /**
+   * Finish a write-only SMBus operation.
+   */
+  I2CTransactionBuilderImpl & finish_smbus_write(I2CBufferWriteTransactionSegment & segment)
+  {
+    if (use_smbus_pec) {
+      const auto pec = message_pec(segment);
+      segment.append(&pec, 1);
+    }
+    return *this;
+  }
+
+  /**
+   * Finish an SMBus operation with the read that follows its write message.
+   */
+  template<typename DestinationT>
+  I2CTransactionBuilderImpl & finish_smbus_read(
+    I2CBufferWriteTransactionSegment & segment,
+    DestinationT & destination)
+  {
+    const uint8_t initial_pec = use_smbus_pec ? message_pec(segment) : 0;
+    emplace_transaction<I2CSMBusReadTransactionSegment<DestinationT>>(device_address,
+        destination, use_smbus_pec, initial_pec);
     return *this;
   }
 
@@ -232,22 +741,40 @@ private:
   }
 
   template<typename TransactionType, typename ...ArgsT>
-  void emplace_transaction(ArgsT &&... args)
+  std::shared_ptr<TransactionType> emplace_transaction(ArgsT &&... args)
   {
-    if(transaction_segments.size() + 1 >= I2CConstants::I2C_TRANSACTION_IOCTL_MAX_MSGS) {
-      throw exceptions::IllegalOperationException(
-          "Unable to push any more messages to the transaction queue!");
+    if(!allow_chunking &&
+      transaction_segments.size() + 1 >= I2CConstants::I2C_TRANSACTION_IOCTL_MAX_MSGS)
+    {
+      ROS2_I2CCPP_THROW(exceptions::IllegalOperationException(
+          "Unable to push any more messages to the transaction queue!"));
     }
 
-    transaction_segments.push_back(make_shared_pmr<TransactionType>(mem_resource,
-        std::forward<ArgsT>(args)...));
+    auto segment = make_shared_pmr<TransactionType>(mem_resource, std::forward<ArgsT>(args)...);
+    transaction_segments.push_back(segment);
+
+    // any new segment closes the open write message
+    open_write = nullptr;
+    return segment;
   }
 
   // i2c slave address that the transaction will apply to
   uint16_t device_address{0};
 
-  // current offset
-  uint16_t current_offset{0};
+  // current offset of the device pointer, if known
+  std::optional<uint16_t> current_offset;
+
+  // how register offsets are sent
+  I2CRegisterOffsetFormat offset_format{I2CRegisterOffsetFormat::OFFSET_16BIT_LE};
+
+  // last write message, while more bytes can still be appended to it
+  I2CBufferWriteTransactionSegment * open_write{nullptr};
+
+  // whether transactions may be split into several transfers
+  bool allow_chunking{false};
+
+  // whether SMBus operations carry a PEC byte
+  bool use_smbus_pec{false};
 
   // list of transaction segments
   std::pmr::vector<std::shared_ptr<I2CTransactionSegment>> transaction_segments;
@@ -274,7 +801,7 @@ template<uint32_t array_size = 10'000>
 class I2CTransactionBuilderPooled : public I2CTransactionBuilderImpl {
 public:
   I2CTransactionBuilderPooled(uint16_t device_address_, std::pmr::pool_options options = {})
-  : pool_mr(options, &mbr), I2CTransactionBuilderImpl(pool_mr, device_address_) {}
+  : I2CTransactionBuilderImpl(pool_mr, device_address_), pool_mr(options, &mbr) {}
 
 private:
   std::array<uint8_t, array_size> buffer{};
@@ -0,0 +1,97 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP_TRIPLE_BUFFER_HPP_
+#define ROS2_I2CCPP_TRIPLE_BUFFER_HPP_
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace ros2_i2ccpp
+{
+
+/**
+ * Lock-free triple buffer of fixed size byte samples, for a single writer and a single reader.
+ *
+ * The writer fills the back buffer and publishes it, the reader picks up the latest published
+ * sample. Neither side ever waits for the other, and samples the reader did not pick up in time
+ * are overwritten.
+ */
+class TripleBuffer {
+public:
+  explicit TripleBuffer(std::size_t size_)
+  : size(size_), storage(std::make_unique<uint8_t[]>(3 * size_)) {}
+
+  TripleBuffer(const TripleBuffer &) = delete;
+  TripleBuffer & operator=(const TripleBuffer &) = delete;
+
+  [[nodiscard]] std::size_t get_size() const {return size;}
+
+  /**
+   * Buffer to fill with the next sample, writer side.
+   */
+  [[nodiscard]] uint8_t * get_write_buffer() {return storage.get() + back * size;}
+
+  /**
+   * Publish the write buffer with its timestamp, writer side.
+   */
+  void publish(std::chrono::steady_clock::time_point timestamp)
+  {
+    timestamps[back] = timestamp;
+    sequences[back] = ++write_sequence;
+    back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+  }
+
+  /**
+   * Pick up the latest published sample, reader side.
+   * Returns false if nothing was published since the last update.
+   */
+  bool update()
+  {
+    if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+      return false;
+    }
+    front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+    return true;
+  }
+
+  /**
+   * Latest sample picked up by update, reader side.
+   */
+  [[nodiscard]] const uint8_t * get_read_buffer() const {return storage.get() + front * size;}
+  [[nodiscard]] std::chrono::steady_clock::time_point get_read_timestamp() const
+  {
+    return timestamps[front];
+  }
+
+  /**
+   * Number of the sample picked up by update, starting at 1; 0 if none was picked up yet.
+   */
+  [[nodiscard]] uint64_t get_read_sequence() const {return sequences[front];}
+
+private:
+  static constexpr uint8_t INDEX_MASK = 0x3;
+  static constexpr uint8_t FRESH = 0x4;
+
+  std::size_t size;
+  std::unique_ptr<uint8_t[]> storage;
+  std::array<std::chrono::steady_clock::time_point, 3> timestamps{};
+  std::array<uint64_t, 3> sequences{};
+
+  // buffer indices, the middle one is exchanged between both sides
+  alignas(64) uint8_t back{0};
+  uint64_t write_sequence{0};
+  alignas(64) std::atomic<uint8_t> middle{1};
+  alignas(64) uint8_t front{2};
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP_TRIPLE_BUFFER_HPP_
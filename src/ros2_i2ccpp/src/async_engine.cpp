@@ -0,0 +1,276 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "ros2_i2ccpp/async_engine.hpp"
+#include "ros2_i2ccpp/backend/i2c_backend.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+
+namespace ros2_i2ccpp
+{
+
+namespace
+{
+// how long the I/O thread keeps polling the queue once it is empty
+constexpr std::chrono::microseconds IO_THREAD_SPIN_TIME{50};
+}  // namespace
+
+I2CAsyncEngine::I2CAsyncEngine(uint16_t i2c_addr, std::string i2c_adapter_path)
+: handler(std::make_unique<ThreadUnsafeI2CHandler>(i2c_addr, i2c_adapter_path)),
+  adapter_func(handler->get_adapter_func()),
+  io_thread(&I2CAsyncEngine::run, this)
+{
+}
+
+I2CAsyncEngine::I2CAsyncEngine(std::string i2c_adapter_path)
+: handler(std::make_unique<ThreadUnsafeI2CHandler>(i2c_adapter_path)),
+  adapter_func(handler->get_adapter_func()),
+  io_thread(&I2CAsyncEngine::run, this)
+{
+}
+
+I2CAsyncEngine::I2CAsyncEngine(
+  uint16_t i2c_addr, std::unique_ptr<I2CBackend> backend,
+  std::string i2c_adapter_path)
+: handler(std::make_unique<ThreadUnsafeI2CHandler>(i2c_addr, std::move(backend),
+    i2c_adapter_path)),
+  adapter_func(handler->get_adapter_func()),
+  io_thread(&I2CAsyncEngine::run, this)
+{
+}
+
+I2CAsyncEngine::I2CAsyncEngine(
+  std::unique_ptr<I2CBackend> backend,
+  std::string i2c_adapter_path)
+: handler(std::make_unique<ThreadUnsafeI2CHandler>(std::move(backend), i2c_adapter_path)),
+  adapter_func(handler->get_adapter_func()),
+  io_thread(&I2CAsyncEngine::run, this)
+{
+}
+
+I2CAsyncEngine::~I2CAsyncEngine()
+{
+  {
+    std::scoped_lock lock{wakeup_mutex};
+    stopping.store(true);
+  }
+  wakeup.notify_one();
+  io_thread.join();
+}
+
+void I2CAsyncEngine::set_retry_policy(I2CPriorityClass priority, const I2CRetryPolicy & policy)
+{
+  std::scoped_lock lock{retry_policy_mutex};
+  retry_policies[priority] = policy;
+  retry_policies_changed.store(true, std::memory_order_release);
+}
+
+I2CRetryPolicy I2CAsyncEngine::get_retry_policy(I2CPriorityClass priority) const
+{
+  std::scoped_lock lock{retry_policy_mutex};
+  return retry_policies[priority];
+}
+
+void I2CAsyncEngine::post(std::unique_ptr<I2CAsyncRequest> request)
+{
+  queue.push(request.release());
+  pending.fetch_add(1);
+
+  // pairs with the I/O thread setting sleeping before checking pending, so one of them sees the other
+  if (sleeping.load()) {
+    std::scoped_lock lock{wakeup_mutex};
+    wakeup.notify_one();
+  }
+}
+
+void I2CAsyncEngine::collect_requests()
+{
+  // requests still being linked by a producer are picked up on the next pass
+  while (auto node = queue.pop()) {
+    ready.emplace_back(static_cast<I2CAsyncRequest *>(node));
+    ready.back()->sequence = next_sequence++;
+    std::push_heap(ready.begin(), ready.end(), RequestOrder{});
+  }
+}
+
+bool I2CAsyncEngine::is_busy(const uint16_t device_address) const
+{
+  return std::any_of(busy_devices.begin(), busy_devices.end(),
+           [device_address](const BusyDevice & device) {
+             return device.device_address == device_address;
+           });
+}
+
+void I2CAsyncEngine::execute_next()
+{
+  auto & request = ready.front();
+  const auto slice_messages = request->scheduling.slice_messages;
+  const auto write_cycle_time = request->scheduling.write_cycle_time;
+
+  // the device only matters while some device is busy, or if this request makes it busy
+  auto device_address = I2CAsyncRequest::NO_DEVICE;
+  if (!busy_devices.empty() || write_cycle_time.count() > 0) {
+    device_address = request->get_device_address();
+  }
+  if (device_address != I2CAsyncRequest::NO_DEVICE && is_busy(device_address)) {
+    // park it until the device answers, the next request may use another device
+    std::pop_heap(ready.begin(), ready.end(), RequestOrder{});
+    held.push_back(std::move(ready.back()));
+    ready.pop_back();
+    return;
+  }
+
+  // the adapter limits are only changed when the policy in use changes
+  if (retry_policies_changed.load(std::memory_order_acquire)) {
+    std::scoped_lock lock{retry_policy_mutex};
+    active_retry_policies = retry_policies;
+    retry_policies_changed.store(false, std::memory_order_relaxed);
+  }
+  const auto * retry_policy = request->scheduling.retry_policy;
+  handler->set_retry_policy(retry_policy != nullptr ?
+    *retry_policy : active_retry_policies[request->scheduling.priority]);
+
+  bool done = true;
+  std::exception_ptr error;
+  const auto start = std::chrono::steady_clock::now();
+  try {
+    if (slice_messages > 0) {
+      done = request->execute_slice(*handler, slice_messages);
+    } else {
+      request->execute(*handler);
+    }
+  } catch (...) {
+    error = std::current_exception();
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  // single writer, so plain read-modify-write is enough
+  busy_ns.store(busy_ns.load(std::memory_order_relaxed) +
+    std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(),
+    std::memory_order_relaxed);
+
+  if (!error && write_cycle_time.count() > 0 && device_address != I2CAsyncRequest::NO_DEVICE) {
+    // polling right away would only collect a NAK
+    busy_devices.push_back(BusyDevice{device_address, end + write_cycle_time,
+        end + ACK_POLL_INTERVAL});
+  }
+
+  if (!done) {
+    // stays on top of the heap until something more urgent comes in, or is held back on the next
+    // pass if its device is now busy
+    return;
+  }
+
+  std::pop_heap(ready.begin(), ready.end(), RequestOrder{});
+  auto finished = std::move(ready.back());
+  ready.pop_back();
+
+  auto & counter = error ? failed : completed;
+  counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (end > finished->scheduling.deadline) {
+    auto & misses = deadline_misses[finished->scheduling.priority];
+    misses.store(misses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  pending.fetch_sub(1);
+  finished->complete(std::move(error));
+}
+
+void I2CAsyncEngine::poll_busy_devices()
+{
+  auto now = std::chrono::steady_clock::now();
+  for (auto it = busy_devices.begin(); it != busy_devices.end(); ) {
+    bool answered = now >= it->ready_time;
+    if (!answered && ack_polling && now >= it->next_poll) {
+      const auto acknowledged = handler->try_poll_ack(it->device_address);
+      answered = acknowledged.value_or(false);
+      ack_polls.store(ack_polls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      if (acknowledged.error().value() == EOPNOTSUPP) {
+        // neither zero-length messages nor quick writes on this adapter, so wait for the worst
+        // case cycle time
+        ack_polling = false;
+      }
+      now = std::chrono::steady_clock::now();
+      it->next_poll = now + ACK_POLL_INTERVAL;
+    }
+
+    if (!answered) {
+      ++it;
+      continue;
+    }
+
+    // the held requests keep their sequence, so they run in submission order again
+    const auto device_address = it->device_address;
+    it = busy_devices.erase(it);
+    for (auto & request : held) {
+      if (request->get_device_address() == device_address) {
+        ready.push_back(std::move(request));
+        std::push_heap(ready.begin(), ready.end(), RequestOrder{});
+      }
+    }
+    held.erase(std::remove(held.begin(), held.end(), nullptr), held.end());
+  }
+}
+
+void I2CAsyncEngine::wait_for_busy_devices()
+{
+  auto wake_time = std::chrono::steady_clock::time_point::max();
+  for (const auto & device : busy_devices) {
+    wake_time = std::min(wake_time, ack_polling ? device.next_poll : device.ready_time);
+  }
+
+  // new requests may be for an idle device, so they end the wait
+  std::unique_lock lock{wakeup_mutex};
+  sleeping.store(true);
+  wakeup.wait_until(lock, wake_time, [this] {return pending.load() > held.size();});
+  sleeping.store(false);
+}
+
+void I2CAsyncEngine::run()
+{
+  while (true) {
+    while (pending.load() > 0) {
+      collect_requests();
+      if (!busy_devices.empty()) {
+        poll_busy_devices();
+      }
+      if (ready.empty()) {
+        if (!held.empty()) {
+          // everything left waits for a busy device
+          wait_for_busy_devices();
+        } else {
+          // a producer is still linking its request
+          std::this_thread::yield();
+        }
+        continue;
+      }
+      execute_next();
+    }
+
+    // requests tend to come in bursts, so briefly wait for more before parking the thread
+    const auto spin_deadline = std::chrono::steady_clock::now() + IO_THREAD_SPIN_TIME;
+    while (pending.load() == 0 && !stopping.load() &&
+      std::chrono::steady_clock::now() < spin_deadline)
+    {
+      std::this_thread::yield();
+    }
+    if (pending.load() > 0) {
+      continue;
+    }
+
+    std::unique_lock lock{wakeup_mutex};
+    sleeping.store(true);
+    wakeup.wait(lock, [this] {return pending.load() > 0 || stopping.load();});
+    sleeping.store(false);
+
+    if (pending.load() == 0 && stopping.load()) {
+      return;
+    }
+  }
+}
+
+}  // namespace ros2_i2ccpp
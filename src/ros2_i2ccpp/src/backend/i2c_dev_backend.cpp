@@ -0,0 +1,91 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+extern "C"
+{
+#include <fcntl.h>  //open
+#include <unistd.h> // close
+#include <linux/i2c-dev.h>
+#include <linux/i2c.h>
+#include <i2c/smbus.h>
+#include <sys/ioctl.h>
+}
+
+#include "ros2_i2ccpp/backend/i2c_dev_backend.hpp"
+#include "ros2_i2ccpp/constants.hpp"
+
+namespace ros2_i2ccpp
+{
+
+I2CDevBackend::~I2CDevBackend()
+{
+  close();
+}
+
+int I2CDevBackend::open(const std::string & i2c_adapter_path)
+{
+  i2c_file_desc = ::open(i2c_adapter_path.c_str(), O_NONBLOCK | O_RDWR);
+  return i2c_file_desc < 0 ? -1 : 0;
+}
+
+int I2CDevBackend::close()
+{
+  if (!is_opened()) {
+    return 0;
+  }
+
+  const auto result = ::close(i2c_file_desc);
+  i2c_file_desc = INVALID_FILE_DESC;
+  return result;
+}
+
+int I2CDevBackend::get_functionality(uint64_t & adapter_func)
+{
+  // the kernel writes an unsigned long
+  unsigned long funcs = 0;
+  const auto result = ioctl(i2c_file_desc, I2CIOControlCommands::FUNCS, &funcs);
+  adapter_func = funcs;
+  return result;
+}
+
+int I2CDevBackend::set_slave_address(const uint16_t i2c_addr)
+{
+  return ioctl(i2c_file_desc, I2CIOControlCommands::SLAVE, i2c_addr);
+}
+
+int I2CDevBackend::set_ten_bit(const bool enable)
+{
+  return ioctl(i2c_file_desc, I2CIOControlCommands::TENBIT, enable ? 1 : 0);
+}
+
+int I2CDevBackend::set_pec(const bool enable)
+{
+  return ioctl(i2c_file_desc, I2CIOControlCommands::PEC, enable ? 1 : 0);
+}
+
+int I2CDevBackend::set_retries(const uint32_t retries)
+{
+  return ioctl(i2c_file_desc, I2CIOControlCommands::RETRIES, static_cast<unsigned long>(retries));
+}
+
+int I2CDevBackend::set_timeout(const uint32_t timeout)
+{
+  return ioctl(i2c_file_desc, I2CIOControlCommands::TIMEOUT, static_cast<unsigned long>(timeout));
+}
+
+int I2CDevBackend::transfer(i2c_msg * messages, const uint32_t message_count)
+{
+  i2c_rdwr_ioctl_data transaction_block{messages, message_count};
+  return ioctl(i2c_file_desc, I2CIOControlCommands::RDWR, &transaction_block);
+}
+
+int I2CDevBackend::smbus_access(
+  const uint8_t read_write, const uint8_t command, const uint32_t size,
+  i2c_smbus_data * data)
+{
+  return i2c_smbus_access(i2c_file_desc, read_write, command, size, data);
+}
+
+}  // namespace ros2_i2ccpp
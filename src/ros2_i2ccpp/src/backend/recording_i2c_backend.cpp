@@ -0,0 +1,133 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <cerrno>
+#include <chrono>
+#include <utility>
+
+#include "ros2_i2ccpp/backend/recording_i2c_backend.hpp"
+#include "ros2_i2ccpp/constants.hpp"
+
+namespace ros2_i2ccpp
+{
+
+RecordingI2CBackend::RecordingI2CBackend(
+  std::unique_ptr<I2CBackend> backend_,
+  std::shared_ptr<I2CTrafficRecorder> recorder_)
+: backend(std::move(backend_)), recorder(std::move(recorder_))
+{
+}
+
+int RecordingI2CBackend::open(const std::string & i2c_adapter_path)
+{
+  const auto result = backend->open(i2c_adapter_path);
+  if (result == 0) {
+    adapter = recorder->add_adapter(i2c_adapter_path);
+  }
+  return result;
+}
+
+int RecordingI2CBackend::close()
+{
+  return backend->close();
+}
+
+int RecordingI2CBackend::get_functionality(uint64_t & adapter_func)
+{
+  // a query, nothing to replay
+  return backend->get_functionality(adapter_func);
+}
+
+template<typename Operation>
+int RecordingI2CBackend::record_control(
+  const uint64_t command, const uint64_t value,
+  Operation && operation)
+{
+  const auto start = std::chrono::steady_clock::now();
+  const auto result = operation();
+  const auto duration = std::chrono::steady_clock::now() - start;
+
+  // the recorder may change errno, which the caller still has to see
+  const auto error = result < 0 ? errno : 0;
+  recorder->record_control(adapter, start, duration, error, command, value);
+  errno = error;
+  return result;
+}
+
+int RecordingI2CBackend::set_slave_address(const uint16_t i2c_addr)
+{
+  return record_control(I2CIOControlCommands::SLAVE, i2c_addr, [&] {
+        const auto result = backend->set_slave_address(i2c_addr);
+        if (result == 0) {
+          slave_address = i2c_addr;
+        }
+        return result;
+      });
+}
+
+int RecordingI2CBackend::set_ten_bit(const bool enable)
+{
+  return record_control(I2CIOControlCommands::TENBIT, enable, [&] {
+        return backend->set_ten_bit(enable);
+      });
+}
+
+int RecordingI2CBackend::set_pec(const bool enable)
+{
+  return record_control(I2CIOControlCommands::PEC, enable, [&] {
+        return backend->set_pec(enable);
+      });
+}
+
+int RecordingI2CBackend::set_retries(const uint32_t retries)
+{
+  return record_control(I2CIOControlCommands::RETRIES, retries, [&] {
+        return backend->set_retries(retries);
+      });
+}
+
+int RecordingI2CBackend::set_timeout(const uint32_t timeout)
+{
+  return record_control(I2CIOControlCommands::TIMEOUT, timeout, [&] {
+        return backend->set_timeout(timeout);
+      });
+}
+
+int RecordingI2CBackend::transfer(i2c_msg * messages, const uint32_t message_count)
+{
+  const auto start = std::chrono::steady_clock::now();
+  const auto result = backend->transfer(messages, message_count);
+  const auto duration = std::chrono::steady_clock::now() - start;
+
+  // recorded after the call, so read messages hold what was read (M_RECV_LEN ones start with the
+  // count received, the replayer puts back what they were sent with)
+  const auto error = result < 0 ? errno : 0;
+  recorder->record_transfer(adapter, start, duration, error, messages, message_count);
+  errno = error;
+  return result;
+}
+
+int RecordingI2CBackend::smbus_access(
+  const uint8_t read_write, const uint8_t command, const uint32_t size,
+  i2c_smbus_data * data)
+{
+  i2c_smbus_data data_before{};
+  if (data != nullptr) {
+    data_before = *data;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto result = backend->smbus_access(read_write, command, size, data);
+  const auto duration = std::chrono::steady_clock::now() - start;
+
+  const auto error = result < 0 ? errno : 0;
+  const I2CTrafficSMBusCall call{slave_address, read_write, command, size};
+  recorder->record_smbus(adapter, start, duration, error, call, data_before,
+      data != nullptr ? *data : data_before);
+  errno = error;
+  return result;
+}
+
+}  // namespace ros2_i2ccpp
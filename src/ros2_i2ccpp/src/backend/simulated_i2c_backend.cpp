@@ -0,0 +1,379 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+extern "C"
+{
+#include <linux/i2c-dev.h>
+}
+
+#include <cerrno>
+#include <thread>
+
+#include "ros2_i2ccpp/backend/simulated_i2c_backend.hpp"
+#include "ros2_i2ccpp/impl/smbus_transfer.hpp"
+
+namespace ros2_i2ccpp
+{
+
+namespace
+{
+
+// largest message accepted by i2c-dev
+constexpr uint32_t MAX_MESSAGE_SIZE = 8192;
+
+/**
+ * Wait until the deadline, sleeping for long waits and spinning for the last stretch,
+ * since sleeps are too coarse for microsecond transfers.
+ */
+void wait_until(const std::chrono::steady_clock::time_point deadline)
+{
+  constexpr auto spin_threshold = std::chrono::microseconds{200};
+
+  auto now = std::chrono::steady_clock::now();
+  if (deadline - now > spin_threshold) {
+    std::this_thread::sleep_until(deadline - spin_threshold);
+  }
+
+  while (std::chrono::steady_clock::now() < deadline) {
+  }
+}
+
+}  // namespace
+
+SimulatedBusTiming SimulatedBusTiming::for_speed(const uint32_t bus_speed_hz, const bool real_time)
+{
+  using std::chrono::nanoseconds;
+
+  // tSU;STA + tHD;STA for the START, tSU;STO + tBUF for the STOP
+  if (bus_speed_hz <= SimulatedBusSpeed::STANDARD_MODE) {
+    return SimulatedBusTiming{bus_speed_hz, nanoseconds{8'700}, nanoseconds{8'700}, nanoseconds{0},
+      real_time};
+  }
+  if (bus_speed_hz <= SimulatedBusSpeed::FAST_MODE) {
+    return SimulatedBusTiming{bus_speed_hz, nanoseconds{1'200}, nanoseconds{1'900}, nanoseconds{0},
+      real_time};
+  }
+  return SimulatedBusTiming{bus_speed_hz, nanoseconds{520}, nanoseconds{760}, nanoseconds{0},
+    real_time};
+}
+
+SimulatedI2CDevice::SimulatedI2CDevice(
+  const uint32_t register_count,
+  const uint8_t register_address_width_)
+: registers(register_count, 0), register_address_width(register_address_width_)
+{
+}
+
+bool SimulatedI2CDevice::on_start(const bool read)
+{
+  if (!read) {
+    received_address_bytes = 0;
+  }
+  return true;
+}
+
+bool SimulatedI2CDevice::on_write(const uint8_t * data, const uint32_t size)
+{
+  for (uint32_t i = 0; i < size; i++) {
+    if (received_address_bytes < register_address_width) {
+      // still receiving the register address
+      register_pointer = received_address_bytes == 0 ? 0 : register_pointer << 8;
+      register_pointer = (register_pointer | data[i]) % registers.size();
+      received_address_bytes++;
+      continue;
+    }
+
+    registers[register_pointer] = data[i];
+    register_pointer = (register_pointer + 1) % registers.size();
+  }
+  return true;
+}
+
+void SimulatedI2CDevice::on_read(uint8_t * data, const uint32_t size)
+{
+  for (uint32_t i = 0; i < size; i++) {
+    data[i] = registers[register_pointer];
+    register_pointer = (register_pointer + 1) % registers.size();
+  }
+}
+
+SimulatedMemoryDevice::SimulatedMemoryDevice(
+  const uint32_t size, const uint8_t register_address_width_, const uint32_t page_size_,
+  const std::chrono::nanoseconds write_cycle_time_)
+: SimulatedI2CDevice(size, register_address_width_), page_size(page_size_),
+  write_cycle_time(write_cycle_time_)
+{
+}
+
+bool SimulatedMemoryDevice::on_start(const bool read)
+{
+  if (is_busy()) {
+    return false;
+  }
+  return SimulatedI2CDevice::on_start(read);
+}
+
+bool SimulatedMemoryDevice::on_write(const uint8_t * data, const uint32_t size)
+{
+  for (uint32_t i = 0; i < size; i++) {
+    if (received_address_bytes < register_address_width) {
+      // still receiving the memory address
+      register_pointer = received_address_bytes == 0 ? 0 : register_pointer << 8;
+      register_pointer = (register_pointer | data[i]) % registers.size();
+      received_address_bytes++;
+      continue;
+    }
+
+    // the pointer wraps around within the page
+    const auto page_start = register_pointer - register_pointer % page_size;
+    registers[register_pointer] = data[i];
+    register_pointer = page_start + (register_pointer + 1 - page_start) % page_size;
+    page_written = true;
+  }
+  return true;
+}
+
+void SimulatedMemoryDevice::on_stop()
+{
+  if (page_written) {
+    busy_until = std::chrono::steady_clock::now() + write_cycle_time;
+    page_written = false;
+  }
+}
+
+SimulatedI2CBus::SimulatedI2CBus(SimulatedBusTiming timing_, const uint64_t adapter_func_)
+: timing(timing_), adapter_func(adapter_func_)
+{
+}
+
+void SimulatedI2CBus::attach_device(
+  const uint16_t i2c_addr,
+  std::shared_ptr<SimulatedI2CDevice> device)
+{
+  std::scoped_lock lock{mut};
+  devices[i2c_addr] = std::move(device);
+}
+
+void SimulatedI2CBus::detach_device(const uint16_t i2c_addr)
+{
+  std::scoped_lock lock{mut};
+  devices.erase(i2c_addr);
+}
+
+std::shared_ptr<SimulatedI2CDevice> SimulatedI2CBus::get_device(const uint16_t i2c_addr) const
+{
+  std::scoped_lock lock{mut};
+  const auto it = devices.find(i2c_addr);
+  return it == devices.end() ? nullptr : it->second;
+}
+
+std::chrono::nanoseconds SimulatedI2CBus::get_transfer_time(
+  const i2c_msg * messages,
+  const uint32_t message_count) const
+{
+  auto duration = timing.transfer_overhead + timing.stop_overhead;
+  for (uint32_t i = 0; i < message_count; i++) {
+    const auto & message = messages[i];
+    if (!(message.flags & I2CMessageFlags::M_NOSTART)) {
+      // START and address byte(s)
+      const auto address_bytes = (message.flags & I2CMessageFlags::M_TEN) ? 2 : 1;
+      duration += timing.start_overhead + address_bytes * timing.byte_time();
+    }
+    duration += message.len * timing.byte_time();
+    if ((message.flags & I2CMessageFlags::M_STOP) && i + 1 < message_count) {
+      duration += timing.stop_overhead;
+    }
+  }
+  return duration;
+}
+
+int SimulatedI2CBus::transfer(i2c_msg * messages, const uint32_t message_count)
+{
+  if (message_count == 0 || message_count > I2C_RDWR_IOCTL_MAX_MSGS) {
+    errno = EINVAL;
+    return -1;
+  }
+  for (uint32_t i = 0; i < message_count; i++) {
+    if (messages[i].len > MAX_MESSAGE_SIZE) {
+      errno = EINVAL;
+      return -1;
+    }
+
+    // as checked by i2c-dev, buf[0] holds the bytes read besides the block (the count, its PEC)
+    // and the buffer must fit the largest block on top of them
+    if ((messages[i].flags & I2CMessageFlags::M_RECV_LEN) &&
+      (!(messages[i].flags & I2CMessageFlags::M_RD) || messages[i].len < 1 ||
+      messages[i].buf[0] < 1 || messages[i].len < messages[i].buf[0] + I2C_SMBUS_BLOCK_MAX))
+    {
+      errno = EINVAL;
+      return -1;
+    }
+  }
+
+  std::scoped_lock lock{mut};
+  const auto start_time = std::chrono::steady_clock::now();
+
+  int result = static_cast<int>(message_count);
+  std::shared_ptr<SimulatedI2CDevice> device;
+
+  // bytes of M_RECV_LEN buffers left unused by shorter blocks, they take no bus time
+  uint32_t unused_bytes = 0;
+  for (uint32_t i = 0; i < message_count; i++) {
+    auto & message = messages[i];
+    const bool read = message.flags & I2CMessageFlags::M_RD;
+    const bool ignore_nak = message.flags & I2CMessageFlags::M_IGNORE_NAK;
+
+    if (!(message.flags & I2CMessageFlags::M_NOSTART) || !device) {
+      const auto it = devices.find(message.addr);
+      device = it == devices.end() ? nullptr : it->second;
+      if ((!device || !device->on_start(read)) && !ignore_nak) {
+        // nobody acknowledged the address
+        statistics.naks++;
+        errno = ENXIO;
+        result = -1;
+        break;
+      }
+    }
+
+    if (read) {
+      uint32_t size = message.len;
+      if (device && (message.flags & I2CMessageFlags::M_RECV_LEN)) {
+        // the first byte received sets the length of the block, i2c-dev leaves len untouched
+        const uint32_t extra_bytes = message.buf[0];
+        device->on_read(message.buf, 1);
+        if (message.buf[0] == 0 || message.buf[0] > I2C_SMBUS_BLOCK_MAX) {
+          errno = EPROTO;
+          result = -1;
+          break;
+        }
+        size = extra_bytes + message.buf[0];
+        device->on_read(message.buf + 1, size - 1);
+        unused_bytes += message.len - size;
+      } else if (device) {
+        device->on_read(message.buf, size);
+      }
+      statistics.bytes_read += size;
+    } else {
+      if (device && !device->on_write(message.buf, message.len) && !ignore_nak) {
+        statistics.naks++;
+        errno = EREMOTEIO;
+        result = -1;
+        break;
+      }
+      statistics.bytes_written += message.len;
+    }
+    statistics.messages++;
+
+    if (device && (message.flags & I2CMessageFlags::M_STOP)) {
+      device->on_stop();
+    }
+  }
+  if (device) {
+    device->on_stop();
+  }
+
+  const auto duration = get_transfer_time(messages, message_count) -
+    unused_bytes * timing.byte_time();
+  statistics.transfers++;
+  statistics.busy_time += duration;
+
+  if (timing.real_time) {
+    wait_until(start_time + duration);
+  }
+
+  return result;
+}
+
+SimulatedBusStatistics SimulatedI2CBus::get_statistics() const
+{
+  std::scoped_lock lock{mut};
+  return statistics;
+}
+
+void SimulatedI2CBus::reset_statistics()
+{
+  std::scoped_lock lock{mut};
+  statistics = SimulatedBusStatistics{};
+}
+
+SimulatedI2CBackend::SimulatedI2CBackend(std::shared_ptr<SimulatedI2CBus> bus_)
+: bus(std::move(bus_))
+{
+}
+
+int SimulatedI2CBackend::open(const std::string & /*i2c_adapter_path*/)
+{
+  opened = true;
+  slave_addr = 0;
+  ten_bit = false;
+  pec = false;
+  return 0;
+}
+
+int SimulatedI2CBackend::close()
+{
+  opened = false;
+  return 0;
+}
+
+int SimulatedI2CBackend::get_functionality(uint64_t & adapter_func)
+{
+  adapter_func = bus->get_adapter_func();
+  return 0;
+}
+
+int SimulatedI2CBackend::set_slave_address(const uint16_t i2c_addr)
+{
+  slave_addr = i2c_addr;
+  return 0;
+}
+
+int SimulatedI2CBackend::set_ten_bit(const bool enable)
+{
+  ten_bit = enable;
+  return 0;
+}
+
+int SimulatedI2CBackend::set_pec(const bool enable)
+{
+  pec = enable;
+  return 0;
+}
+
+int SimulatedI2CBackend::set_retries(const uint32_t retries_)
+{
+  retries = retries_;
+  return 0;
+}
+
+int SimulatedI2CBackend::set_timeout(const uint32_t timeout_)
+{
+  timeout = timeout_;
+  return 0;
+}
+
+int SimulatedI2CBackend::transfer(i2c_msg * messages, const uint32_t message_count)
+{
+  return bus->transfer(messages, message_count);
+}
+
+int SimulatedI2CBackend::smbus_access(
+  const uint8_t read_write, const uint8_t command, const uint32_t size,
+  i2c_smbus_data * data)
+{
+  SMBusTransfer smbus_transfer;
+  const uint16_t flags = ten_bit ? static_cast<uint16_t>(I2CMessageFlags::M_TEN) : 0;
+  if (smbus_transfer.encode(slave_addr, flags, read_write, command, size, data) < 0) {
+    return -1;
+  }
+
+  if (bus->transfer(smbus_transfer.get_messages(), smbus_transfer.get_message_count()) < 0) {
+    return -1;
+  }
+
+  return smbus_transfer.decode(data);
+}
+
+}  // namespace ros2_i2ccpp
@@ -0,0 +1,381 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+extern "C"
+{
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <thread>
+#include <utility>
+
+#include "ros2_i2ccpp/bulk_transfer.hpp"
+#include "ros2_i2ccpp/exceptions.hpp"
+#include "ros2_i2ccpp/register_offset.hpp"
+
+namespace ros2_i2ccpp
+{
+
+using namespace exceptions;
+
+std::size_t I2CMemorySource::read(uint8_t * out, std::size_t max_size)
+{
+  const auto count = std::min(max_size, size - position);
+  std::memcpy(out, data + position, count);
+  position += count;
+  return count;
+}
+
+void I2CMemorySink::write(const uint8_t * in, std::size_t in_size)
+{
+  if (in_size > size - position) {
+    throw IllegalOperationException("Sink is too small for the data read");
+  }
+  std::memcpy(data + position, in, in_size);
+  position += in_size;
+}
+
+std::size_t I2CFileSource::read(uint8_t * data, std::size_t size)
+{
+  // fill as much as possible, pipes and sockets may return less than asked
+  std::size_t count = 0;
+  while (count < size) {
+    const auto result = ::read(file_desc, data + count, size - count);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw SysException("Unable to read from the source file");
+    }
+    if (result == 0) {
+      break;
+    }
+    count += static_cast<std::size_t>(result);
+  }
+  return count;
+}
+
+void I2CFileSink::write(const uint8_t * data, std::size_t size)
+{
+  std::size_t count = 0;
+  while (count < size) {
+    const auto result = ::write(file_desc, data + count, size - count);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw SysException("Unable to write to the sink file");
+    }
+    count += static_cast<std::size_t>(result);
+  }
+}
+
+I2CMappedFile::I2CMappedFile(const std::string & path)
+{
+  const auto file_desc = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (file_desc < 0) {
+    throw SysException("Unable to open " + path);
+  }
+
+  struct stat file_stat {};
+  if (::fstat(file_desc, &file_stat) < 0) {
+    const auto error = errno;
+    ::close(file_desc);
+    throw SysException("Unable to query the size of " + path, error);
+  }
+  size = static_cast<std::size_t>(file_stat.st_size);
+  map(file_desc);
+}
+
+I2CMappedFile::I2CMappedFile(const std::string & path, std::size_t size_)
+: size(size_), writable(true)
+{
+  const auto file_desc = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (file_desc < 0) {
+    throw SysException("Unable to open " + path);
+  }
+
+  if (::ftruncate(file_desc, static_cast<off_t>(size)) < 0) {
+    const auto error = errno;
+    ::close(file_desc);
+    throw SysException("Unable to resize " + path, error);
+  }
+  map(file_desc);
+}
+
+void I2CMappedFile::map(int file_desc)
+{
+  // empty files cannot be mapped, but there is nothing to stream either
+  if (size > 0) {
+    auto * mapping = ::mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+        MAP_SHARED, file_desc, 0);
+    if (mapping == MAP_FAILED) {
+      const auto error = errno;
+      ::close(file_desc);
+      throw SysException("Unable to map the file", error);
+    }
+    data = static_cast<uint8_t *>(mapping);
+
+    // the data is streamed front to back
+    ::madvise(mapping, size, MADV_SEQUENTIAL);
+  }
+
+  // the mapping stays valid without the descriptor
+  ::close(file_desc);
+}
+
+I2CMemorySink I2CMappedFile::make_sink() const
+{
+  // the mapping of a file opened for reading faults on the first write
+  if (!writable) {
+    throw IllegalOperationException("File was mapped for reading only");
+  }
+  return I2CMemorySink(data, size);
+}
+
+I2CMappedFile::~I2CMappedFile()
+{
+  if (data != nullptr) {
+    ::munmap(data, size);
+  }
+}
+
+I2CBulkTransfer::I2CBulkTransfer(I2CMemoryGeometry geometry_, std::size_t staging_size_)
+: geometry(geometry_), staging_size(staging_size_)
+{
+  if (geometry.page_size == 0) {
+    throw IllegalOperationException("Page size must be positive");
+  }
+  if (staging_size < geometry.page_size + I2C_REGISTER_OFFSET_MAX_SIZE) {
+    throw IllegalOperationException("Staging buffer must hold at least a page and its offset");
+  }
+
+  // a single message cannot carry more
+  staging_size = std::min<std::size_t>(staging_size, UINT16_MAX);
+  staging = std::make_unique<uint8_t[]>(staging_size);
+}
+
+uint32_t I2CBulkTransfer::get_window_size() const
+{
+  return geometry.offset_format == I2CRegisterOffsetFormat::OFFSET_8BIT ?
+         UINT8_MAX + 1 : UINT16_MAX + 1;
+}
+
+std::size_t I2CBulkTransfer::locate(
+  uint32_t address, uint16_t & device_address,
+  uint8_t * offset) const
+{
+  const auto window_size = get_window_size();
+  device_address = static_cast<uint16_t>(geometry.device_address + address / window_size);
+  return encode_register_offset(geometry.offset_format,
+           static_cast<uint16_t>(address % window_size), offset);
+}
+
+uint16_t I2CBulkTransfer::get_device_address(uint32_t address) const
+{
+  return static_cast<uint16_t>(geometry.device_address + address / get_window_size());
+}
+
+template<typename Mutex>
+I2CBulkTransferResult I2CBulkTransfer::read(
+  const I2CHandler<Mutex> & handler, uint32_t address,
+  I2CBulkSink & sink, std::size_t size)
+{
+  if (address + size > geometry.size) {
+    throw IllegalOperationException("Read goes past the end of the memory");
+  }
+
+  I2CBulkTransferResult result;
+  const auto start = std::chrono::steady_clock::now();
+  const auto window_size = get_window_size();
+
+  std::array<uint8_t, I2C_REGISTER_OFFSET_MAX_SIZE> offset{};
+  while (result.bytes < size) {
+    // read as much as fits in the staging buffer, without leaving the current device address;
+    // the offset is sent every time so that no other access to the device can move its pointer
+    const auto current = static_cast<uint32_t>(address + result.bytes);
+    const auto chunk = std::min<std::size_t>({size - result.bytes, staging_size,
+        window_size - current % window_size});
+
+    uint16_t device_address = 0;
+    const auto offset_size = locate(current, device_address, offset.data());
+    std::array<i2c_msg, 2> messages{
+      i2c_msg{device_address, 0, static_cast<uint16_t>(offset_size), offset.data()},
+      i2c_msg{device_address, I2CMessageFlags::M_RD, static_cast<uint16_t>(chunk), staging.get()}};
+    handler.apply_messages(messages.data(), static_cast<uint32_t>(messages.size()));
+    result.transfers++;
+
+    sink.write(staging.get(), chunk);
+    result.bytes += chunk;
+  }
+
+  result.duration = std::chrono::steady_clock::now() - start;
+  return result;
+}
+
+template<typename Mutex>
+bool I2CBulkTransfer::write_page(
+  const I2CHandler<Mutex> & handler, uint32_t address,
+  I2CBulkSource & source, I2CBulkTransferResult & result)
+{
+  // never cross a page, the device would wrap around to the start of the page
+  const auto current = static_cast<uint32_t>(address + result.bytes);
+  const auto page_left = geometry.page_size - current % geometry.page_size;
+
+  uint16_t device_address = 0;
+  const auto offset_size = locate(current, device_address, staging.get());
+  const auto chunk = source.read(staging.get() + offset_size, page_left);
+  if (chunk == 0) {
+    return false;
+  }
+  if (current + chunk > geometry.size) {
+    throw IllegalOperationException("Write goes past the end of the memory");
+  }
+
+  i2c_msg message{device_address, 0, static_cast<uint16_t>(offset_size + chunk), staging.get()};
+  handler.apply_messages(&message, 1);
+  result.transfers++;
+  result.bytes += chunk;
+  return true;
+}
+
+template<typename Mutex>
+void I2CBulkTransfer::wait_write_cycle(
+  const I2CHandler<Mutex> & handler, uint16_t device_address,
+  std::chrono::steady_clock::time_point write_time) const
+{
+  // the device NAKs until the page is stored, which is usually well before the worst case
+  const auto ready_time = write_time + geometry.write_cycle_time;
+  while (std::chrono::steady_clock::now() < ready_time) {
+    std::this_thread::sleep_for(I2CAsyncEngine::ACK_POLL_INTERVAL);
+    const auto acknowledged = handler.try_poll_ack(device_address);
+    if (acknowledged.value_or(false)) {
+      return;
+    }
+    if (acknowledged.error().value() == EOPNOTSUPP) {
+      // neither zero-length messages nor quick writes on this adapter, wait for the worst case
+      std::this_thread::sleep_until(ready_time);
+      return;
+    }
+  }
+}
+
+template<typename Mutex>
+I2CBulkTransferResult I2CBulkTransfer::write(
+  const I2CHandler<Mutex> & handler, uint32_t address,
+  I2CBulkSource & source)
+{
+  I2CBulkTransferResult result;
+  const auto start = std::chrono::steady_clock::now();
+
+  while (true) {
+    const auto device_address = get_device_address(static_cast<uint32_t>(address + result.bytes));
+    if (!write_page(handler, address, source, result)) {
+      break;
+    }
+
+    // the device ignores everything until the page is stored
+    wait_write_cycle(handler, device_address, std::chrono::steady_clock::now());
+  }
+
+  result.duration = std::chrono::steady_clock::now() - start;
+  return result;
+}
+
+/**
+ * Bulk write run on the I/O thread of an engine, one page per slice.
+ */
+class I2CBulkTransfer::WriteRequest final : public I2CAsyncRequest {
+public:
+  WriteRequest(I2CBulkTransfer & transfer_, uint32_t address_, I2CBulkSource & source_)
+  : transfer(transfer_), address(address_), source(source_), start(std::chrono::steady_clock::now())
+  {
+  }
+
+  [[nodiscard]] std::future<I2CBulkTransferResult> get_future() {return promise.get_future();}
+
+  uint16_t get_device_address() final
+  {
+    return transfer.get_device_address(static_cast<uint32_t>(address + result.bytes));
+  }
+
+  void execute(ThreadUnsafeI2CHandler & handler) final
+  {
+    // not sliced, so the write cycles have to be waited for here
+    while (true) {
+      const auto device_address = get_device_address();
+      if (!transfer.write_page(handler, address, source, result)) {
+        break;
+      }
+      transfer.wait_write_cycle(handler, device_address, std::chrono::steady_clock::now());
+    }
+  }
+
+  bool execute_slice(ThreadUnsafeI2CHandler & handler, uint32_t /*max_messages*/) final
+  {
+    // the engine waits for the write cycle, and runs other requests meanwhile
+    return !transfer.write_page(handler, address, source, result);
+  }
+
+  void complete(std::exception_ptr error) final
+  {
+    if (error) {
+      promise.set_exception(std::move(error));
+      return;
+    }
+    result.duration = std::chrono::steady_clock::now() - start;
+    promise.set_value(result);
+  }
+
+private:
+  I2CBulkTransfer & transfer;
+  uint32_t address;
+  I2CBulkSource & source;
+
+  std::chrono::steady_clock::time_point start;
+  I2CBulkTransferResult result;
+  std::promise<I2CBulkTransferResult> promise;
+};
+
+std::future<I2CBulkTransferResult> I2CBulkTransfer::submit_write(
+  I2CAsyncEngine & engine, uint32_t address, I2CBulkSource & source,
+  I2CPriorityClass priority)
+{
+  auto request = std::make_unique<WriteRequest>(*this, address, source);
+  request->scheduling.priority = priority;
+  request->scheduling.slice_messages = 1;
+  request->scheduling.write_cycle_time = geometry.write_cycle_time;
+
+  auto future = request->get_future();
+  engine.post(std::move(request));
+  return future;
+}
+
+template I2CBulkTransferResult I2CBulkTransfer::read(
+  const ThreadSafeI2CHandler &, uint32_t, I2CBulkSink &, std::size_t);
+template I2CBulkTransferResult I2CBulkTransfer::read(
+  const ThreadUnsafeI2CHandler &, uint32_t, I2CBulkSink &, std::size_t);
+template I2CBulkTransferResult I2CBulkTransfer::write(
+  const ThreadSafeI2CHandler &, uint32_t, I2CBulkSource &);
+template I2CBulkTransferResult I2CBulkTransfer::write(
+  const ThreadUnsafeI2CHandler &, uint32_t, I2CBulkSource &);
+template I2CBulkTransferResult I2CBulkTransfer::read(
+  const PriorityInheritanceI2CHandler &, uint32_t, I2CBulkSink &, std::size_t);
+template I2CBulkTransferResult I2CBulkTransfer::write(
+  const PriorityInheritanceI2CHandler &, uint32_t, I2CBulkSource &);
+template I2CBulkTransferResult I2CBulkTransfer::read(
+  const SpinThenParkI2CHandler &, uint32_t, I2CBulkSink &, std::size_t);
+template I2CBulkTransferResult I2CBulkTransfer::write(
+  const SpinThenParkI2CHandler &, uint32_t, I2CBulkSource &);
+
+}  // namespace ros2_i2ccpp
@@ -0,0 +1,102 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "ros2_i2ccpp/bus_dispatcher.hpp"
+#include "ros2_i2ccpp/backend/i2c_backend.hpp"
+
+namespace ros2_i2ccpp
+{
+
+using namespace exceptions;
+
+I2CAsyncEngine & I2CBusDispatcher::add_bus(uint32_t bus)
+{
+  return add_bus(bus, "/dev/i2c-" + std::to_string(bus));
+}
+
+I2CAsyncEngine & I2CBusDispatcher::add_bus(uint32_t bus, std::string i2c_adapter_path)
+{
+  return emplace_bus(bus, std::make_unique<I2CAsyncEngine>(i2c_adapter_path));
+}
+
+I2CAsyncEngine & I2CBusDispatcher::add_bus(
+  uint32_t bus, std::unique_ptr<I2CBackend> backend,
+  std::string i2c_adapter_path)
+{
+  return emplace_bus(bus, std::make_unique<I2CAsyncEngine>(std::move(backend), i2c_adapter_path));
+}
+
+I2CAsyncEngine & I2CBusDispatcher::emplace_bus(
+  uint32_t bus,
+  std::unique_ptr<I2CAsyncEngine> engine)
+{
+  if (buses.count(bus) > 0) {
+    throw IllegalOperationException("Bus " + std::to_string(bus) + " was already added");
+  }
+
+  auto & entry = buses[bus];
+  entry.engine = std::move(engine);
+  entry.sample_time = std::chrono::steady_clock::now();
+  return *entry.engine;
+}
+
+void I2CBusDispatcher::attach_device(uint16_t address, uint32_t bus)
+{
+  // make sure the bus exists
+  static_cast<void>(get_bus(bus));
+
+  const auto [it, inserted] = device_buses.emplace(address, bus);
+  if (!inserted && it->second != bus) {
+    throw IllegalOperationException("Device address is already attached to bus " +
+            std::to_string(it->second));
+  }
+}
+
+I2CAsyncEngine & I2CBusDispatcher::get_bus(uint32_t bus) const
+{
+  const auto it = buses.find(bus);
+  if (it == buses.end()) {
+    throw IllegalOperationException("Bus " + std::to_string(bus) + " was not added");
+  }
+  return *it->second.engine;
+}
+
+uint32_t I2CBusDispatcher::get_device_bus(uint16_t address) const
+{
+  const auto it = device_buses.find(address);
+  if (it == device_buses.end()) {
+    throw IllegalOperationException("Device address was not attached to any bus");
+  }
+  return it->second;
+}
+
+std::vector<I2CBusStatistics> I2CBusDispatcher::get_statistics()
+{
+  std::scoped_lock lock{statistics_mutex};
+
+  std::vector<I2CBusStatistics> statistics;
+  statistics.reserve(buses.size());
+
+  const auto now = std::chrono::steady_clock::now();
+  for (auto & [bus_id, bus] : buses) {
+    auto & sample = statistics.emplace_back();
+    sample.bus = bus_id;
+    sample.queue_depth = bus.engine->get_queue_depth();
+    sample.totals = bus.engine->get_statistics();
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      now - bus.sample_time);
+    if (elapsed.count() > 0) {
+      sample.utilization = static_cast<double>((sample.totals.busy_time -
+        bus.sample_busy_time).count()) / static_cast<double>(elapsed.count());
+    }
+
+    bus.sample_time = now;
+    bus.sample_busy_time = sample.totals.busy_time;
+  }
+  return statistics;
+}
+
+}  // namespace ros2_i2ccpp
@@ -9,57 +9,127 @@ namespace ros2_i2ccpp
 
 template<typename Mutex>
 I2CHandler<Mutex>::I2CHandler(uint16_t i2c_addr, std::string i2c_adapter_path)
-: handler(std::make_unique<I2CHandlerImpl>(i2c_addr, i2c_adapter_path))
+: handler(std::make_unique<I2CHandlerImpl>(i2c_addr, i2c_adapter_path)),
+  adapter_func(handler->get_adapter_func()),
+  current_device_addr(handler->get_current_device_addr())
 {
 
 }
 
 template<typename Mutex>
 I2CHandler<Mutex>::I2CHandler(std::string i2c_adapter_path)
-: handler(std::make_unique<I2CHandlerImpl>(i2c_adapter_path))
+: handler(std::make_unique<I2CHandlerImpl>(i2c_adapter_path)),
+  adapter_func(handler->get_adapter_func()),
+  current_device_addr(handler->get_current_device_addr())
 {
 
 }
 
+template<typename Mutex>
+I2CHandler<Mutex>::I2CHandler(
+  uint16_t i2c_addr, std::unique_ptr<I2CBackend> backend,
+  std::string i2c_adapter_path)
+: handler(std::make_unique<I2CHandlerImpl>(i2c_addr, std::move(backend), i2c_adapter_path)),
+  adapter_func(handler->get_adapter_func()),
+  current_device_addr(handler->get_current_device_addr())
+{
+
+}
 
 template<typename Mutex>
-uint64_t I2CHandler<Mutex>::get_adapter_func() const
+I2CHandler<Mutex>::I2CHandler(std::unique_ptr<I2CBackend> backend, std::string i2c_adapter_path)
+: handler(std::make_unique<I2CHandlerImpl>(std::move(backend), i2c_adapter_path)),
+  adapter_func(handler->get_adapter_func()),
+  current_device_addr(handler->get_current_device_addr())
 {
-  std::scoped_lock{mut};
-  return handler->get_adapter_func();
+
 }
 
 template<typename Mutex>
-uint64_t I2CHandler<Mutex>::get_current_device_addr() const
+I2CHandler<Mutex>::~I2CHandler() = default;
+
+
+template<typename Mutex>
+void I2CHandler<Mutex>::set_pec(bool enable)
 {
-  std::scoped_lock{mut};
-  return handler->get_current_device_addr();
+  RecordedLock lock{*this};
+  handler->set_pec(enable);
 }
 
 template<typename Mutex>
-bool I2CHandler<Mutex>::has_functionality(uint64_t flag) const
+void I2CHandler<Mutex>::set_addressing_mode(I2CAddressingMode mode)
 {
-  std::scoped_lock{mut};
-  return handler->has_functionality(flag);
+  RecordedLock lock{*this};
+  handler->set_addressing_mode(mode);
+
+  // transactions carry their own addresses, only this selects another device
+  current_device_addr.store(handler->get_current_device_addr(), std::memory_order_release);
 }
 
 template<typename Mutex>
-void I2CHandler<Mutex>::set_pec(bool enable)
+void I2CHandler<Mutex>::set_retry_policy(const I2CRetryPolicy & policy)
 {
-  std::scoped_lock{mut};
-  handler->set_pec(enable);
+  RecordedLock lock{*this};
+  retry_policy = policy;
+}
+
+template<typename Mutex>
+I2CRetryPolicy I2CHandler<Mutex>::get_retry_policy() const
+{
+  RecordedLock lock{*this};
+  return retry_policy;
+}
+
+template<typename Mutex>
+void I2CHandler<Mutex>::enable_statistics(bool enable)
+{
+  statistics.store(enable ? statistics_recorder.get() : nullptr, std::memory_order_release);
+}
+
+template<typename Mutex>
+I2CHandlerStatistics I2CHandler<Mutex>::get_statistics() const
+{
+  return statistics_recorder->get_statistics();
+}
+
+template<typename Mutex>
+void I2CHandler<Mutex>::apply_transaction(I2CTransaction && transaction) const
+{
+  try_apply_transaction(std::move(transaction)).value("Error executing ioctl request");
+}
+
+template<typename Mutex>
+void I2CHandler<Mutex>::apply_transaction(
+  I2CTransaction && transaction,
+  const I2CRetryPolicy & policy) const
+{
+  try_apply_transaction(std::move(transaction), policy).value("Error executing ioctl request");
+}
+
+template<typename Mutex>
+I2CResult<void> I2CHandler<Mutex>::try_apply_transaction(I2CTransaction && transaction) const
+{
+  return try_apply(std::move(transaction), nullptr);
 }
 
 template<typename Mutex>
-void I2CHandler<Mutex>::apply_transaction(I2CTransaction && transaction_) const
+I2CResult<void> I2CHandler<Mutex>::try_apply_transaction(
+  I2CTransaction && transaction,
+  const I2CRetryPolicy & policy) const
 {
-  std::scoped_lock{mut};
+  return try_apply(std::move(transaction), &policy);
+}
 
+template<typename Mutex>
+I2CResult<void> I2CHandler<Mutex>::try_apply(
+  I2CTransaction && transaction_,
+  const I2CRetryPolicy * policy) const
+{
   auto transaction = std::move(transaction_);
 
   std::pmr::vector<i2c_msg> inner_buf{&transaction.getMemoryResource()};
 
-  // build i2c message buffer from transaction segments
+  // build i2c message buffer from transaction segments, once for all the attempts
   std::transform(
   transaction.getSegments().begin(), transaction.getSegments().end(), std::back_inserter(inner_buf),
     [](const std::shared_ptr<I2CTransactionSegment> & segment) {
@@ -67,13 +137,126 @@ void I2CHandler<Mutex>::apply_transaction(I2CTransaction && transaction_) const
         segment->get_data()};
   });
 
-  // ship i2c transaction
-  handler->process_i2c_transaction(inner_buf);
+  ROS2_I2CCPP_TRACEPOINT(transaction_build, this, transaction.getSegments().size(),
+    transaction.is_chunking_allowed());
+
+  // chunks that went out are not sent again by the next attempt
+  uint32_t sent_messages = 0;
+  return apply_with_retries(policy, [this, &transaction, &inner_buf, &sent_messages]() {
+      rearm_segments(transaction.getSegments(), sent_messages);
+
+      // ship i2c transaction
+      auto result = transfer(inner_buf.data() + sent_messages,
+        static_cast<uint32_t>(inner_buf.size()) - sent_messages,
+        transaction.is_chunking_allowed(), &sent_messages);
+      if (!result) {
+        return result;
+      }
 
-  // the transaction should now be destroyed
+      // decode the segments that need it, e.g. to check a PEC
+      const auto error = commit_segments(transaction.getSegments());
+      ROS2_I2CCPP_TRACEPOINT(segments_decoded, this, error);
+      if (error != 0) {
+        return I2CResult<void>{make_i2c_error(error)};
+      }
+
+      // the read segments now hold the data received
+      return I2CResult<void>{};
+    });
+}
+
+template<typename Mutex>
+void I2CHandler<Mutex>::apply_messages(
+  i2c_msg * messages, uint32_t message_count,
+  bool allow_chunking) const
+{
+  try_apply_messages(messages, message_count, allow_chunking).value(
+    "Error executing ioctl request");
+}
+
+template<typename Mutex>
+I2CResult<void> I2CHandler<Mutex>::try_apply_messages(
+  i2c_msg * messages, uint32_t message_count,
+  bool allow_chunking) const
+{
+  // chunks that went out are not sent again by the next attempt
+  uint32_t sent_messages = 0;
+  return apply_with_retries(nullptr,
+      [this, messages, message_count, allow_chunking, &sent_messages]() {
+      return transfer(messages + sent_messages, message_count - sent_messages, allow_chunking,
+        &sent_messages);
+    });
+}
+
+template<typename Mutex>
+I2CResult<void> I2CHandler<Mutex>::try_apply_messages(
+  i2c_msg * messages, uint32_t message_count,
+  bool allow_chunking, const I2CRetryPolicy & policy) const
+{
+  uint32_t sent_messages = 0;
+  return apply_with_retries(&policy,
+      [this, messages, message_count, allow_chunking, &sent_messages]() {
+      return transfer(messages + sent_messages, message_count - sent_messages, allow_chunking,
+        &sent_messages);
+    });
+}
+
+template<typename Mutex>
+I2CResult<void> I2CHandler<Mutex>::transfer(
+  i2c_msg * messages, uint32_t message_count,
+  bool allow_chunking, uint32_t * sent_messages) const
+{
+  const auto process = [this, messages, message_count, allow_chunking, sent_messages]() {
+      if (!allow_chunking) {
+        auto result = handler->try_process_i2c_transaction(messages, message_count);
+        if (result && sent_messages != nullptr) {
+          *sent_messages += message_count;
+        }
+        return result;
+      }
+
+      uint32_t sent = 0;
+      auto result = handler->try_process_i2c_transaction_chunked(messages, message_count, &sent);
+      if (sent_messages != nullptr) {
+        *sent_messages += sent;
+      }
+      return result;
+    };
+
+  auto * recorder = statistics.load(std::memory_order_relaxed);
+  if (recorder == nullptr) {
+    return process();
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  auto result = process();
+  recorder->record_transfer(messages, message_count, std::chrono::steady_clock::now() - start,
+    result.error().value());
+  return result;
+}
+
+template<typename Mutex>
+I2CResult<void> I2CHandler<Mutex>::set_adapter_limits(const I2CRetryPolicy & policy) const
+{
+  return handler->try_set_adapter_limits(policy);
+}
+
+template<typename Mutex>
+bool I2CHandler<Mutex>::poll_ack(uint16_t i2c_addr) const
+{
+  return try_poll_ack(i2c_addr).value("Unable to poll the device");
+}
+
+template<typename Mutex>
+I2CResult<bool> I2CHandler<Mutex>::try_poll_ack(uint16_t i2c_addr) const
+{
+  RecordedLock lock{*this};
+  return handler->try_poll_ack(i2c_addr);
 }
 
 template class I2CHandler<std::mutex>;
 template class I2CHandler<null_mutex>;
+template class I2CHandler<priority_inheritance_mutex>;
+template class I2CHandler<spin_then_park_mutex>;
 
 }
@@ -5,15 +5,18 @@
 
 extern "C"
 {
-#include <fcntl.h>  //open
-#include <unistd.h> // close
 #include <linux/i2c-dev.h>
 #include <linux/i2c.h>
-#include <i2c/smbus.h>
-#include <sys/ioctl.h>
 }
 
+#include <cerrno>
+#include <cstring>
+
 #include "ros2_i2ccpp/impl/i2c_handler_impl.hpp"
+#include "ros2_i2ccpp/backend/i2c_dev_backend.hpp"
+#include "ros2_i2ccpp/impl/message_chunking.hpp"
+#include "ros2_i2ccpp/impl/smbus_transfer.hpp"
+#include "ros2_i2ccpp/impl/tracing.hpp"
 #include "ros2_i2ccpp/constants.hpp"
 #include "ros2_i2ccpp/exceptions.hpp"
 
@@ -23,11 +26,23 @@ namespace ros2_i2ccpp
 using namespace exceptions;
 
 I2CHandlerImpl::I2CHandlerImpl(uint16_t i2c_addr, std::string i2c_adapter_path)
+: I2CHandlerImpl(i2c_addr, std::make_unique<I2CDevBackend>(), i2c_adapter_path)
+{
+}
+I2CHandlerImpl::I2CHandlerImpl(std::string i2c_adapter_path)
+: I2CHandlerImpl(std::make_unique<I2CDevBackend>(), i2c_adapter_path)
+{
+}
+I2CHandlerImpl::I2CHandlerImpl(
+  uint16_t i2c_addr, std::unique_ptr<I2CBackend> backend_,
+  std::string i2c_adapter_path)
+: backend(std::move(backend_))
 {
   // open handle to the i2c device immediately
   open(i2c_addr, i2c_adapter_path);
 }
-I2CHandlerImpl::I2CHandlerImpl(std::string i2c_adapter_path)
+I2CHandlerImpl::I2CHandlerImpl(std::unique_ptr<I2CBackend> backend_, std::string i2c_adapter_path)
+: backend(std::move(backend_))
 {
   open(i2c_adapter_path);
 }
@@ -40,19 +55,18 @@ void I2CHandlerImpl::open(const std::string i2c_adapter_path)
 {
   // if we already have a valid file descriptor, throw since we need to close the handle
   if (is_opened()) {
-    throw IllegalOperationException(
-            "File descriptor was already obtained, make sure to close the previous descriptor before opening a new one");
+    ROS2_I2CCPP_THROW(IllegalOperationException(
+            "File descriptor was already obtained, make sure to close the previous descriptor before opening a new one"));
   }
 
   // get and store fd to i2c adapter
-  i2c_file_desc = ::open(i2c_adapter_path.c_str(), O_NONBLOCK | O_RDWR);
-  if (i2c_file_desc < 0) {
-    throw SysException("Unable acquire file descriptor to device");
+  if (backend->open(i2c_adapter_path) < 0) {
+    ROS2_I2CCPP_THROW(SysException("Unable acquire file descriptor to device"));
   }
 
   // query the adapter functionality for later use
-  if (ioctl(i2c_file_desc, I2C_FUNCS, &adapter_func) < 0) {
-    throw SysException("Unable query adapter functionality");
+  if (backend->get_functionality(adapter_func) < 0) {
+    ROS2_I2CCPP_THROW(SysException("Unable query adapter functionality"));
   }
 }
 
@@ -65,301 +79,689 @@ void I2CHandlerImpl::open(const uint16_t i2c_addr, const std::string i2c_adapter
 void I2CHandlerImpl::close()
 {
   if (is_opened()) {
-    if (::close(i2c_file_desc) < 0) {
-      throw SysException("Unable close file descriptor");
+    if (backend->close() < 0) {
+      ROS2_I2CCPP_THROW(SysException("Unable close file descriptor"));
     }
 
-    // reset file descriptor and adapter functionality
-    i2c_file_desc = INVALID_FILE_DESC;
+    // reset adapter functionality
     adapter_func = 0;
 
-    // as well as the cached i2c address
+    // as well as the cached i2c address and adapter state
     cached_i2c_addr = INVALID_I2C_ADDR;
+    ten_bit_enabled = false;
+    pec_enabled = false;
+    adapter_retries = -1;
+    adapter_timeout_units = -1;
   }
 }
 
 void I2CHandlerImpl::set_i2c_device(const uint16_t i2c_addr)
+{
+  try_set_i2c_device(i2c_addr).value("Unable acquire file descriptor to device");
+}
+
+I2CResult<void> I2CHandlerImpl::try_set_i2c_device(const uint16_t i2c_addr)
 {
   // ensure we have a valid file descriptor
   if (!is_opened()) {
-    throw IllegalOperationException("File descriptor is invalid");
+    return make_i2c_precondition_error(EBADF);
+  }
+
+  // the address travels with every message, so there is nothing to tell the adapter
+  if (addressing_mode == I2CAddressingMode::ADDRESSING_PER_MESSAGE) {
+    if (i2c_addr > I2CConstants::I2C_MAX_7BIT_ADDRESS &&
+      !has_functionality(I2CControllerFunctionalityFlags::FUNC_10BIT_ADDR))
+    {
+      return make_i2c_precondition_error(EOPNOTSUPP);
+    }
+    cached_i2c_addr = i2c_addr;
+    return {};
   }
 
   // check if we are already using this device
   if (cached_i2c_addr != i2c_addr) {
     // check if the i2c address needs 10-bit enabled
-    set_ten_bit_if_needed(i2c_addr);
+    if (auto result = try_set_ten_bit_if_needed(i2c_addr); !result) {
+      return result;
+    }
 
     // choose which i2c device we want to use for all operations
-    if (ioctl(i2c_file_desc, I2CIOControlCommands::SLAVE, i2c_addr) < 0) {
-      throw SysException("Unable acquire file descriptor to device");
+    if (backend->set_slave_address(i2c_addr) < 0) {
+      return make_i2c_error(errno);
     }
     cached_i2c_addr = i2c_addr;
   }
+  return {};
 }
 
-template<typename Alloc>
-void I2CHandlerImpl::process_i2c_transaction(std::vector<i2c_msg, Alloc> & messages) const
+int I2CHandlerImpl::check_operation(const uint64_t flag) const
 {
   // ensure we have a valid file descriptor
   if (!is_opened()) {
-    throw IllegalOperationException("File descriptor is invalid");
+    return EBADF;
   }
 
-  if (!has_functionality(I2CControllerFunctionalityFlags::FUNC_I2C)) {
-    throw IllegalOperationException("Adapter does not support this operation!");
+  if (!has_functionality(flag)) {
+    return EOPNOTSUPP;
   }
+  return 0;
+}
+
+void I2CHandlerImpl::process_i2c_transaction(
+  i2c_msg * messages,
+  const uint32_t message_count) const
+{
+  try_process_i2c_transaction(messages, message_count).value("Error executing ioctl request");
+}
 
-  if (messages.size() > I2C_RDWR_IOCTL_MAX_MSGS) {
-    throw IllegalOperationException(
-            "I2C does not support this many messages in a single transaction");
+I2CResult<void> I2CHandlerImpl::try_process_i2c_transaction(
+  i2c_msg * messages,
+  const uint32_t message_count) const
+{
+  if (const auto error = check_operation(I2CControllerFunctionalityFlags::FUNC_I2C)) {
+    return make_i2c_precondition_error(error);
   }
-  // initialize transaction block and messages
-  i2c_rdwr_ioctl_data transaction_block{messages.data(), static_cast<uint32_t>(messages.size())};
 
+  if (message_count > I2C_RDWR_IOCTL_MAX_MSGS) {
+    return make_i2c_precondition_error(EMSGSIZE);
+  }
   // apply transaction
-  if (ioctl(i2c_file_desc, I2CIOControlCommands::RDWR, &transaction_block) < 0) {
-    throw SysException("Error executing ioctl request");
+  ROS2_I2CCPP_TRACEPOINT(i2c_transfer_enter, this, message_count > 0 ? messages[0].addr : 0,
+    message_count);
+  if (backend->transfer(messages, message_count) < 0) {
+    const auto error = errno;
+    ROS2_I2CCPP_TRACEPOINT(i2c_transfer_exit, this, error);
+    return make_i2c_error(error);
+  }
+  ROS2_I2CCPP_TRACEPOINT(i2c_transfer_exit, this, 0);
+  return {};
+}
+
+void I2CHandlerImpl::process_i2c_transaction_chunked(
+  i2c_msg * messages,
+  uint32_t message_count) const
+{
+  try_process_i2c_transaction_chunked(messages, message_count).value(
+    "Error executing ioctl request");
+}
+
+I2CResult<void> I2CHandlerImpl::try_process_i2c_transaction_chunked(
+  i2c_msg * messages,
+  uint32_t message_count, uint32_t * sent_messages) const
+{
+  uint32_t sent = 0;
+  I2CResult<void> result;
+  while (sent < message_count) {
+    // a group of messages that does not fit in a single transfer cannot be split
+    const auto chunk_size =
+      next_chunk_size(messages + sent, message_count - sent, I2C_RDWR_IOCTL_MAX_MSGS);
+    if (chunk_size == 0) {
+      result = make_i2c_precondition_error(EMSGSIZE);
+      break;
+    }
+
+    result = try_process_i2c_transaction(messages + sent, chunk_size);
+    if (!result) {
+      break;
+    }
+    sent += chunk_size;
   }
+
+  if (sent_messages != nullptr) {
+    *sent_messages = sent;
+  }
+  return result;
 }
 
-template void I2CHandlerImpl::process_i2c_transaction(std::pmr::vector<i2c_msg> & messages) const;
+bool I2CHandlerImpl::poll_ack(const uint16_t i2c_addr)
+{
+  return try_poll_ack(i2c_addr).value("Unable to poll the device");
+}
 
-void I2CHandlerImpl::write_quick(const uint8_t value) const
+I2CResult<bool> I2CHandlerImpl::try_poll_ack(const uint16_t i2c_addr)
 {
-  // ensure we have a valid file descriptor
   if (!is_opened()) {
-    throw IllegalOperationException("File descriptor is invalid");
+    return make_i2c_precondition_error(EBADF);
+  }
+
+  if (has_functionality(I2CControllerFunctionalityFlags::FUNC_I2C)) {
+    // only the address goes on the bus, so a busy device costs a single byte
+    const uint16_t flags = i2c_addr > I2CConstants::I2C_MAX_7BIT_ADDRESS ?
+      static_cast<uint16_t>(I2CMessageFlags::M_TEN) : 0;
+    i2c_msg message{i2c_addr, flags, 0, nullptr};
+    ROS2_I2CCPP_TRACEPOINT(i2c_transfer_enter, this, i2c_addr, 1);
+    const auto error = backend->transfer(&message, 1) < 0 ? errno : 0;
+    ROS2_I2CCPP_TRACEPOINT(i2c_transfer_exit, this, error);
+    if (error == 0) {
+      return true;
+    }
+    if (error == ENXIO || error == EREMOTEIO) {
+      return false;
+    }
+
+    // adapters with the no zero-length quirk refuse the message, but may take a quick command
+    if (error != EOPNOTSUPP ||
+      !has_functionality(I2CControllerFunctionalityFlags::FUNC_SMBUS_QUICK))
+    {
+      return make_i2c_error(error);
+    }
+  }
+
+  return try_poll_ack_quick(i2c_addr);
+}
+
+I2CResult<bool> I2CHandlerImpl::try_poll_ack_quick(const uint16_t i2c_addr)
+{
+  if (const auto error = check_operation(I2CControllerFunctionalityFlags::FUNC_SMBUS_QUICK)) {
+    return make_i2c_precondition_error(error);
   }
 
-  if (!has_functionality(I2CControllerFunctionalityFlags::FUNC_SMBUS_QUICK)) {
-    throw IllegalOperationException("Adapter does not support this operation!");
+  // I2C_SMBUS takes the device from I2C_SLAVE, which is left unused when addressing per message
+  if (addressing_mode == I2CAddressingMode::ADDRESSING_SLAVE_IOCTL) {
+    if (auto selected = try_set_i2c_device(i2c_addr); !selected) {
+      return selected.error();
+    }
+  } else {
+    if (auto result = try_set_ten_bit_if_needed(i2c_addr); !result) {
+      return result.error();
+    }
+    if (backend->set_slave_address(i2c_addr) < 0) {
+      return make_i2c_error(errno);
+    }
   }
 
-  if (i2c_smbus_write_quick(i2c_file_desc, value) < 0) {
-    throw SysException("Unable to write quick");
+  // the same address-only write, as an SMBus quick command (e.g. i801, piix4)
+  ROS2_I2CCPP_TRACEPOINT(smbus_enter, this, i2c_addr, I2C_SMBUS_WRITE, 0, I2C_SMBUS_QUICK);
+  const auto error = backend->smbus_access(I2C_SMBUS_WRITE, 0, I2C_SMBUS_QUICK, nullptr) < 0 ?
+    errno : 0;
+  ROS2_I2CCPP_TRACEPOINT(smbus_exit, this, error);
+  if (error == ENXIO || error == EREMOTEIO) {
+    return false;
   }
+  if (error != 0) {
+    return make_i2c_error(error);
+  }
+  return true;
 }
 
-uint8_t I2CHandlerImpl::read_byte() const
+void I2CHandlerImpl::write_quick(const uint8_t value) const
 {
-  // ensure we have a valid file descriptor
-  if (!is_opened()) {
-    throw IllegalOperationException("File descriptor is invalid");
+  try_write_quick(value).value("Unable to write quick");
+}
+
+I2CResult<void> I2CHandlerImpl::try_write_quick(const uint8_t value) const
+{
+  if (const auto error = check_operation(I2CControllerFunctionalityFlags::FUNC_SMBUS_QUICK)) {
+    return make_i2c_precondition_error(error);
   }
 
-  if (!has_functionality(I2CControllerFunctionalityFlags::FUNC_SMBUS_READ_BYTE)) {
-    throw IllegalOperationException("Adapter does not support this operation!");
+  if (const auto error = smbus_access(value, 0, I2C_SMBUS_QUICK, nullptr)) {
+    return make_i2c_error(error);
   }
+  return {};
+}
+
+uint8_t I2CHandlerImpl::read_byte() const
+{
+  return try_read_byte().value("Unable to read byte");
+}
 
-  const auto result = i2c_smbus_read_byte(i2c_file_desc);
-  if (result < 0) {
-    throw SysException("Unable to execute request");
+I2CResult<uint8_t> I2CHandlerImpl::try_read_byte() const
+{
+  if (const auto error = check_operation(I2CControllerFunctionalityFlags::FUNC_SMBUS_READ_BYTE)) {
+    return make_i2c_precondition_error(error);
   }
 
-  return static_cast<uint8_t>(result);
+  i2c_smbus_data data{};
+  if (const auto error = smbus_access(I2C_SMBUS_READ, 0, I2C_SMBUS_BYTE, &data)) {
+    return make_i2c_error(error);
+  }
+  return data.byte;
 }
 
 void I2CHandlerImpl::write_byte(const uint8_t value) const
 {
-  // ensure we have a valid file descriptor
-  if (!is_opened()) {
-    throw IllegalOperationException("File descriptor is invalid");
-  }
+  try_write_byte(value).value("Unable to write byte");
+}
 
-  if (!has_functionality(I2CControllerFunctionalityFlags::FUNC_SMBUS_WRITE_BYTE)) {
-    throw IllegalOperationException("Adapter does not support this operation");
+I2CResult<void> I2CHandlerImpl::try_write_byte(const uint8_t value) const
+{
+  if (const auto error = check_operation(I2CControllerFunctionalityFlags::FUNC_SMBUS_WRITE_BYTE)) {
+    return make_i2c_precondition_error(error);
   }
 
-  if (i2c_smbus_write_byte(i2c_file_desc, value) < 0) {
-    throw SysException("Unable to execute request");
+  if (const auto error = smbus_access(I2C_SMBUS_WRITE, value, I2C_SMBUS_BYTE, nullptr)) {
+    return make_i2c_error(error);
   }
+  return {};
 }
 
 uint8_t I2CHandlerImpl::read_byte_at(const uint16_t register_addr) const
 {
-  // ensure we have a valid file descriptor
-  if (!is_opened()) {
-    throw IllegalOperationException("File descriptor is invalid");
-  }
+  return try_read_byte_at(register_addr).value("Unable to read byte data");
+}
 
-  if (!has_functionality(I2CControllerFunctionalityFlags::FUNC_SMBUS_READ_BYTE_DATA)) {
-    throw IllegalOperationException("Adapter does not support this operation!");
-  }
-  const auto result = i2c_smbus_read_byte_data(i2c_file_desc, register_addr);
-  if (result < 0) {
-    throw SysException("Unable to execute request");
+I2CResult<uint8_t> I2CHandlerImpl::try_read_byte_at(const uint16_t register_addr) const
+{
+  if (const auto error =
+    check_operation(I2CControllerFunctionalityFlags::FUNC_SMBUS_READ_BYTE_DATA))
+  {
+    return make_i2c_precondition_error(error);
   }
 
-  return static_cast<uint8_t>(result);
+  i2c_smbus_data data{};
+  if (const auto error = smbus_access(I2C_SMBUS_READ, register_addr, I2C_SMBUS_BYTE_DATA, &data)) {
+    return make_i2c_error(error);
+  }
+  return data.byte;
 }
 
 void I2CHandlerImpl::write_byte_at(const uint16_t register_addr, const uint8_t value) const
 {
-  // ensure we have a valid file descriptor
-  if (!is_opened()) {
-    throw IllegalOperationException("File descriptor is invalid");
-  }
+  try_write_byte_at(register_addr, value).value("Unable to write byte data");
+}
 
-  if (!has_functionality(I2CControllerFunctionalityFlags::FUNC_SMBUS_WRITE_BYTE_DATA)) {
-    throw IllegalOperationException("Adapter does not support this operation!");
+I2CResult<void> I2CHandlerImpl::try_write_byte_at(
+  const uint16_t register_addr,
+  const uint8_t value) const
+{
+  if (const auto error =
+    check_operation(I2CControllerFunctionalityFlags::FUNC_SMBUS_WRITE_BYTE_DATA))
+  {
+    return make_i2c_precondition_error(error);
   }
 
-  if (i2c_smbus_write_byte_data(i2c_file_desc, register_addr, value) < 0) {
-    throw SysException("Unable to execute request");
+  i2c_smbus_data data{};
+  data.byte = value;
+  if (const auto error =
+    smbus_access(I2C_SMBUS_WRITE, register_addr, I2C_SMBUS_BYTE_DATA, &data))
+  {
+    return make_i2c_error(error);
   }
+  return {};
 }
 
 uint16_t I2CHandlerImpl::read_word(const uint16_t register_addr) const
 {
-  // ensure we have a valid file descriptor
-  if (!is_opened()) {
-    throw IllegalOperationException("File descriptor is invalid");
-  }
+  return try_read_word(register_addr).value("Unable to read word data");
+}
 
-  if (!has_functionality(I2CControllerFunctionalityFlags::FUNC_SMBUS_READ_WORD_DATA)) {
-    throw IllegalOperationException("Adapter does not support this operation!");
+I2CResult<uint16_t> I2CHandlerImpl::try_read_word(const uint16_t register_addr) const
+{
+  if (const auto error =
+    check_operation(I2CControllerFunctionalityFlags::FUNC_SMBUS_READ_WORD_DATA))
+  {
+    return make_i2c_precondition_error(error);
   }
-  const auto result = i2c_smbus_read_word_data(i2c_file_desc, register_addr);
 
-  if (result < 0) {
-    throw SysException("Unable to execute request");
+  i2c_smbus_data data{};
+  if (const auto error = smbus_access(I2C_SMBUS_READ, register_addr, I2C_SMBUS_WORD_DATA, &data)) {
+    return make_i2c_error(error);
   }
-
-  return static_cast<uint16_t>(result);
+  return data.word;
 }
 
 void I2CHandlerImpl::write_word(const uint16_t register_addr, const uint16_t value) const
 {
-  // ensure we have a valid file descriptor
-  if (!is_opened()) {
-    throw IllegalOperationException("File descriptor is invalid");
-  }
+  try_write_word(register_addr, value).value("Unable to write word data");
+}
 
-  if (!has_functionality(I2CControllerFunctionalityFlags::FUNC_SMBUS_WRITE_WORD_DATA)) {
-    throw IllegalOperationException("Adapter does not support this operation!");
+I2CResult<void> I2CHandlerImpl::try_write_word(
+  const uint16_t register_addr,
+  const uint16_t value) const
+{
+  if (const auto error =
+    check_operation(I2CControllerFunctionalityFlags::FUNC_SMBUS_WRITE_WORD_DATA))
+  {
+    return make_i2c_precondition_error(error);
   }
 
-  if (i2c_smbus_write_word_data(i2c_file_desc, register_addr, value) < 0) {
-    throw SysException("Unable to execute request");
+  i2c_smbus_data data{};
+  data.word = value;
+  if (const auto error =
+    smbus_access(I2C_SMBUS_WRITE, register_addr, I2C_SMBUS_WORD_DATA, &data))
+  {
+    return make_i2c_error(error);
   }
+  return {};
 }
 
 uint16_t I2CHandlerImpl::process_call(const uint16_t register_addr, const uint16_t value) const
 {
-  // ensure we have a valid file descriptor
-  if (!is_opened()) {
-    throw IllegalOperationException("File descriptor is invalid");
-  }
+  return try_process_call(register_addr, value).value("Unable to execute process call");
+}
 
-  if (!has_functionality(I2CControllerFunctionalityFlags::FUNC_SMBUS_PROC_CALL)) {
-    throw IllegalOperationException("Adapter does not support this operation!");
+I2CResult<uint16_t> I2CHandlerImpl::try_process_call(
+  const uint16_t register_addr,
+  const uint16_t value) const
+{
+  if (const auto error = check_operation(I2CControllerFunctionalityFlags::FUNC_SMBUS_PROC_CALL)) {
+    return make_i2c_precondition_error(error);
   }
 
-  const auto result = i2c_smbus_process_call(i2c_file_desc, register_addr, value);
-  if (result < 0) {
-    throw SysException("Unable to execute request");
+  i2c_smbus_data data{};
+  data.word = value;
+  if (const auto error = smbus_access(I2C_SMBUS_WRITE, register_addr, I2C_SMBUS_PROC_CALL, &data)) {
+    return make_i2c_error(error);
   }
-  return static_cast<uint16_t>(result);
+  return data.word;
 }
 
 uint16_t I2CHandlerImpl::block_process_call(
   const uint16_t register_addr,
   std::vector<uint8_t> & data) const
 {
-  // ensure we have a valid file descriptor
-  if (!is_opened()) {
-    throw IllegalOperationException("File descriptor is invalid");
+  I2CSMBusBlock reply;
+  const auto length = block_process_call(register_addr, data.data(), data.size(), reply);
+
+  // the reply replaces the data that was sent
+  data.assign(reply.data.begin(), reply.data.begin() + length);
+  return length;
+}
+
+uint8_t I2CHandlerImpl::block_process_call(
+  const uint16_t register_addr, const uint8_t * data, const std::size_t size,
+  I2CSMBusBlock & reply) const
+{
+  return try_block_process_call(register_addr, data, size, reply).value(
+    "Unable to execute block process call");
+}
+
+I2CResult<uint8_t> I2CHandlerImpl::try_block_process_call(
+  const uint16_t register_addr, const uint8_t * data, const std::size_t size,
+  I2CSMBusBlock & reply) const
+{
+  if (const auto error =
+    check_operation(I2CControllerFunctionalityFlags::FUNC_SMBUS_BLOCK_PROC_CALL))
+  {
+    return make_i2c_precondition_error(error);
   }
 
-  if (!has_functionality(I2CControllerFunctionalityFlags::FUNC_SMBUS_BLOCK_PROC_CALL)) {
-    throw IllegalOperationException("Adapter does not support this operation!");
+  // SMBus blocks are limited to 32 bytes
+  if (size > I2C_SMBUS_BLOCK_MAX) {
+    return make_i2c_precondition_error(EMSGSIZE);
   }
 
-  const auto result = i2c_smbus_block_process_call(
-    i2c_file_desc, register_addr,
-    data.size(), data.data());
-  if (result < 0) {
-    throw SysException("Unable to execute request");
+  i2c_smbus_data block;
+  block.block[0] = static_cast<uint8_t>(size);
+  std::memcpy(block.block + 1, data, size);
+  if (const auto error =
+    smbus_access(I2C_SMBUS_WRITE, register_addr, I2C_SMBUS_BLOCK_PROC_CALL, &block))
+  {
+    return make_i2c_error(error);
   }
-  return static_cast<uint16_t>(result);
+
+  reply.length = block.block[0];
+  std::memcpy(reply.data.data(), block.block + 1, reply.length);
+  return reply.length;
 }
 
 std::vector<uint8_t> I2CHandlerImpl::read_block_data(const uint8_t register_addr) const
 {
-  // ensure we have a valid file descriptor
-  if (!is_opened()) {
-    throw IllegalOperationException("File descriptor is invalid");
-  }
+  I2CSMBusBlock block;
+  const auto length = read_block_data(register_addr, block);
+  return std::vector<uint8_t>(block.data.begin(), block.data.begin() + length);
+}
 
-  if (!has_functionality(I2CControllerFunctionalityFlags::FUNC_SMBUS_READ_BLOCK_DATA)) {
-    throw IllegalOperationException("Adapter does not support this operation!");
-  }
+uint8_t I2CHandlerImpl::read_block_data(const uint8_t register_addr, I2CSMBusBlock & block) const
+{
+  return try_read_block_data(register_addr, block).value("Unable to read block data");
+}
 
-  std::vector<uint8_t> data{I2C_SMBUS_BLOCK_MAX};
+I2CResult<uint8_t> I2CHandlerImpl::try_read_block_data(
+  const uint8_t register_addr,
+  I2CSMBusBlock & block) const
+{
+  if (const auto error =
+    check_operation(I2CControllerFunctionalityFlags::FUNC_SMBUS_READ_BLOCK_DATA))
+  {
+    return make_i2c_precondition_error(error);
+  }
 
-  const auto result = i2c_smbus_read_block_data(i2c_file_desc, register_addr, data.data());
-  if (result < 0) {
-    throw SysException("Unable to execute request");
+  i2c_smbus_data data;
+  if (const auto error =
+    smbus_access(I2C_SMBUS_READ, register_addr, I2C_SMBUS_BLOCK_DATA, &data))
+  {
+    return make_i2c_error(error);
   }
-  // resize vector and return it
-  data.resize(result);
-  return data;
+
+  // the first byte holds the block length
+  block.length = data.block[0];
+  std::memcpy(block.data.data(), data.block + 1, block.length);
+  return block.length;
 }
 
 void I2CHandlerImpl::write_block_data(
   const uint8_t register_addr,
   const std::vector<uint8_t> & data) const
 {
-  // ensure we have a valid file descriptor
-  if (!is_opened()) {
-    throw IllegalOperationException("File descriptor is invalid");
+  write_block_data(register_addr, data.data(), data.size());
+}
+
+void I2CHandlerImpl::write_block_data(
+  const uint8_t register_addr, const uint8_t * data,
+  const std::size_t size) const
+{
+  try_write_block_data(register_addr, data, size).value("Unable to write block data");
+}
+
+I2CResult<void> I2CHandlerImpl::try_write_block_data(
+  const uint8_t register_addr, const uint8_t * data,
+  const std::size_t size) const
+{
+  if (const auto error =
+    check_operation(I2CControllerFunctionalityFlags::FUNC_SMBUS_WRITE_BLOCK_DATA))
+  {
+    return make_i2c_precondition_error(error);
   }
 
-  if (!has_functionality(I2CControllerFunctionalityFlags::FUNC_SMBUS_WRITE_BLOCK_DATA)) {
-    throw IllegalOperationException("Adapter does not support this operation!");
+  // SMBus blocks are limited to 32 bytes
+  if (size > I2C_SMBUS_BLOCK_MAX) {
+    return make_i2c_precondition_error(EMSGSIZE);
   }
 
-  const auto result = i2c_smbus_write_block_data(
-    i2c_file_desc, register_addr,
-    data.size(), data.data());
-  if (result < 0) {
-    throw SysException("Unable to execute request");
+  i2c_smbus_data block;
+  block.block[0] = static_cast<uint8_t>(size);
+  std::memcpy(block.block + 1, data, size);
+  if (const auto error =
+    smbus_access(I2C_SMBUS_WRITE, register_addr, I2C_SMBUS_BLOCK_DATA, &block))
+  {
+    return make_i2c_error(error);
   }
+  return {};
 }
 
-void I2CHandlerImpl::set_ten_bit(bool enable) const
+void I2CHandlerImpl::read_i2c_block_data(
+  const uint8_t register_addr, uint8_t * data,
+  const std::size_t size) const
 {
-  // ensure we have a valid file descriptor
-  if (!is_opened()) {
-    throw IllegalOperationException("File descriptor is invalid");
+  try_read_i2c_block_data(register_addr, data, size).value("Unable to read I2C block data");
+}
+
+I2CResult<void> I2CHandlerImpl::try_read_i2c_block_data(
+  const uint8_t register_addr, uint8_t * data,
+  const std::size_t size) const
+{
+  if (const auto error =
+    check_operation(I2CControllerFunctionalityFlags::FUNC_SMBUS_READ_I2C_BLOCK))
+  {
+    return make_i2c_precondition_error(error);
   }
 
-  // check if the adapter supports 10-bit addressing
-  if (!has_functionality(I2CControllerFunctionalityFlags::FUNC_10BIT_ADDR)) {
-    throw IllegalOperationException("Adapter does not support 10-bit addressing");
+  // I2C blocks hold between 1 and 32 bytes
+  if (size == 0 || size > I2C_SMBUS_BLOCK_MAX) {
+    return make_i2c_precondition_error(EMSGSIZE);
   }
 
-  if (ioctl(i2c_file_desc, I2CIOControlCommands::TENBIT, enable ? 1 : 0) < 0) {
-    throw SysException("Error setting 10-bit addressing");
+  // the first byte holds the number of bytes to read
+  i2c_smbus_data block;
+  block.block[0] = static_cast<uint8_t>(size);
+  if (const auto error =
+    smbus_access(I2C_SMBUS_READ, register_addr, I2C_SMBUS_I2C_BLOCK_DATA, &block))
+  {
+    return make_i2c_error(error);
   }
+  std::memcpy(data, block.block + 1, size);
+  return {};
+}
+
+void I2CHandlerImpl::write_i2c_block_data(
+  const uint8_t register_addr, const uint8_t * data,
+  const std::size_t size) const
+{
+  try_write_i2c_block_data(register_addr, data, size).value("Unable to write I2C block data");
+}
+
+I2CResult<void> I2CHandlerImpl::try_write_i2c_block_data(
+  const uint8_t register_addr, const uint8_t * data,
+  const std::size_t size) const
+{
+  if (const auto error =
+    check_operation(I2CControllerFunctionalityFlags::FUNC_SMBUS_WRITE_I2C_BLOCK))
+  {
+    return make_i2c_precondition_error(error);
+  }
+
+  // I2C blocks hold between 1 and 32 bytes
+  if (size == 0 || size > I2C_SMBUS_BLOCK_MAX) {
+    return make_i2c_precondition_error(EMSGSIZE);
+  }
+
+  i2c_smbus_data block;
+  block.block[0] = static_cast<uint8_t>(size);
+  std::memcpy(block.block + 1, data, size);
+  if (const auto error =
+    smbus_access(I2C_SMBUS_WRITE, register_addr, I2C_SMBUS_I2C_BLOCK_DATA, &block))
+  {
+    return make_i2c_error(error);
+  }
+  return {};
+}
+
+I2CResult<void> I2CHandlerImpl::try_set_ten_bit(bool enable) const
+{
+  if (const auto error = check_operation(I2CControllerFunctionalityFlags::FUNC_10BIT_ADDR)) {
+    return make_i2c_precondition_error(error);
+  }
+
+  if (backend->set_ten_bit(enable) < 0) {
+    return make_i2c_error(errno);
+  }
+  return {};
 }
 
 void I2CHandlerImpl::set_pec(bool enable)
 {
     // ensure we have a valid file descriptor
   if (!is_opened()) {
-    throw IllegalOperationException("File descriptor is invalid");
+    ROS2_I2CCPP_THROW(IllegalOperationException("File descriptor is invalid"));
   }
 
   // check if the adapter supports PEC addressing
   if (!has_functionality(I2CControllerFunctionalityFlags::FUNC_SMBUS_PEC)) {
-    throw IllegalOperationException("Adapter does not support PEC");
+    ROS2_I2CCPP_THROW(IllegalOperationException("Adapter does not support PEC"));
+  }
+
+  if (backend->set_pec(enable) < 0) {
+    ROS2_I2CCPP_THROW(SysException("Error setting PEC"));
+  }
+  pec_enabled = enable;
+}
+
+void I2CHandlerImpl::set_addressing_mode(I2CAddressingMode mode)
+{
+  // ensure we have a valid file descriptor
+  if (!is_opened()) {
+    ROS2_I2CCPP_THROW(IllegalOperationException("File descriptor is invalid"));
+  }
+
+  if (mode == addressing_mode) {
+    return;
+  }
+
+  if (mode == I2CAddressingMode::ADDRESSING_PER_MESSAGE) {
+    if (!has_functionality(I2CControllerFunctionalityFlags::FUNC_I2C)) {
+      ROS2_I2CCPP_THROW(IllegalOperationException("Adapter does not support plain I2C messages"));
+    }
+    addressing_mode = mode;
+    return;
+  }
+
+  // the adapter may still point at an older device, select the current one again
+  addressing_mode = mode;
+  const auto i2c_addr = cached_i2c_addr;
+  cached_i2c_addr = INVALID_I2C_ADDR;
+  if (i2c_addr != INVALID_I2C_ADDR) {
+    set_i2c_device(i2c_addr);
+  }
+}
+
+void I2CHandlerImpl::set_adapter_limits(const I2CRetryPolicy & policy)
+{
+  try_set_adapter_limits(policy).value("Unable to set the adapter retries and timeout");
+}
+
+I2CResult<void> I2CHandlerImpl::try_set_adapter_limits(const I2CRetryPolicy & policy)
+{
+  if (!is_opened()) {
+    return make_i2c_precondition_error(EBADF);
+  }
+
+  if (policy.adapter_retries >= 0 && policy.adapter_retries != adapter_retries) {
+    if (backend->set_retries(static_cast<uint32_t>(policy.adapter_retries)) < 0) {
+      return make_i2c_error(errno);
+    }
+    adapter_retries = policy.adapter_retries;
+  }
+
+  const auto timeout_units = policy.get_adapter_timeout_units();
+  if (timeout_units > 0 && timeout_units != adapter_timeout_units) {
+    if (backend->set_timeout(timeout_units) < 0) {
+      return make_i2c_error(errno);
+    }
+    adapter_timeout_units = timeout_units;
+  }
+  return {};
+}
+
+int I2CHandlerImpl::smbus_access(
+  const uint8_t read_write, const uint8_t command, const uint32_t size,
+  i2c_smbus_data * data) const
+{
+  // every SMBus operation goes through here, size tells them apart (I2C_SMBUS_BYTE_DATA, ...)
+  ROS2_I2CCPP_TRACEPOINT(smbus_enter, this, cached_i2c_addr, read_write, command, size);
+  const auto error = dispatch_smbus_access(read_write, command, size, data) < 0 ? errno : 0;
+  ROS2_I2CCPP_TRACEPOINT(smbus_exit, this, error);
+  return error;
+}
+
+int32_t I2CHandlerImpl::dispatch_smbus_access(
+  const uint8_t read_write, const uint8_t command, const uint32_t size,
+  i2c_smbus_data * data) const
+{
+  if (addressing_mode == I2CAddressingMode::ADDRESSING_SLAVE_IOCTL) {
+    return backend->smbus_access(read_write, command, size, data);
+  }
+
+  if (cached_i2c_addr == INVALID_I2C_ADDR) {
+    errno = EDESTADDRREQ;
+    return -1;
+  }
+
+  // same encoding as the kernel SMBus emulation, sent in a single I2C_RDWR
+  SMBusTransfer smbus_transfer;
+  const uint16_t flags = cached_i2c_addr > I2CConstants::I2C_MAX_7BIT_ADDRESS ?
+    static_cast<uint16_t>(I2CMessageFlags::M_TEN) : 0;
+  if (smbus_transfer.encode(cached_i2c_addr, flags, read_write, command, size, data,
+    pec_enabled) < 0)
+  {
+    return -1;
   }
 
-  if (ioctl(i2c_file_desc, I2CIOControlCommands::PEC, enable ? 1 : 0) < 0) {
-    throw SysException("Error setting PEC");
+  if (backend->transfer(smbus_transfer.get_messages(), smbus_transfer.get_message_count()) < 0) {
+    return -1;
   }
+  return smbus_transfer.decode(data);
 }
 
 } // namespace ros2_i2ccpp;
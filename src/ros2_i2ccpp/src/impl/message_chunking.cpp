@@ -0,0 +1,45 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "ros2_i2ccpp/impl/message_chunking.hpp"
+#include "ros2_i2ccpp/constants.hpp"
+
+namespace ros2_i2ccpp
+{
+
+bool is_atomic_continuation(const i2c_msg & previous, const i2c_msg & message)
+{
+  if (message.flags & I2CMessageFlags::M_NOSTART) {
+    return true;
+  }
+
+  // a STOP was explicitly requested, so the next message is already independent
+  if (previous.flags & I2CMessageFlags::M_STOP) {
+    return false;
+  }
+
+  return !(previous.flags & I2CMessageFlags::M_RD) && (message.flags & I2CMessageFlags::M_RD) &&
+         previous.addr == message.addr;
+}
+
+uint32_t next_chunk_size(
+  const i2c_msg * messages, const uint32_t message_count,
+  const uint32_t max_messages)
+{
+  if (message_count <= max_messages) {
+    return message_count;
+  }
+
+  // find the last group boundary that fits
+  uint32_t chunk_size = 0;
+  for (uint32_t i = 1; i <= max_messages; i++) {
+    if (!is_atomic_continuation(messages[i - 1], messages[i])) {
+      chunk_size = i;
+    }
+  }
+  return chunk_size;
+}
+
+}  // namespace ros2_i2ccpp
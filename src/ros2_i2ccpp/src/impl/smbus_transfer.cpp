@@ -0,0 +1,237 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <cerrno>
+#include <cstring>
+
+#include "ros2_i2ccpp/impl/smbus_transfer.hpp"
+#include "ros2_i2ccpp/constants.hpp"
+
+namespace ros2_i2ccpp
+{
+
+uint8_t smbus_pec(uint8_t crc, const uint8_t * data, const uint32_t size)
+{
+  for (uint32_t i = 0; i < size; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x07) : static_cast<uint8_t>(crc << 1);
+    }
+  }
+  return crc;
+}
+
+uint8_t smbus_message_pec(uint8_t crc, const i2c_msg & message)
+{
+  const uint8_t address_byte =
+    static_cast<uint8_t>((message.addr << 1) | (message.flags & I2CMessageFlags::M_RD));
+  crc = smbus_pec(crc, &address_byte, 1);
+  return smbus_pec(crc, message.buf, message.len);
+}
+
+void SMBusTransfer::set_recv_len(i2c_msg & message)
+{
+  // i2c-dev wants buf[0] to hold the bytes read besides the block (the count byte), and the
+  // buffer to fit the largest block on top of them
+  message.flags |= I2CMessageFlags::M_RECV_LEN;
+  message.len = I2C_SMBUS_BLOCK_MAX + 1;
+  message.buf[0] = 1;
+}
+
+int SMBusTransfer::encode(
+  const uint16_t i2c_addr, const uint16_t flags, const uint8_t read_write_,
+  const uint8_t command, const uint32_t size_, const i2c_smbus_data * data, const bool pec)
+{
+  read_write = read_write_;
+  size = size_;
+
+  // a read is always a write of the command followed by a read, unless noted otherwise
+  message_count = read_write == I2C_SMBUS_READ ? 2 : 1;
+  messages[0] = i2c_msg{i2c_addr, flags, 1, write_buffer.data()};
+  messages[1] = i2c_msg{i2c_addr, static_cast<uint16_t>(flags | I2CMessageFlags::M_RD), 0,
+    read_buffer.data()};
+  write_buffer[0] = command;
+
+  const bool needs_data = size != I2C_SMBUS_QUICK && size != I2C_SMBUS_BYTE &&
+    !(read_write == I2C_SMBUS_READ &&
+    (size == I2C_SMBUS_BYTE_DATA || size == I2C_SMBUS_WORD_DATA || size == I2C_SMBUS_BLOCK_DATA));
+  if (needs_data && data == nullptr) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  switch (size) {
+    case I2C_SMBUS_QUICK:
+      messages[0].len = 0;
+      if (read_write == I2C_SMBUS_READ) {
+        messages[0].flags |= I2CMessageFlags::M_RD;
+      }
+      message_count = 1;
+      break;
+    case I2C_SMBUS_BYTE:
+      if (read_write == I2C_SMBUS_READ) {
+        // a single read of one byte, without sending a command
+        messages[0].flags = flags | I2CMessageFlags::M_RD;
+        messages[0].buf = read_buffer.data();
+        message_count = 1;
+      }
+      break;
+    case I2C_SMBUS_BYTE_DATA:
+      if (read_write == I2C_SMBUS_READ) {
+        messages[1].len = 1;
+      } else {
+        messages[0].len = 2;
+        write_buffer[1] = data->byte;
+      }
+      break;
+    case I2C_SMBUS_WORD_DATA:
+      if (read_write == I2C_SMBUS_READ) {
+        messages[1].len = 2;
+      } else {
+        messages[0].len = 3;
+        write_buffer[1] = data->word & 0xFF;
+        write_buffer[2] = data->word >> 8;
+      }
+      break;
+    case I2C_SMBUS_PROC_CALL:
+      // always a write followed by a read
+      read_write = I2C_SMBUS_READ;
+      message_count = 2;
+      messages[0].len = 3;
+      messages[1].len = 2;
+      write_buffer[1] = data->word & 0xFF;
+      write_buffer[2] = data->word >> 8;
+      break;
+    case I2C_SMBUS_BLOCK_DATA:
+      if (read_write == I2C_SMBUS_READ) {
+        // the first byte received is the block length, the adapter extends the message with it
+        set_recv_len(messages[1]);
+      } else {
+        const auto length = data->block[0];
+        if (length == 0 || length > I2C_SMBUS_BLOCK_MAX) {
+          errno = EINVAL;
+          return -1;
+        }
+        messages[0].len = length + 2;
+        std::memcpy(write_buffer.data() + 1, data->block, length + 1);
+      }
+      break;
+    case I2C_SMBUS_BLOCK_PROC_CALL: {
+        read_write = I2C_SMBUS_READ;
+        message_count = 2;
+        const auto length = data->block[0];
+        if (length == 0 || length > I2C_SMBUS_BLOCK_MAX) {
+          errno = EINVAL;
+          return -1;
+        }
+        messages[0].len = length + 2;
+        std::memcpy(write_buffer.data() + 1, data->block, length + 1);
+        set_recv_len(messages[1]);
+        break;
+      }
+    case I2C_SMBUS_I2C_BLOCK_DATA: {
+        const auto length = data->block[0];
+        if (length == 0 || length > I2C_SMBUS_BLOCK_MAX) {
+          errno = EINVAL;
+          return -1;
+        }
+        if (read_write == I2C_SMBUS_READ) {
+          messages[1].len = length;
+        } else {
+          messages[0].len = length + 1;
+          std::memcpy(write_buffer.data() + 1, data->block + 1, length);
+        }
+        break;
+      }
+    default:
+      errno = EOPNOTSUPP;
+      return -1;
+  }
+
+  // I2C block transfers and quick commands do not use PEC
+  use_pec = pec && size != I2C_SMBUS_QUICK && size != I2C_SMBUS_I2C_BLOCK_DATA;
+  if (use_pec) {
+    // compute the PEC if the first message is a write
+    if (!(messages[0].flags & I2CMessageFlags::M_RD)) {
+      if (message_count == 1) {
+        write_buffer[messages[0].len] = smbus_message_pec(0, messages[0]);
+        messages[0].len++;
+      } else {
+        partial_pec = smbus_message_pec(0, messages[0]);
+      }
+    }
+
+    // ask for the PEC if the last message is a read, M_RECV_LEN messages also count it in buf[0]
+    auto & last_message = messages[message_count - 1];
+    if (last_message.flags & I2CMessageFlags::M_RD) {
+      last_message.len++;
+      if (last_message.flags & I2CMessageFlags::M_RECV_LEN) {
+        last_message.buf[0]++;
+      }
+    }
+  }
+
+  return 0;
+}
+
+int SMBusTransfer::decode(i2c_smbus_data * data)
+{
+  const auto & last_message = messages[message_count - 1];
+  if (use_pec && (last_message.flags & I2CMessageFlags::M_RD)) {
+    // i2c-dev does not report the final length of M_RECV_LEN messages, take it from the count
+    auto received = last_message;
+    if (received.flags & I2CMessageFlags::M_RECV_LEN) {
+      if (received.buf[0] > I2C_SMBUS_BLOCK_MAX) {
+        errno = EPROTO;
+        return -1;
+      }
+      received.len = static_cast<uint16_t>(received.buf[0] + 1);
+    } else {
+      received.len--;
+    }
+
+    // the PEC byte follows the data
+    const auto received_pec = received.buf[received.len];
+    const auto initial_pec = (messages[0].flags & I2CMessageFlags::M_RD) ? 0 : partial_pec;
+    if (received_pec != smbus_message_pec(initial_pec, received)) {
+      errno = EBADMSG;
+      return -1;
+    }
+  }
+
+  if (read_write != I2C_SMBUS_READ || size == I2C_SMBUS_QUICK) {
+    return 0;
+  }
+
+  if (data == nullptr) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  switch (size) {
+    case I2C_SMBUS_BYTE:
+    case I2C_SMBUS_BYTE_DATA:
+      data->byte = read_buffer[0];
+      break;
+    case I2C_SMBUS_WORD_DATA:
+    case I2C_SMBUS_PROC_CALL:
+      data->word = static_cast<uint16_t>(read_buffer[0] | (read_buffer[1] << 8));
+      break;
+    case I2C_SMBUS_I2C_BLOCK_DATA:
+      std::memcpy(data->block + 1, read_buffer.data(), data->block[0]);
+      break;
+    case I2C_SMBUS_BLOCK_DATA:
+    case I2C_SMBUS_BLOCK_PROC_CALL:
+      if (read_buffer[0] > I2C_SMBUS_BLOCK_MAX) {
+        errno = EPROTO;
+        return -1;
+      }
+      std::memcpy(data->block, read_buffer.data(), read_buffer[0] + 1);
+      break;
+  }
+  return 0;
+}
+
+}  // namespace ros2_i2ccpp
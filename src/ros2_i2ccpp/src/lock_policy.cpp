@@ -0,0 +1,109 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+extern "C"
+{
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+}
+
+#include <cerrno>
+#include <thread>
+
+#include "ros2_i2ccpp/lock_policy.hpp"
+#include "ros2_i2ccpp/exceptions.hpp"
+
+namespace ros2_i2ccpp
+{
+
+using namespace exceptions;
+
+namespace
+{
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) &&
+  std::atomic<uint32_t>::is_always_lock_free, "the futex word must be a plain 32-bit integer");
+
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  asm volatile ("yield" ::: "memory");
+#endif
+}
+
+long futex(std::atomic<uint32_t> & word, int operation, uint32_t value)
+{
+  return ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), operation, value, nullptr,
+           nullptr, 0);
+}
+
+}  // namespace
+
+void spin_then_park_mutex::lock_contended()
+{
+  static const uint32_t spin_count = std::thread::hardware_concurrency() > 1 ? SPIN_COUNT : 0;
+  for (uint32_t i = 0; i < spin_count; i++) {
+    cpu_relax();
+    uint32_t expected = UNLOCKED;
+    if (state.load(std::memory_order_relaxed) == UNLOCKED &&
+      state.compare_exchange_weak(expected, LOCKED, std::memory_order_acquire,
+      std::memory_order_relaxed))
+    {
+      return;
+    }
+  }
+
+  // taken as CONTENDED, since there may be other sleepers the next unlock has to wake
+  while (state.exchange(CONTENDED, std::memory_order_acquire) != UNLOCKED) {
+    futex(state, FUTEX_WAIT_PRIVATE, CONTENDED);
+  }
+}
+
+void spin_then_park_mutex::wake()
+{
+  futex(state, FUTEX_WAKE_PRIVATE, 1);
+}
+
+priority_inheritance_mutex::priority_inheritance_mutex()
+{
+  pthread_mutexattr_t attributes;
+  pthread_mutexattr_init(&attributes);
+  auto error = pthread_mutexattr_setprotocol(&attributes, PTHREAD_PRIO_INHERIT);
+  if (error == 0) {
+    error = pthread_mutex_init(&mutex, &attributes);
+  }
+  pthread_mutexattr_destroy(&attributes);
+
+  if (error != 0) {
+    ROS2_I2CCPP_THROW(SysException("Unable to create a priority inheritance mutex", error));
+  }
+}
+
+priority_inheritance_mutex::~priority_inheritance_mutex()
+{
+  pthread_mutex_destroy(&mutex);
+}
+
+void priority_inheritance_mutex::lock()
+{
+  if (const auto error = pthread_mutex_lock(&mutex)) {
+    ROS2_I2CCPP_THROW(SysException("Unable to lock the mutex", error));
+  }
+}
+
+bool priority_inheritance_mutex::try_lock()
+{
+  return pthread_mutex_trylock(&mutex) == 0;
+}
+
+void priority_inheritance_mutex::unlock()
+{
+  pthread_mutex_unlock(&mutex);
+}
+
+}  // namespace ros2_i2ccpp
@@ -0,0 +1,226 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <algorithm>
+
+#include "ros2_i2ccpp/polling_engine.hpp"
+#include "ros2_i2ccpp/backend/i2c_backend.hpp"
+#include "ros2_i2ccpp/exceptions.hpp"
+
+namespace ros2_i2ccpp
+{
+
+using namespace exceptions;
+
+namespace
+{
+// every register takes an offset write and a read
+constexpr uint32_t MESSAGES_PER_POLL = 2;
+constexpr uint32_t POLLS_PER_TRANSFER =
+  I2CConstants::I2C_TRANSACTION_IOCTL_MAX_MSGS / MESSAGES_PER_POLL;
+}  // namespace
+
+I2CPollingEngine::I2CPollingEngine(std::string i2c_adapter_path)
+: handler(std::make_unique<ThreadUnsafeI2CHandler>(i2c_adapter_path)),
+  epoch(std::chrono::steady_clock::now()),
+  acquisition_thread(&I2CPollingEngine::run, this)
+{
+}
+
+I2CPollingEngine::I2CPollingEngine(
+  std::unique_ptr<I2CBackend> backend,
+  std::string i2c_adapter_path)
+: handler(std::make_unique<ThreadUnsafeI2CHandler>(std::move(backend), i2c_adapter_path)),
+  epoch(std::chrono::steady_clock::now()),
+  acquisition_thread(&I2CPollingEngine::run, this)
+{
+}
+
+I2CPollingEngine::~I2CPollingEngine()
+{
+  {
+    std::scoped_lock lock{changes_mutex};
+    stopping = true;
+  }
+  changes_made.notify_one();
+  acquisition_thread.join();
+}
+
+std::shared_ptr<I2CPolledRegister> I2CPollingEngine::add_register(
+  uint16_t device_address, uint16_t register_address,
+  std::size_t size, std::chrono::nanoseconds period,
+  I2CRegisterOffsetFormat offset_format)
+{
+  if (size == 0 || size > UINT16_MAX) {
+    ROS2_I2CCPP_THROW(IllegalOperationException("Invalid register size"));
+  }
+  if (period.count() <= 0) {
+    ROS2_I2CCPP_THROW(IllegalOperationException("Polling period must be positive"));
+  }
+
+  Poll poll;
+  poll.polled_register = std::make_shared<I2CPolledRegister>(device_address, register_address,
+      size);
+  poll.offset_size = static_cast<uint16_t>(encode_register_offset(offset_format,
+      register_address, poll.offset.data()));
+  poll.size = static_cast<uint16_t>(size);
+  poll.period = period;
+
+  // align on the next multiple of the period since the epoch
+  const auto now = std::chrono::steady_clock::now();
+  poll.next_due = epoch + ((now - epoch) / period + 1) * period;
+
+  auto polled_register = poll.polled_register;
+  {
+    std::scoped_lock lock{changes_mutex};
+    added_polls.push_back(std::move(poll));
+  }
+  changes_made.notify_one();
+  return polled_register;
+}
+
+void I2CPollingEngine::remove_register(const std::shared_ptr<I2CPolledRegister> & polled_register)
+{
+  {
+    std::scoped_lock lock{changes_mutex};
+    removed_registers.push_back(polled_register);
+  }
+  changes_made.notify_one();
+}
+
+void I2CPollingEngine::set_tick_tolerance(std::chrono::nanoseconds tolerance)
+{
+  std::scoped_lock lock{changes_mutex};
+  tick_tolerance = tolerance;
+}
+
+I2CPollingStatistics I2CPollingEngine::get_statistics() const
+{
+  I2CPollingStatistics statistics;
+  statistics.ticks = ticks.load(std::memory_order_relaxed);
+  statistics.transfers = transfers.load(std::memory_order_relaxed);
+  statistics.reads = reads.load(std::memory_order_relaxed);
+  statistics.errors = errors.load(std::memory_order_relaxed);
+  statistics.overruns = overruns.load(std::memory_order_relaxed);
+  return statistics;
+}
+
+void I2CPollingEngine::run()
+{
+  while (true) {
+    std::chrono::nanoseconds tolerance;
+    {
+      std::unique_lock lock{changes_mutex};
+      apply_changes();
+      if (stopping) {
+        return;
+      }
+      tolerance = tick_tolerance;
+
+      const auto has_changes = [this] {
+          return stopping || !added_polls.empty() || !removed_registers.empty();
+        };
+      if (polls.empty()) {
+        changes_made.wait(lock, has_changes);
+        continue;
+      }
+
+      const auto next_due = std::min_element(polls.begin(), polls.end(),
+          [](const Poll & a, const Poll & b) {return a.next_due < b.next_due;})->next_due;
+      if (next_due > std::chrono::steady_clock::now() + tolerance) {
+        changes_made.wait_until(lock, next_due, has_changes);
+        continue;
+      }
+    }
+
+    execute_tick(std::chrono::steady_clock::now() + tolerance);
+  }
+}
+
+void I2CPollingEngine::apply_changes()
+{
+  for (auto & poll : added_polls) {
+    polls.push_back(std::move(poll));
+  }
+  added_polls.clear();
+
+  for (const auto & polled_register : removed_registers) {
+    polls.erase(std::remove_if(polls.begin(), polls.end(), [&](const Poll & poll) {
+        return poll.polled_register == polled_register;
+      }), polls.end());
+  }
+  removed_registers.clear();
+
+  due_polls.reserve(polls.size());
+  messages.reserve(polls.size() * MESSAGES_PER_POLL);
+}
+
+void I2CPollingEngine::execute_tick(std::chrono::steady_clock::time_point horizon)
+{
+  ticks.fetch_add(1, std::memory_order_relaxed);
+  const auto now = std::chrono::steady_clock::now();
+
+  // pull in everything due on this tick
+  due_polls.clear();
+  messages.clear();
+  for (auto & poll : polls) {
+    if (poll.next_due > horizon) {
+      continue;
+    }
+
+    due_polls.push_back(&poll);
+    const auto address = poll.polled_register->get_device_address();
+    messages.push_back(i2c_msg{address, 0, poll.offset_size, poll.offset.data()});
+    messages.push_back(i2c_msg{address, I2CMessageFlags::M_RD, poll.size,
+        poll.polled_register->samples.get_write_buffer()});
+
+    // schedule the next read, skipping the periods that were missed
+    poll.next_due += poll.period;
+    if (poll.next_due <= now) {
+      const auto missed = (now - poll.next_due) / poll.period + 1;
+      overruns.fetch_add(static_cast<uint64_t>(missed), std::memory_order_relaxed);
+      poll.next_due += missed * poll.period;
+    }
+  }
+
+  // register reads never need to be split, so every transfer takes the same number of polls
+  const auto poll_count = static_cast<uint32_t>(due_polls.size());
+  for (uint32_t first = 0; first < poll_count; first += POLLS_PER_TRANSFER) {
+    transfer(due_polls.data() + first, messages.data() + first * MESSAGES_PER_POLL,
+      std::min(POLLS_PER_TRANSFER, poll_count - first));
+  }
+}
+
+void I2CPollingEngine::transfer(Poll ** batch, i2c_msg * batch_messages, uint32_t poll_count)
+{
+  transfers.fetch_add(1, std::memory_order_relaxed);
+  // failed polls are expected on a noisy bus, so they are not worth an exception
+  if (!handler->try_apply_messages(batch_messages, poll_count * MESSAGES_PER_POLL)) {
+    if (poll_count == 1) {
+      batch[0]->polled_register->errors.fetch_add(1, std::memory_order_relaxed);
+      errors.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    // find out which registers failed
+    for (uint32_t i = 0; i < poll_count; i++) {
+      transfer(batch + i, batch_messages + i * MESSAGES_PER_POLL, 1);
+    }
+    return;
+  }
+
+  const auto timestamp = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < poll_count; i++) {
+    publish(*batch[i], timestamp);
+  }
+}
+
+void I2CPollingEngine::publish(Poll & poll, std::chrono::steady_clock::time_point timestamp)
+{
+  poll.polled_register->samples.publish(timestamp);
+  reads.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace ros2_i2ccpp
@@ -0,0 +1,40 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include "ros2_i2ccpp/prepared_transaction.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace ros2_i2ccpp
+{
+
+I2CPreparedTransaction::I2CPreparedTransaction(
+  std::pmr::memory_resource & mr,
+  std::pmr::vector<std::shared_ptr<I2CTransactionSegment>> && segments,
+  bool allow_chunking_)
+: transaction_segments(std::move(segments)), messages(&mr), allow_chunking(allow_chunking_)
+{
+  // build the i2c message buffer once, the segment buffers are stable
+  messages.reserve(transaction_segments.size());
+  std::transform(
+    transaction_segments.begin(), transaction_segments.end(), std::back_inserter(messages),
+    [](const std::shared_ptr<I2CTransactionSegment> & segment) {
+      return i2c_msg{segment->get_address(), segment->get_message_flags(),
+        segment->get_data_size(), segment->get_data()};
+    });
+}
+
+void I2CPreparedTransaction::rearm(const uint32_t first_message)
+{
+  rearm_segments(transaction_segments, first_message);
+}
+
+int I2CPreparedTransaction::complete()
+{
+  return commit_segments(transaction_segments);
+}
+
+}  // namespace ros2_i2ccpp
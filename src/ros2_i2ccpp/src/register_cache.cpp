@@ -0,0 +1,203 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <string>
+
+#include "ros2_i2ccpp/register_cache.hpp"
+#include "ros2_i2ccpp/exceptions.hpp"
+
+namespace ros2_i2ccpp
+{
+
+using namespace exceptions;
+
+I2CRegisterCache::I2CRegisterCache(
+  uint16_t device_address_, std::size_t register_count,
+  I2CRegisterOffsetFormat offset_format_)
+: device_address(device_address_), offset_format(offset_format_)
+{
+  const std::size_t max_register_count =
+    offset_format == I2CRegisterOffsetFormat::OFFSET_8BIT ? UINT8_MAX + 1 : UINT16_MAX + 1;
+  if (register_count == 0 || register_count > max_register_count) {
+    ROS2_I2CCPP_THROW(IllegalOperationException("Register count must be between 1 and " +
+            std::to_string(max_register_count) + " for this offset format"));
+  }
+
+  values.resize(register_count, 0);
+  states.resize(register_count, 0);
+}
+
+void I2CRegisterCache::check_register(uint16_t register_address) const
+{
+  if (register_address >= values.size()) {
+    ROS2_I2CCPP_THROW(IllegalOperationException("Register is outside of the cache"));
+  }
+}
+
+void I2CRegisterCache::set_volatile(uint16_t register_address, bool is_volatile)
+{
+  set_volatile(register_address, register_address, is_volatile);
+}
+
+void I2CRegisterCache::set_volatile(uint16_t first, uint16_t last, bool is_volatile)
+{
+  check_register(first);
+  check_register(last);
+  for (uint32_t i = first; i <= last; i++) {
+    if (is_volatile) {
+      states[i] = static_cast<uint8_t>((states[i] & ~KNOWN) | VOLATILE);
+    } else {
+      states[i] &= static_cast<uint8_t>(~VOLATILE);
+    }
+  }
+}
+
+bool I2CRegisterCache::is_volatile(uint16_t register_address) const
+{
+  check_register(register_address);
+  return (states[register_address] & VOLATILE) != 0;
+}
+
+void I2CRegisterCache::set_known_value(uint16_t register_address, uint8_t value)
+{
+  check_register(register_address);
+  if ((states[register_address] & DIRTY) != 0) {
+    ROS2_I2CCPP_THROW(IllegalOperationException("Register has a staged write"));
+  }
+  store(register_address, value);
+}
+
+void I2CRegisterCache::invalidate(uint16_t register_address)
+{
+  check_register(register_address);
+  states[register_address] &= static_cast<uint8_t>(~KNOWN);
+}
+
+void I2CRegisterCache::invalidate()
+{
+  for (auto & state : states) {
+    state &= static_cast<uint8_t>(~KNOWN);
+  }
+}
+
+bool I2CRegisterCache::get_cached_value(uint16_t register_address, uint8_t & value) const
+{
+  check_register(register_address);
+  // a staged value has not reached the device yet, so it does not count
+  if ((states[register_address] & (KNOWN | DIRTY)) != KNOWN) {
+    return false;
+  }
+  value = values[register_address];
+  return true;
+}
+
+void I2CRegisterCache::store(uint16_t register_address, uint8_t value)
+{
+  values[register_address] = value;
+  if ((states[register_address] & VOLATILE) == 0) {
+    states[register_address] |= KNOWN;
+  }
+}
+
+bool I2CRegisterCache::is_write_elided(uint16_t register_address, uint8_t value)
+{
+  check_register(register_address);
+  auto & state = states[register_address];
+
+  // a staged value is superseded either way, and the device value was forgotten when staging
+  if ((state & DIRTY) != 0) {
+    state &= static_cast<uint8_t>(~DIRTY);
+    dirty_count--;
+  }
+
+  if ((state & KNOWN) != 0 && values[register_address] == value) {
+    statistics.elided_writes++;
+    return true;
+  }
+  return false;
+}
+
+void I2CRegisterCache::stage(uint16_t register_address, uint8_t value)
+{
+  check_register(register_address);
+  auto & state = states[register_address];
+
+  if ((state & DIRTY) != 0) {
+    values[register_address] = value;
+    return;
+  }
+  if ((state & KNOWN) != 0 && values[register_address] == value) {
+    statistics.elided_writes++;
+    return;
+  }
+
+  // the staged value replaces the cached one until it is flushed
+  values[register_address] = value;
+  state = static_cast<uint8_t>((state & ~KNOWN) | DIRTY);
+  dirty_count++;
+}
+
+void I2CRegisterCache::discard()
+{
+  for (auto & state : states) {
+    if ((state & DIRTY) != 0) {
+      state &= static_cast<uint8_t>(~(DIRTY | KNOWN));
+    }
+  }
+  dirty_count = 0;
+}
+
+void I2CRegisterCache::prepare_flush()
+{
+  const auto offset_size = register_offset_size(offset_format);
+
+  // every dirty register may need its own offset, and the buffer must not move once the
+  // messages point into it
+  flush_buffer.clear();
+  flush_buffer.reserve(dirty_count * (offset_size + 1));
+  flush_messages.clear();
+  const auto register_count = static_cast<uint32_t>(values.size());
+  for (uint32_t first = 0; first < register_count; first++) {
+    if ((states[first] & DIRTY) == 0) {
+      continue;
+    }
+
+    uint32_t last = first;
+    while (auto_increment && last + 1 < register_count && (states[last + 1] & DIRTY) != 0 &&
+      last + 1 - first + offset_size < UINT16_MAX)
+    {
+      last++;
+    }
+
+    const auto start = flush_buffer.size();
+    flush_buffer.resize(start + offset_size);
+    encode_register_offset(offset_format, static_cast<uint16_t>(first), &flush_buffer[start]);
+    flush_buffer.insert(flush_buffer.end(), values.begin() + first, values.begin() + last + 1);
+
+    flush_messages.push_back(i2c_msg{device_address, 0,
+        static_cast<uint16_t>(flush_buffer.size() - start), flush_buffer.data() + start});
+    first = last;
+  }
+}
+
+std::size_t I2CRegisterCache::complete_flush()
+{
+  const auto written = dirty_count;
+  for (auto & state : states) {
+    if ((state & DIRTY) != 0) {
+      state &= static_cast<uint8_t>(~DIRTY);
+      if ((state & VOLATILE) == 0) {
+        state |= KNOWN;
+      }
+    }
+  }
+  dirty_count = 0;
+
+  statistics.writes += written;
+  statistics.flushes++;
+  return written;
+}
+
+}  // namespace ros2_i2ccpp
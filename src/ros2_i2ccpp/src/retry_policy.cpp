@@ -0,0 +1,73 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <cerrno>
+
+#include "ros2_i2ccpp/retry_policy.hpp"
+
+namespace ros2_i2ccpp
+{
+
+using namespace std::chrono_literals;
+
+bool I2CRetryPolicy::is_retryable(const int error)
+{
+  switch (error) {
+    case ENXIO:
+    case EREMOTEIO:
+    case EAGAIN:
+    case ETIMEDOUT:
+    case EIO:
+    case EPROTO:
+    case EBADMSG:
+      return true;
+    default:
+      return false;
+  }
+}
+
+I2CRetryPolicy I2CRetryPolicy::for_priority(const I2CPriorityClass priority)
+{
+  I2CRetryPolicy policy;
+  switch (priority) {
+    case I2CPriorityClass::PRIORITY_REALTIME:
+      // a late sample is worth less than the next one, so fail fast and let the loop move on
+      policy.adapter_retries = 0;
+      policy.adapter_timeout = 10ms;
+      policy.max_attempts = 2;
+      policy.initial_backoff = 50us;
+      policy.max_backoff = 50us;
+      policy.retry_budget = 500us;
+      break;
+    case I2CPriorityClass::PRIORITY_HIGH:
+      policy.adapter_retries = 0;
+      policy.adapter_timeout = 20ms;
+      policy.max_attempts = 3;
+      policy.initial_backoff = 100us;
+      policy.max_backoff = 500us;
+      policy.retry_budget = 2ms;
+      break;
+    case I2CPriorityClass::PRIORITY_NORMAL:
+      policy.adapter_retries = 1;
+      policy.adapter_timeout = 50ms;
+      policy.max_attempts = 3;
+      policy.initial_backoff = 200us;
+      policy.max_backoff = 2ms;
+      policy.retry_budget = 5ms;
+      break;
+    default:
+      // bulk transfers have time, but their backoff delays everything queued behind them
+      policy.adapter_retries = 2;
+      policy.adapter_timeout = 100ms;
+      policy.max_attempts = 5;
+      policy.initial_backoff = 500us;
+      policy.max_backoff = 4ms;
+      policy.retry_budget = 10ms;
+      break;
+  }
+  return policy;
+}
+
+}  // namespace ros2_i2ccpp
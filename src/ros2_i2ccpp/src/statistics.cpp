@@ -0,0 +1,259 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "ros2_i2ccpp/constants.hpp"
+#include "ros2_i2ccpp/statistics.hpp"
+
+namespace ros2_i2ccpp
+{
+
+namespace
+{
+
+std::atomic<uint64_t> next_recorder_id{1};
+
+// single writer, so plain read-modify-write is enough
+inline void add(std::atomic<uint64_t> & counter, uint64_t value)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+inline uint64_t get(const std::atomic<uint64_t> & counter)
+{
+  return counter.load(std::memory_order_relaxed);
+}
+
+uint64_t to_nanoseconds(std::chrono::nanoseconds value)
+{
+  return value.count() > 0 ? static_cast<uint64_t>(value.count()) : 0;
+}
+
+}  // namespace
+
+std::size_t I2CLatencyHistogram::get_bucket(const uint64_t value)
+{
+  if (value < SUB_BUCKET_COUNT) {
+    return static_cast<std::size_t>(value);
+  }
+
+  // index of the highest bit, the next SUB_BUCKET_BITS bits select the sub-bucket
+  const auto exponent = static_cast<uint32_t>(63 - __builtin_clzll(value));
+  if (exponent >= MAX_EXPONENT) {
+    return BUCKET_COUNT - 1;
+  }
+  const auto shift = exponent - SUB_BUCKET_BITS;
+  const auto sub_bucket = (value >> shift) - SUB_BUCKET_COUNT;
+  return SUB_BUCKET_COUNT + shift * SUB_BUCKET_COUNT + static_cast<std::size_t>(sub_bucket);
+}
+
+uint64_t I2CLatencyHistogram::get_bucket_start(const std::size_t bucket)
+{
+  if (bucket < SUB_BUCKET_COUNT) {
+    return bucket;
+  }
+  const auto shift = (bucket - SUB_BUCKET_COUNT) / SUB_BUCKET_COUNT;
+  const auto sub_bucket = (bucket - SUB_BUCKET_COUNT) % SUB_BUCKET_COUNT;
+  return (SUB_BUCKET_COUNT + sub_bucket) << shift;
+}
+
+void I2CLatencyHistogram::record(const std::chrono::nanoseconds value)
+{
+  const auto ns = to_nanoseconds(value);
+  buckets[get_bucket(ns)]++;
+  count++;
+  sum += ns;
+  min = std::min(min, ns);
+  max = std::max(max, ns);
+}
+
+void I2CLatencyHistogram::merge(const I2CLatencyHistogram & other)
+{
+  for (std::size_t i = 0; i < BUCKET_COUNT; i++) {
+    buckets[i] += other.buckets[i];
+  }
+  count += other.count;
+  sum += other.sum;
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+}
+
+std::chrono::nanoseconds I2CLatencyHistogram::get_min() const
+{
+  return std::chrono::nanoseconds{count > 0 ? min : 0};
+}
+
+std::chrono::nanoseconds I2CLatencyHistogram::get_mean() const
+{
+  return std::chrono::nanoseconds{count > 0 ? sum / count : 0};
+}
+
+std::chrono::nanoseconds I2CLatencyHistogram::get_percentile(const double percentile) const
+{
+  if (count == 0) {
+    return std::chrono::nanoseconds{0};
+  }
+
+  const auto rank = std::max<uint64_t>(1,
+      static_cast<uint64_t>(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 *
+      static_cast<double>(count))));
+  uint64_t seen = 0;
+  for (std::size_t i = 0; i < BUCKET_COUNT; i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      // the middle of the bucket, but never past the largest sample
+      const auto start = get_bucket_start(i);
+      const auto end = i + 1 < BUCKET_COUNT ? get_bucket_start(i + 1) : max + 1;
+      return std::chrono::nanoseconds{std::clamp(start + (end - start) / 2, min, max)};
+    }
+  }
+  return get_max();
+}
+
+void I2CStatisticsRecorder::Histogram::record(const uint64_t value)
+{
+  add(buckets[I2CLatencyHistogram::get_bucket(value)], 1);
+  add(count, 1);
+  add(sum, value);
+  if (value < get(min)) {
+    min.store(value, std::memory_order_relaxed);
+  }
+  if (value > get(max)) {
+    max.store(value, std::memory_order_relaxed);
+  }
+}
+
+void I2CStatisticsRecorder::Histogram::read(I2CLatencyHistogram & histogram) const
+{
+  // the shard keeps recording meanwhile, so the fields may be a few samples apart
+  I2CLatencyHistogram shard;
+  for (std::size_t i = 0; i < I2CLatencyHistogram::BUCKET_COUNT; i++) {
+    shard.buckets[i] = get(buckets[i]);
+  }
+  shard.count = get(count);
+  shard.sum = get(sum);
+  shard.min = get(min);
+  shard.max = get(max);
+  histogram.merge(shard);
+}
+
+I2CStatisticsRecorder::I2CStatisticsRecorder()
+: id(next_recorder_id.fetch_add(1, std::memory_order_relaxed))
+{
+}
+
+I2CStatisticsRecorder::~I2CStatisticsRecorder() = default;
+
+I2CStatisticsRecorder::Shard & I2CStatisticsRecorder::get_shard()
+{
+  // threads rarely use more than a few handlers, so a linear search beats hashing
+  thread_local std::vector<std::pair<uint64_t, Shard *>> thread_shards;
+  for (const auto & [recorder_id, shard] : thread_shards) {
+    if (recorder_id == id) {
+      return *shard;
+    }
+  }
+
+  std::scoped_lock lock{shards_mutex};
+  shards.push_back(std::make_unique<Shard>());
+  thread_shards.emplace_back(id, shards.back().get());
+  return *shards.back();
+}
+
+void I2CStatisticsRecorder::record_lock_wait(const std::chrono::nanoseconds wait_time)
+{
+  get_shard().lock_wait_time.record(to_nanoseconds(wait_time));
+}
+
+void I2CStatisticsRecorder::record_lock_hold(const std::chrono::nanoseconds hold_time)
+{
+  get_shard().lock_hold_time.record(to_nanoseconds(hold_time));
+}
+
+void I2CStatisticsRecorder::record_transfer(
+  const i2c_msg * messages, const uint32_t message_count,
+  const std::chrono::nanoseconds transfer_time, const int error)
+{
+  auto & shard = get_shard();
+  const auto ns = to_nanoseconds(transfer_time);
+
+  uint64_t bytes_written = 0;
+  uint64_t bytes_read = 0;
+  for (uint32_t i = 0; i < message_count; i++) {
+    auto & bytes = (messages[i].flags & I2CMessageFlags::M_RD) ? bytes_read : bytes_written;
+    bytes += messages[i].len;
+  }
+
+  add(shard.transactions, 1);
+  add(shard.messages, message_count);
+  add(shard.bytes_written, bytes_written);
+  add(shard.bytes_read, bytes_read);
+  if (error != 0) {
+    add(shard.errors[std::min<std::size_t>(static_cast<std::size_t>(error), ERRNO_COUNT)], 1);
+  }
+  shard.transfer_time.record(ns);
+
+  if (message_count == 0) {
+    return;
+  }
+
+  // only this thread creates the devices of its shard, the release pairs with get_statistics
+  auto & slot = shard.devices[messages[0].addr % shard.devices.size()];
+  auto * device = slot.load(std::memory_order_relaxed);
+  if (device == nullptr) {
+    shard.device_storage.push_back(std::make_unique<DeviceShard>());
+    device = shard.device_storage.back().get();
+    slot.store(device, std::memory_order_release);
+  }
+  add(device->transactions, 1);
+  add(device->messages, message_count);
+  add(device->bytes_written, bytes_written);
+  add(device->bytes_read, bytes_read);
+  if (error != 0) {
+    add(device->errors, 1);
+  }
+  device->transfer_time.record(ns);
+}
+
+I2CHandlerStatistics I2CStatisticsRecorder::get_statistics() const
+{
+  I2CHandlerStatistics statistics;
+
+  std::scoped_lock lock{shards_mutex};
+  for (const auto & shard : shards) {
+    statistics.transactions += get(shard->transactions);
+    statistics.messages += get(shard->messages);
+    statistics.bytes_written += get(shard->bytes_written);
+    statistics.bytes_read += get(shard->bytes_read);
+    for (std::size_t error = 1; error < shard->errors.size(); error++) {
+      if (const auto errors = get(shard->errors[error])) {
+        statistics.errors[static_cast<int>(error)] += errors;
+      }
+    }
+    shard->lock_wait_time.read(statistics.lock_wait_time);
+    shard->lock_hold_time.read(statistics.lock_hold_time);
+    shard->transfer_time.read(statistics.transfer_time);
+
+    for (std::size_t address = 0; address < shard->devices.size(); address++) {
+      const auto * device = shard->devices[address].load(std::memory_order_acquire);
+      if (device == nullptr) {
+        continue;
+      }
+      auto & device_statistics = statistics.devices[static_cast<uint16_t>(address)];
+      device_statistics.transactions += get(device->transactions);
+      device_statistics.messages += get(device->messages);
+      device_statistics.bytes_written += get(device->bytes_written);
+      device_statistics.bytes_read += get(device->bytes_read);
+      device_statistics.errors += get(device->errors);
+      device->transfer_time.read(device_statistics.transfer_time);
+    }
+  }
+  return statistics;
+}
+
+}  // namespace ros2_i2ccpp
@@ -0,0 +1,471 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+extern "C"
+{
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include "ros2_i2ccpp/traffic_log.hpp"
+#include "ros2_i2ccpp/backend/i2c_backend.hpp"
+#include "ros2_i2ccpp/constants.hpp"
+#include "ros2_i2ccpp/exceptions.hpp"
+
+namespace ros2_i2ccpp
+{
+
+using namespace exceptions;
+
+namespace
+{
+
+constexpr std::size_t RECORD_ALIGNMENT = 8;
+
+constexpr std::size_t SMBUS_BODY_SIZE = sizeof(I2CTrafficSMBusCall) + 2 * sizeof(i2c_smbus_data);
+
+std::size_t align_record(std::size_t size)
+{
+  return (size + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+}
+
+int64_t get_clock_ns(clockid_t clock)
+{
+  timespec time{};
+  ::clock_gettime(clock, &time);
+  return static_cast<int64_t>(time.tv_sec) * 1'000'000'000 + time.tv_nsec;
+}
+
+}  // namespace
+
+I2CTrafficRecorder::I2CTrafficRecorder(const std::string & path, std::size_t buffer_size)
+: file_desc(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)),
+  staging(std::max(buffer_size, sizeof(I2CTrafficLogHeader)))
+{
+  if (file_desc < 0) {
+    ROS2_I2CCPP_THROW(SysException("Unable to open " + path));
+  }
+
+  // steady_clock is CLOCK_MONOTONIC on Linux, which the record timestamps use
+  I2CTrafficLogHeader header{};
+  std::memcpy(header.magic, I2CTrafficLogHeader::MAGIC, sizeof(header.magic));
+  header.version = I2CTrafficLogHeader::VERSION;
+  header.header_size = sizeof(I2CTrafficLogHeader);
+  header.byte_order = I2CTrafficLogHeader::BYTE_ORDER_MARK;
+  header.monotonic_start_ns = get_clock_ns(CLOCK_MONOTONIC);
+  header.realtime_start_ns = get_clock_ns(CLOCK_REALTIME);
+  std::memcpy(staging.data(), &header, sizeof(header));
+  staged = sizeof(header);
+}
+
+I2CTrafficRecorder::~I2CTrafficRecorder()
+{
+  if (file_desc >= 0) {
+    write_staged();
+    ::close(file_desc);
+  }
+}
+
+void I2CTrafficRecorder::flush()
+{
+  std::scoped_lock lock{mut};
+  write_staged();
+}
+
+void I2CTrafficRecorder::write_staged()
+{
+  std::size_t written = 0;
+  while (written < staged) {
+    const auto result = ::write(file_desc, staging.data() + written, staged - written);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // recording must never break the traffic it records, so the records are dropped
+      break;
+    }
+    written += static_cast<std::size_t>(result);
+  }
+  staged = 0;
+}
+
+uint8_t * I2CTrafficRecorder::append(
+  uint16_t type, uint16_t adapter, std::chrono::steady_clock::time_point start,
+  std::chrono::nanoseconds duration, int result, uint32_t count, std::size_t body_size)
+{
+  const auto size = align_record(sizeof(I2CTrafficRecord) + body_size);
+  if (staged + size > staging.size()) {
+    write_staged();
+  }
+  if (size > staging.size()) {
+    // only a transfer with huge messages gets here, grow rather than drop it
+    staging.resize(size);
+  }
+
+  auto * record = staging.data() + staged;
+  I2CTrafficRecord header{};
+  header.size = static_cast<uint32_t>(size);
+  header.type = type;
+  header.adapter = adapter;
+  header.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    start.time_since_epoch()).count();
+  header.duration_ns = duration.count();
+  header.result = result;
+  header.count = count;
+  std::memcpy(record, &header, sizeof(header));
+
+  // zero the padding, so the log does not leak old staging contents
+  std::memset(record + sizeof(header) + body_size, 0, size - sizeof(header) - body_size);
+  staged += size;
+  return record + sizeof(header);
+}
+
+uint16_t I2CTrafficRecorder::add_adapter(const std::string & i2c_adapter_path)
+{
+  std::scoped_lock lock{mut};
+  auto * body = append(I2CTrafficRecordType::RECORD_ADAPTER, adapter_count,
+      std::chrono::steady_clock::now(), std::chrono::nanoseconds{0}, 0,
+      static_cast<uint32_t>(i2c_adapter_path.size()), i2c_adapter_path.size());
+  std::memcpy(body, i2c_adapter_path.data(), i2c_adapter_path.size());
+  return adapter_count++;
+}
+
+void I2CTrafficRecorder::record_transfer(
+  uint16_t adapter, std::chrono::steady_clock::time_point start,
+  std::chrono::nanoseconds duration, int result, const i2c_msg * messages,
+  uint32_t message_count)
+{
+  std::size_t payload_size = 0;
+  for (uint32_t i = 0; i < message_count; i++) {
+    payload_size += messages[i].len;
+  }
+
+  std::scoped_lock lock{mut};
+  auto * body = append(I2CTrafficRecordType::RECORD_TRANSFER, adapter, start, duration, result,
+      message_count, message_count * sizeof(I2CTrafficMessage) + payload_size);
+
+  auto * payload = body + message_count * sizeof(I2CTrafficMessage);
+  for (uint32_t i = 0; i < message_count; i++) {
+    const I2CTrafficMessage message{messages[i].addr, messages[i].flags, messages[i].len, 0};
+    std::memcpy(body + i * sizeof(I2CTrafficMessage), &message, sizeof(message));
+    if (messages[i].len > 0) {
+      std::memcpy(payload, messages[i].buf, messages[i].len);
+      payload += messages[i].len;
+    }
+  }
+}
+
+void I2CTrafficRecorder::record_smbus(
+  uint16_t adapter, std::chrono::steady_clock::time_point start,
+  std::chrono::nanoseconds duration, int result, const I2CTrafficSMBusCall & call,
+  const i2c_smbus_data & data_before, const i2c_smbus_data & data_after)
+{
+  std::scoped_lock lock{mut};
+  auto * body = append(I2CTrafficRecordType::RECORD_SMBUS, adapter, start, duration, result, 1,
+      SMBUS_BODY_SIZE);
+  std::memcpy(body, &call, sizeof(call));
+  std::memcpy(body + sizeof(call), &data_before, sizeof(data_before));
+  std::memcpy(body + sizeof(call) + sizeof(data_before), &data_after, sizeof(data_after));
+}
+
+void I2CTrafficRecorder::record_control(
+  uint16_t adapter, std::chrono::steady_clock::time_point start,
+  std::chrono::nanoseconds duration, int result, uint64_t command, uint64_t value)
+{
+  std::scoped_lock lock{mut};
+  const I2CTrafficControl control{command, value};
+  auto * body = append(I2CTrafficRecordType::RECORD_CONTROL, adapter, start, duration, result, 1,
+      sizeof(control));
+  std::memcpy(body, &control, sizeof(control));
+}
+
+const I2CTrafficMessage * I2CTrafficEntry::get_messages() const
+{
+  return reinterpret_cast<const I2CTrafficMessage *>(body);
+}
+
+const uint8_t * I2CTrafficEntry::get_payloads() const
+{
+  return body + record->count * sizeof(I2CTrafficMessage);
+}
+
+const I2CTrafficSMBusCall & I2CTrafficEntry::get_smbus_call() const
+{
+  return *reinterpret_cast<const I2CTrafficSMBusCall *>(body);
+}
+
+const i2c_smbus_data & I2CTrafficEntry::get_smbus_data_before() const
+{
+  return *reinterpret_cast<const i2c_smbus_data *>(body + sizeof(I2CTrafficSMBusCall));
+}
+
+const i2c_smbus_data & I2CTrafficEntry::get_smbus_data_after() const
+{
+  return *reinterpret_cast<const i2c_smbus_data *>(
+    body + sizeof(I2CTrafficSMBusCall) + sizeof(i2c_smbus_data));
+}
+
+const I2CTrafficControl & I2CTrafficEntry::get_control() const
+{
+  return *reinterpret_cast<const I2CTrafficControl *>(body);
+}
+
+std::string I2CTrafficEntry::get_adapter_path() const
+{
+  return std::string(reinterpret_cast<const char *>(body), record->count);
+}
+
+I2CTrafficLog::I2CTrafficLog(const std::string & path)
+{
+  const auto file_desc = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (file_desc < 0) {
+    ROS2_I2CCPP_THROW(SysException("Unable to open " + path));
+  }
+
+  struct stat file_stat {};
+  if (::fstat(file_desc, &file_stat) < 0) {
+    const auto error = errno;
+    ::close(file_desc);
+    ROS2_I2CCPP_THROW(SysException("Unable to query the size of " + path, error));
+  }
+  size = static_cast<std::size_t>(file_stat.st_size);
+  if (size < sizeof(I2CTrafficLogHeader)) {
+    ::close(file_desc);
+    ROS2_I2CCPP_THROW(IllegalOperationException(path + " is not a traffic log"));
+  }
+
+  auto * mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, file_desc, 0);
+  const auto error = errno;
+  ::close(file_desc);
+  if (mapping == MAP_FAILED) {
+    ROS2_I2CCPP_THROW(SysException("Unable to map " + path, error));
+  }
+  data = static_cast<const uint8_t *>(mapping);
+  ::madvise(mapping, size, MADV_SEQUENTIAL);
+
+  const auto & header = get_header();
+  if (std::memcmp(header.magic, I2CTrafficLogHeader::MAGIC, sizeof(header.magic)) != 0) {
+    ::munmap(mapping, size);
+    ROS2_I2CCPP_THROW(IllegalOperationException(path + " is not a traffic log"));
+  }
+  // the records are read in place, so a log of the other byte order cannot be walked at all
+  if (header.byte_order != I2CTrafficLogHeader::BYTE_ORDER_MARK) {
+    ::munmap(mapping, size);
+    ROS2_I2CCPP_THROW(IllegalOperationException(
+        path + " was written on a machine of another byte order"));
+  }
+  if (header.version != I2CTrafficLogHeader::VERSION ||
+    header.header_size < sizeof(I2CTrafficLogHeader) || header.header_size > size)
+  {
+    ::munmap(mapping, size);
+    ROS2_I2CCPP_THROW(IllegalOperationException(path + " is not a traffic log of this version"));
+  }
+}
+
+I2CTrafficLog::~I2CTrafficLog()
+{
+  if (data != nullptr) {
+    ::munmap(const_cast<uint8_t *>(data), size);
+  }
+}
+
+const I2CTrafficLogHeader & I2CTrafficLog::get_header() const
+{
+  return *reinterpret_cast<const I2CTrafficLogHeader *>(data);
+}
+
+bool I2CTrafficLog::next(I2CTrafficEntry & entry) const
+{
+  const auto offset = entry.record == nullptr ?
+    static_cast<std::size_t>(get_header().header_size) :
+    static_cast<std::size_t>(reinterpret_cast<const uint8_t *>(entry.record) - data) +
+    entry.record->size;
+  if (offset + sizeof(I2CTrafficRecord) > size) {
+    return false;
+  }
+
+  const auto * record = reinterpret_cast<const I2CTrafficRecord *>(data + offset);
+  if (record->size < sizeof(I2CTrafficRecord) || offset + record->size > size) {
+    return false;
+  }
+  entry.record = record;
+  entry.body = data + offset + sizeof(I2CTrafficRecord);
+  return true;
+}
+
+std::vector<std::string> I2CTrafficLog::get_adapters() const
+{
+  std::vector<std::string> adapters;
+  I2CTrafficEntry entry;
+  while (next(entry)) {
+    if (entry.get_type() == I2CTrafficRecordType::RECORD_ADAPTER) {
+      adapters.push_back(entry.get_adapter_path());
+    }
+  }
+  return adapters;
+}
+
+I2CTrafficReplayer::I2CTrafficReplayer(const I2CTrafficLog & log_, I2CBackend & backend_)
+: log(log_), backend(backend_)
+{
+}
+
+I2CTrafficReplayResult I2CTrafficReplayer::replay(const I2CTrafficReplayOptions & options)
+{
+  I2CTrafficReplayResult result;
+  const auto replay_start = std::chrono::steady_clock::now();
+  int64_t first_timestamp_ns = -1;
+
+  I2CTrafficEntry entry;
+  while (log.next(entry)) {
+    const auto type = entry.get_type();
+    if (type == I2CTrafficRecordType::RECORD_ADAPTER ||
+      (options.adapter >= 0 && entry.record->adapter != options.adapter))
+    {
+      continue;
+    }
+
+    // keep the original spacing between records, scaled by the speed
+    auto now = std::chrono::steady_clock::now();
+    if (first_timestamp_ns < 0) {
+      first_timestamp_ns = entry.record->timestamp_ns;
+    }
+    if (options.speed > 0.0) {
+      const auto scheduled = replay_start + std::chrono::nanoseconds{static_cast<int64_t>(
+        static_cast<double>(entry.record->timestamp_ns - first_timestamp_ns) / options.speed)};
+      if (scheduled > now) {
+        std::this_thread::sleep_until(scheduled);
+        now = std::chrono::steady_clock::now();
+      }
+      result.lag.record(now - scheduled);
+    }
+
+    int error = 0;
+    const auto start = std::chrono::steady_clock::now();
+    switch (type) {
+      case I2CTrafficRecordType::RECORD_TRANSFER:
+        error = replay_transfer(entry, result);
+        break;
+      case I2CTrafficRecordType::RECORD_SMBUS:
+        error = replay_smbus(entry, result);
+        break;
+      case I2CTrafficRecordType::RECORD_CONTROL:
+        error = replay_control(entry);
+        break;
+      default:
+        // written by a newer version, skip it
+        continue;
+    }
+    const auto duration = std::chrono::steady_clock::now() - start;
+
+    result.records++;
+    if ((error == 0) != (entry.record->result == 0)) {
+      result.result_mismatches++;
+    }
+    if (type != I2CTrafficRecordType::RECORD_CONTROL) {
+      result.recorded_duration.record(entry.get_duration());
+      result.replayed_duration.record(duration);
+    }
+  }
+
+  result.elapsed = std::chrono::steady_clock::now() - replay_start;
+  return result;
+}
+
+int I2CTrafficReplayer::replay_transfer(
+  const I2CTrafficEntry & entry,
+  I2CTrafficReplayResult & result)
+{
+  const auto message_count = entry.record->count;
+  const auto * recorded = entry.get_messages();
+
+  std::size_t payload_size = 0;
+  for (uint32_t i = 0; i < message_count; i++) {
+    payload_size += recorded[i].len;
+  }
+
+  // written payloads are sent as recorded, reads go to a copy of what was read then
+  const auto * payloads = entry.get_payloads();
+  buffers.assign(payloads, payloads + payload_size);
+  messages.resize(message_count);
+  std::size_t offset = 0;
+  for (uint32_t i = 0; i < message_count; i++) {
+    messages[i] = i2c_msg{recorded[i].addr, recorded[i].flags, recorded[i].len,
+      buffers.data() + offset};
+
+    // M_RECV_LEN buffers were recorded holding the count received, but have to be sent holding
+    // the bytes read besides the block, which is all their length has room for past the block
+    if ((recorded[i].flags & I2CMessageFlags::M_RECV_LEN) &&
+      recorded[i].len > I2C_SMBUS_BLOCK_MAX)
+    {
+      buffers[offset] = static_cast<uint8_t>(recorded[i].len - I2C_SMBUS_BLOCK_MAX);
+    }
+    offset += recorded[i].len;
+  }
+
+  result.transfers++;
+  if (backend.transfer(messages.data(), message_count) < 0) {
+    return errno;
+  }
+
+  if (entry.record->result == 0 && std::memcmp(buffers.data(), payloads, payload_size) != 0) {
+    result.data_mismatches++;
+  }
+  return 0;
+}
+
+int I2CTrafficReplayer::replay_smbus(
+  const I2CTrafficEntry & entry,
+  I2CTrafficReplayResult & result)
+{
+  const auto & call = entry.get_smbus_call();
+  auto data = entry.get_smbus_data_before();
+
+  result.smbus_calls++;
+  if (backend.smbus_access(call.read_write, call.command, call.size, &data) < 0) {
+    return errno;
+  }
+
+  const auto & recorded = entry.get_smbus_data_after();
+  if (entry.record->result == 0 && std::memcmp(&data, &recorded, sizeof(data)) != 0) {
+    result.data_mismatches++;
+  }
+  return 0;
+}
+
+int I2CTrafficReplayer::replay_control(const I2CTrafficEntry & entry)
+{
+  const auto & control = entry.get_control();
+  int status = 0;
+  switch (control.command) {
+    case I2CIOControlCommands::SLAVE:
+      status = backend.set_slave_address(static_cast<uint16_t>(control.value));
+      break;
+    case I2CIOControlCommands::TENBIT:
+      status = backend.set_ten_bit(control.value != 0);
+      break;
+    case I2CIOControlCommands::PEC:
+      status = backend.set_pec(control.value != 0);
+      break;
+    case I2CIOControlCommands::RETRIES:
+      status = backend.set_retries(static_cast<uint32_t>(control.value));
+      break;
+    case I2CIOControlCommands::TIMEOUT:
+      status = backend.set_timeout(static_cast<uint32_t>(control.value));
+      break;
+    default:
+      break;
+  }
+  return status < 0 ? errno : 0;
+}
+
+}  // namespace ros2_i2ccpp
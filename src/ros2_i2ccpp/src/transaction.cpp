@@ -4,6 +4,7 @@ extern "C"
 }
 
 #include "ros2_i2ccpp/transaction.hpp"
+#include "ros2_i2ccpp/prepared_transaction.hpp"
 #include <execution>
 #include <algorithm>
 
@@ -14,8 +15,20 @@ namespace ros2_i2ccpp
 
 I2CTransaction I2CTransactionBuilderImpl::getTransaction()
 {
+  // the segments are moved into the transaction
+  open_write = nullptr;
+  current_offset.reset();
+
   // return i2c message buf
-  return I2CTransaction(mem_resource, std::move(transaction_segments));
+  return I2CTransaction(mem_resource, std::move(transaction_segments), allow_chunking);
+}
+
+I2CPreparedTransaction I2CTransactionBuilderImpl::prepare()
+{
+  open_write = nullptr;
+  current_offset.reset();
+
+  return I2CPreparedTransaction(mem_resource, std::move(transaction_segments), allow_chunking);
 }
 
 }
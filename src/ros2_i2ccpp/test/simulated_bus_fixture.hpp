@@ -0,0 +1,69 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#ifndef ROS2_I2CCPP__TEST__SIMULATED_BUS_FIXTURE_HPP_
+#define ROS2_I2CCPP__TEST__SIMULATED_BUS_FIXTURE_HPP_
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "ros2_i2ccpp/i2c_handler.hpp"
+#include "ros2_i2ccpp/backend/simulated_i2c_backend.hpp"
+
+namespace ros2_i2ccpp
+{
+
+constexpr uint16_t DEVICE_ADDRESS = 0x50;
+
+/**
+ * Fast mode bus that does not wait for the modeled transfer time, so tests run at full speed.
+ */
+inline std::shared_ptr<SimulatedI2CBus> make_simulated_bus(
+  const uint64_t adapter_func = SimulatedI2CBus::DEFAULT_ADAPTER_FUNC)
+{
+  return std::make_shared<SimulatedI2CBus>(
+    SimulatedBusTiming::for_speed(SimulatedBusSpeed::FAST_MODE, false), adapter_func);
+}
+
+/**
+ * Sets every register of the device to its own address, so reads show where they landed.
+ */
+inline void fill_with_addresses(SimulatedI2CDevice & device)
+{
+  auto & registers = device.get_registers();
+  for (std::size_t i = 0; i < registers.size(); i++) {
+    registers[i] = static_cast<uint8_t>(i);
+  }
+}
+
+/**
+ * Simulated bus with a register device at DEVICE_ADDRESS.
+ */
+class SimulatedBusTest : public ::testing::Test {
+protected:
+  void SetUp() override
+  {
+    bus->attach_device(DEVICE_ADDRESS, device);
+  }
+
+  std::shared_ptr<SimulatedI2CBus> bus{make_simulated_bus()};
+  std::shared_ptr<SimulatedI2CDevice> device{std::make_shared<SimulatedI2CDevice>()};
+};
+
+/**
+ * Simulated bus with a register device, driven through a ThreadSafeI2CHandler.
+ */
+class SimulatedHandlerTest : public SimulatedBusTest {
+protected:
+  ThreadSafeI2CHandler handler{std::make_unique<SimulatedI2CBackend>(bus)};
+};
+
+}  // namespace ros2_i2ccpp
+
+#endif  // ROS2_I2CCPP__TEST__SIMULATED_BUS_FIXTURE_HPP_
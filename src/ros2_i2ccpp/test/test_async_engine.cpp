@@ -0,0 +1,245 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <system_error>
+#include <thread>
+
+#include "ros2_i2ccpp/async_engine.hpp"
+#include "ros2_i2ccpp/bulk_transfer.hpp"
+#include "ros2_i2ccpp/i2c_handler.hpp"
+#include "ros2_i2ccpp/transaction.hpp"
+#include "ros2_i2ccpp/backend/simulated_i2c_backend.hpp"
+#include "simulated_bus_fixture.hpp"
+
+namespace ros2_i2ccpp
+{
+
+namespace
+{
+
+constexpr auto COMPLETION_TIMEOUT = std::chrono::seconds{5};
+
+constexpr uint16_t OTHER_DEVICE_ADDRESS = 0x51;
+constexpr uint32_t MEMORY_SIZE = 256;
+constexpr uint16_t PAGE_SIZE = 16;
+constexpr auto WRITE_CYCLE_TIME = std::chrono::milliseconds{5};
+
+/**
+ * Memory that counts the pages written to it while another memory was storing one.
+ */
+class WatchedMemoryDevice : public SimulatedMemoryDevice {
+public:
+  WatchedMemoryDevice()
+  : SimulatedMemoryDevice(MEMORY_SIZE, 1, PAGE_SIZE, WRITE_CYCLE_TIME) {}
+
+  bool on_write(const uint8_t * data, uint32_t size) override
+  {
+    // the bus lock serializes the callbacks of both devices
+    if (size > 0 && other && other->is_busy()) {
+      overlapping_writes++;
+    }
+    return SimulatedMemoryDevice::on_write(data, size);
+  }
+
+  std::shared_ptr<SimulatedMemoryDevice> other;
+  uint32_t overlapping_writes{0};
+};
+
+/**
+ * Backend of an adapter with the no zero-length quirk, which refuses zero-length messages.
+ */
+class NoZeroLengthBackend : public SimulatedI2CBackend {
+public:
+  using SimulatedI2CBackend::SimulatedI2CBackend;
+
+  int transfer(i2c_msg * messages, uint32_t message_count) override
+  {
+    for (uint32_t i = 0; i < message_count; i++) {
+      if (messages[i].len == 0) {
+        errno = EOPNOTSUPP;
+        return -1;
+      }
+    }
+    return SimulatedI2CBackend::transfer(messages, message_count);
+  }
+};
+
+I2CMemoryGeometry make_geometry(uint16_t device_address)
+{
+  I2CMemoryGeometry geometry;
+  geometry.device_address = device_address;
+  geometry.size = MEMORY_SIZE;
+  geometry.page_size = PAGE_SIZE;
+  geometry.offset_format = I2CRegisterOffsetFormat::OFFSET_8BIT;
+  geometry.write_cycle_time = WRITE_CYCLE_TIME;
+  return geometry;
+}
+
+// starts the write cycle of a memory, as a page write would
+void start_write_cycle(SimulatedMemoryDevice & memory)
+{
+  const std::array<uint8_t, 2> page_write{0x00, 0x42};
+  ASSERT_TRUE(memory.on_start(false));
+  memory.on_write(page_write.data(), page_write.size());
+  memory.on_stop();
+  ASSERT_TRUE(memory.is_busy());
+}
+
+// polls the memory until it stores its page, which it must not have done right away
+void expect_ack_after_write_cycle(ThreadSafeI2CHandler & handler, SimulatedMemoryDevice & memory)
+{
+  start_write_cycle(memory);
+  const auto busy = handler.try_poll_ack(DEVICE_ADDRESS);
+  ASSERT_TRUE(busy) << busy.error().message();
+  EXPECT_FALSE(busy.value());
+
+  std::this_thread::sleep_for(WRITE_CYCLE_TIME);
+  const auto ready = handler.try_poll_ack(DEVICE_ADDRESS);
+  ASSERT_TRUE(ready) << ready.error().message();
+  EXPECT_TRUE(ready.value());
+}
+
+class AsyncEngineTest : public SimulatedBusTest {
+protected:
+  void SetUp() override
+  {
+    SimulatedBusTest::SetUp();
+    fill_with_addresses(*device);
+  }
+
+  I2CAsyncEngine engine{std::make_unique<SimulatedI2CBackend>(bus)};
+};
+
+}  // namespace
+
+TEST_F(AsyncEngineTest, SlicedTransactionReadsEveryRegister)
+{
+  std::array<uint8_t, 10> values{};
+  I2CTransactionBuilder builder{DEVICE_ADDRESS};
+  builder.set_offset_format(I2CRegisterOffsetFormat::OFFSET_8BIT);
+  for (std::size_t i = 0; i < values.size(); i++) {
+    builder.add_read(static_cast<uint16_t>(0x40 + 2 * i), values[i]);
+  }
+
+  I2CSchedulingParameters scheduling;
+  scheduling.slice_messages = 4;
+  auto future = engine.submit(scheduling, builder.getTransaction());
+  ASSERT_EQ(future.wait_for(COMPLETION_TIMEOUT), std::future_status::ready);
+  future.get();
+
+  for (std::size_t i = 0; i < values.size(); i++) {
+    EXPECT_EQ(values[i], 0x40 + 2 * i);
+  }
+  // the offset write and its read are never split
+  EXPECT_EQ(bus->get_statistics().transfers, 5U);
+}
+
+TEST_F(AsyncEngineTest, SlicedGroupLongerThanATransferFails)
+{
+  // a single group of 43 messages, as M_NOSTART continues the previous message
+  std::array<uint8_t, I2CConstants::I2C_TRANSACTION_IOCTL_MAX_MSGS + 1> values{};
+  I2CTransactionBuilder builder{DEVICE_ADDRESS};
+  builder.enable_chunking().add_read(values[0]);
+  for (std::size_t i = 1; i < values.size(); i++) {
+    builder.add_read(values[i], I2CMessageFlags::M_NOSTART);
+  }
+
+  I2CSchedulingParameters scheduling;
+  scheduling.slice_messages = 4;
+  auto future = engine.submit(scheduling, builder.getTransaction());
+  ASSERT_EQ(future.wait_for(COMPLETION_TIMEOUT), std::future_status::ready);
+  try {
+    future.get();
+    FAIL() << "the transaction should not fit in a transfer";
+  } catch (const std::system_error & error) {
+    EXPECT_EQ(error.code(), std::errc::message_size);
+  }
+  EXPECT_EQ(bus->get_statistics().transfers, 0U);
+  EXPECT_EQ(engine.get_statistics().failed, 1U);
+}
+
+TEST(AsyncEngineWriteCycles, MemoriesOnTheSameBusOverlapTheirWriteCycles)
+{
+  auto bus = make_simulated_bus();
+  auto first = std::make_shared<WatchedMemoryDevice>();
+  auto second = std::make_shared<WatchedMemoryDevice>();
+  first->other = second;
+  second->other = first;
+  bus->attach_device(DEVICE_ADDRESS, first);
+  bus->attach_device(OTHER_DEVICE_ADDRESS, second);
+  I2CAsyncEngine engine{std::make_unique<SimulatedI2CBackend>(bus)};
+
+  // four pages each
+  std::array<uint8_t, 4 * PAGE_SIZE> image{};
+  for (std::size_t i = 0; i < image.size(); i++) {
+    image[i] = static_cast<uint8_t>(i + 1);
+  }
+  I2CMemorySource first_source{image.data(), image.size()};
+  I2CMemorySource second_source{image.data(), image.size()};
+  I2CBulkTransfer first_transfer{make_geometry(DEVICE_ADDRESS)};
+  I2CBulkTransfer second_transfer{make_geometry(OTHER_DEVICE_ADDRESS)};
+
+  auto first_future = first_transfer.submit_write(engine, 0, first_source);
+  auto second_future = second_transfer.submit_write(engine, 0, second_source);
+  ASSERT_EQ(first_future.wait_for(COMPLETION_TIMEOUT), std::future_status::ready);
+  ASSERT_EQ(second_future.wait_for(COMPLETION_TIMEOUT), std::future_status::ready);
+  EXPECT_EQ(first_future.get().transfers, 4U);
+  EXPECT_EQ(second_future.get().transfers, 4U);
+
+  for (std::size_t i = 0; i < image.size(); i++) {
+    ASSERT_EQ(first->get_registers()[i], image[i]);
+    ASSERT_EQ(second->get_registers()[i], image[i]);
+  }
+
+  // pages went to one memory while the other one was storing its own; waiting for each write
+  // cycle in turn would never do so
+  EXPECT_GT(first->overlapping_writes + second->overlapping_writes, 0U);
+  EXPECT_GT(engine.get_statistics().ack_polls, 0U);
+}
+
+TEST(AckPolling, SMBusOnlyAdaptersPollWithQuickWrites)
+{
+  auto bus = make_simulated_bus(I2CControllerFunctionalityFlags::FUNC_SMBUS_EMUL);
+  auto memory = std::make_shared<SimulatedMemoryDevice>(MEMORY_SIZE, 1, PAGE_SIZE,
+      WRITE_CYCLE_TIME);
+  bus->attach_device(DEVICE_ADDRESS, memory);
+  ThreadSafeI2CHandler handler{std::make_unique<SimulatedI2CBackend>(bus)};
+
+  expect_ack_after_write_cycle(handler, *memory);
+  EXPECT_EQ(handler.try_poll_ack(OTHER_DEVICE_ADDRESS).value_or(true), false);
+}
+
+TEST(AckPolling, AdaptersWithoutZeroLengthMessagesPollWithQuickWrites)
+{
+  auto bus = make_simulated_bus();
+  auto memory = std::make_shared<SimulatedMemoryDevice>(MEMORY_SIZE, 1, PAGE_SIZE,
+      WRITE_CYCLE_TIME);
+  bus->attach_device(DEVICE_ADDRESS, memory);
+  ThreadSafeI2CHandler handler{std::make_unique<NoZeroLengthBackend>(bus)};
+  handler.set_addressing_mode(I2CAddressingMode::ADDRESSING_PER_MESSAGE);
+
+  expect_ack_after_write_cycle(handler, *memory);
+}
+
+TEST(AckPolling, AdaptersWithNeitherReportItUnsupported)
+{
+  auto bus = make_simulated_bus(I2CControllerFunctionalityFlags::FUNC_SMBUS_BYTE_DATA);
+  bus->attach_device(DEVICE_ADDRESS, std::make_shared<SimulatedI2CDevice>());
+  ThreadSafeI2CHandler handler{std::make_unique<SimulatedI2CBackend>(bus)};
+
+  const auto result = handler.try_poll_ack(DEVICE_ADDRESS);
+  ASSERT_FALSE(result);
+  EXPECT_EQ(result.error(), std::errc::operation_not_supported);
+}
+
+}  // namespace ros2_i2ccpp
@@ -0,0 +1,136 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "ros2_i2ccpp/bulk_transfer.hpp"
+#include "ros2_i2ccpp/exceptions.hpp"
+#include "ros2_i2ccpp/i2c_handler.hpp"
+#include "ros2_i2ccpp/backend/simulated_i2c_backend.hpp"
+#include "simulated_bus_fixture.hpp"
+
+namespace ros2_i2ccpp
+{
+
+namespace
+{
+
+using exceptions::IllegalOperationException;
+
+constexpr uint32_t WINDOW_SIZE = 256;
+constexpr uint32_t PAGE_SIZE = 16;
+constexpr auto WRITE_CYCLE_TIME = std::chrono::milliseconds{1};
+
+// 100 bytes from 250 on cross 7 pages and the boundary between both device addresses
+constexpr uint32_t IMAGE_ADDRESS = 250;
+constexpr std::size_t IMAGE_SIZE = 100;
+
+/**
+ * 24C04-like memory: 512 bytes behind two device addresses, with 8-bit offsets.
+ */
+class BulkTransferTest : public ::testing::Test {
+protected:
+  void SetUp() override
+  {
+    bus->attach_device(DEVICE_ADDRESS, lower_half);
+    bus->attach_device(DEVICE_ADDRESS + 1, upper_half);
+    for (std::size_t i = 0; i < image.size(); i++) {
+      image[i] = static_cast<uint8_t>(7 * i + 3);
+    }
+  }
+
+  static I2CMemoryGeometry make_geometry()
+  {
+    I2CMemoryGeometry geometry;
+    geometry.device_address = DEVICE_ADDRESS;
+    geometry.size = 2 * WINDOW_SIZE;
+    geometry.page_size = PAGE_SIZE;
+    geometry.offset_format = I2CRegisterOffsetFormat::OFFSET_8BIT;
+    geometry.write_cycle_time = WRITE_CYCLE_TIME;
+    return geometry;
+  }
+
+  // byte of the memory at the given address, straight from the simulated devices
+  uint8_t get_memory(uint32_t address)
+  {
+    auto & half = address < WINDOW_SIZE ? lower_half : upper_half;
+    return half->get_registers()[address % WINDOW_SIZE];
+  }
+
+  std::shared_ptr<SimulatedI2CBus> bus{make_simulated_bus()};
+  std::shared_ptr<SimulatedMemoryDevice> lower_half{std::make_shared<SimulatedMemoryDevice>(
+      WINDOW_SIZE, 1, PAGE_SIZE, WRITE_CYCLE_TIME)};
+  std::shared_ptr<SimulatedMemoryDevice> upper_half{std::make_shared<SimulatedMemoryDevice>(
+      WINDOW_SIZE, 1, PAGE_SIZE, WRITE_CYCLE_TIME)};
+  ThreadSafeI2CHandler handler{std::make_unique<SimulatedI2CBackend>(bus)};
+  I2CBulkTransfer transfer{make_geometry()};
+  std::array<uint8_t, IMAGE_SIZE> image{};
+};
+
+}  // namespace
+
+TEST_F(BulkTransferTest, RoundTripsAcrossPagesAndDeviceAddresses)
+{
+  I2CMemorySource source{image.data(), image.size()};
+  const auto written = transfer.write(handler, IMAGE_ADDRESS, source);
+  EXPECT_EQ(written.bytes, IMAGE_SIZE);
+  EXPECT_EQ(written.transfers, 7U);
+
+  // a page crossed by a single write would have wrapped around onto its own start
+  for (uint32_t i = 0; i < IMAGE_SIZE; i++) {
+    ASSERT_EQ(get_memory(IMAGE_ADDRESS + i), image[i]) << "at address " << IMAGE_ADDRESS + i;
+  }
+  EXPECT_EQ(get_memory(IMAGE_ADDRESS - 1), 0);
+  EXPECT_EQ(get_memory(IMAGE_ADDRESS + IMAGE_SIZE), 0);
+
+  std::array<uint8_t, IMAGE_SIZE> read_back{};
+  I2CMemorySink sink{read_back.data(), read_back.size()};
+  const auto read = transfer.read(handler, IMAGE_ADDRESS, sink, IMAGE_SIZE);
+  EXPECT_EQ(read.bytes, IMAGE_SIZE);
+  // reads only split where the device address changes
+  EXPECT_EQ(read.transfers, 2U);
+  EXPECT_EQ(read_back, image);
+}
+
+TEST_F(BulkTransferTest, RefusesAccessesPastTheEnd)
+{
+  std::array<uint8_t, 2> data{};
+  I2CMemorySink sink{data.data(), data.size()};
+  EXPECT_THROW(transfer.read(handler, 2 * WINDOW_SIZE - 1, sink, 2), IllegalOperationException);
+
+  I2CMemorySource source{data.data(), data.size()};
+  EXPECT_THROW(transfer.write(handler, 2 * WINDOW_SIZE - 1, source), IllegalOperationException);
+}
+
+TEST_F(BulkTransferTest, StreamsBetweenMappedFiles)
+{
+  const auto image_path = ::testing::TempDir() + "bulk_transfer_image.bin";
+  const auto dump_path = ::testing::TempDir() + "bulk_transfer_dump.bin";
+  {
+    I2CMappedFile image_file{image_path, IMAGE_SIZE};
+    std::memcpy(image_file.get_data(), image.data(), IMAGE_SIZE);
+  }
+
+  I2CMappedFile image_file{image_path};
+  EXPECT_FALSE(image_file.is_writable());
+  EXPECT_THROW(static_cast<void>(image_file.make_sink()), IllegalOperationException);
+
+  auto source = image_file.make_source();
+  transfer.write(handler, IMAGE_ADDRESS, source);
+
+  I2CMappedFile dump_file{dump_path, IMAGE_SIZE};
+  auto sink = dump_file.make_sink();
+  transfer.read(handler, IMAGE_ADDRESS, sink, IMAGE_SIZE);
+  EXPECT_EQ(std::memcmp(dump_file.get_data(), image.data(), IMAGE_SIZE), 0);
+}
+
+}  // namespace ros2_i2ccpp
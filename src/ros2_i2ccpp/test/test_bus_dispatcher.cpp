@@ -0,0 +1,116 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+
+#include "ros2_i2ccpp/bus_dispatcher.hpp"
+#include "ros2_i2ccpp/exceptions.hpp"
+#include "ros2_i2ccpp/transaction.hpp"
+#include "ros2_i2ccpp/backend/simulated_i2c_backend.hpp"
+#include "simulated_bus_fixture.hpp"
+
+namespace ros2_i2ccpp
+{
+
+namespace
+{
+
+constexpr uint16_t OTHER_DEVICE_ADDRESS = 0x51;
+constexpr auto COMPLETION_TIMEOUT = std::chrono::seconds{5};
+
+class BusDispatcherTest : public ::testing::Test {
+protected:
+  void SetUp() override
+  {
+    // each bus tells its reads apart by the value of register 0
+    first_device->get_registers()[0] = 0x01;
+    second_device->get_registers()[0] = 0x02;
+    first_bus->attach_device(DEVICE_ADDRESS, first_device);
+    second_bus->attach_device(OTHER_DEVICE_ADDRESS, second_device);
+
+    dispatcher.add_bus(1, std::make_unique<SimulatedI2CBackend>(first_bus), "/dev/i2c-1");
+    dispatcher.add_bus(2, std::make_unique<SimulatedI2CBackend>(second_bus), "/dev/i2c-2");
+    dispatcher.attach_device(DEVICE_ADDRESS, 1);
+    dispatcher.attach_device(OTHER_DEVICE_ADDRESS, 2);
+  }
+
+  // reads register 0 of the given device through the dispatcher
+  uint8_t read_register(uint16_t address)
+  {
+    uint8_t value = 0;
+    I2CTransactionBuilder builder{address};
+    builder.set_offset_format(I2CRegisterOffsetFormat::OFFSET_8BIT).add_read(0x00, value);
+    auto future = dispatcher.submit_to_device(address, builder.getTransaction());
+    EXPECT_EQ(future.wait_for(COMPLETION_TIMEOUT), std::future_status::ready);
+    future.get();
+    return value;
+  }
+
+  std::shared_ptr<SimulatedI2CBus> first_bus{make_simulated_bus()};
+  std::shared_ptr<SimulatedI2CBus> second_bus{make_simulated_bus()};
+  std::shared_ptr<SimulatedI2CDevice> first_device{std::make_shared<SimulatedI2CDevice>()};
+  std::shared_ptr<SimulatedI2CDevice> second_device{std::make_shared<SimulatedI2CDevice>()};
+  I2CBusDispatcher dispatcher;
+};
+
+}  // namespace
+
+TEST_F(BusDispatcherTest, RoutesDevicesToTheirBus)
+{
+  EXPECT_EQ(read_register(DEVICE_ADDRESS), 0x01);
+  EXPECT_EQ(read_register(OTHER_DEVICE_ADDRESS), 0x02);
+  EXPECT_EQ(read_register(DEVICE_ADDRESS), 0x01);
+
+  EXPECT_EQ(first_bus->get_statistics().transfers, 2U);
+  EXPECT_EQ(second_bus->get_statistics().transfers, 1U);
+  EXPECT_EQ(dispatcher.get_device_bus(OTHER_DEVICE_ADDRESS), 2U);
+}
+
+TEST_F(BusDispatcherTest, RejectsUnknownAndConflictingRoutes)
+{
+  using exceptions::IllegalOperationException;
+
+  EXPECT_THROW(static_cast<void>(dispatcher.get_bus(3)), IllegalOperationException);
+  EXPECT_THROW(static_cast<void>(dispatcher.get_device_bus(0x52)), IllegalOperationException);
+  EXPECT_THROW(dispatcher.attach_device(0x52, 3), IllegalOperationException);
+  EXPECT_THROW(dispatcher.attach_device(DEVICE_ADDRESS, 2), IllegalOperationException);
+  EXPECT_THROW(
+    dispatcher.add_bus(1, std::make_unique<SimulatedI2CBackend>(first_bus), "/dev/i2c-1"),
+    IllegalOperationException);
+
+  // attaching a device to its own bus again is harmless
+  EXPECT_NO_THROW(dispatcher.attach_device(DEVICE_ADDRESS, 1));
+}
+
+TEST_F(BusDispatcherTest, ReportsTheLoadOfEachBus)
+{
+  for (int i = 0; i < 10; i++) {
+    read_register(DEVICE_ADDRESS);
+  }
+
+  auto statistics = dispatcher.get_statistics();
+  ASSERT_EQ(statistics.size(), 2U);
+  EXPECT_EQ(statistics[0].bus, 1U);
+  EXPECT_EQ(statistics[0].totals.completed, 10U);
+  EXPECT_EQ(statistics[0].queue_depth, 0U);
+  EXPECT_GT(statistics[0].utilization, 0.0);
+  EXPECT_LE(statistics[0].utilization, 1.0);
+
+  EXPECT_EQ(statistics[1].bus, 2U);
+  EXPECT_EQ(statistics[1].totals.completed, 0U);
+  EXPECT_EQ(statistics[1].utilization, 0.0);
+
+  // the utilization only covers the time since the previous sample
+  statistics = dispatcher.get_statistics();
+  EXPECT_EQ(statistics[0].totals.completed, 10U);
+  EXPECT_EQ(statistics[0].utilization, 0.0);
+}
+
+}  // namespace ros2_i2ccpp
@@ -0,0 +1,108 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <system_error>
+
+#include "ros2_i2ccpp/exceptions.hpp"
+#include "ros2_i2ccpp/i2c_handler.hpp"
+#include "ros2_i2ccpp/inline_transaction.hpp"
+#include "ros2_i2ccpp/backend/simulated_i2c_backend.hpp"
+#include "simulated_bus_fixture.hpp"
+
+namespace ros2_i2ccpp
+{
+
+namespace
+{
+
+using exceptions::IllegalOperationException;
+using exceptions::SysException;
+
+/**
+ * Backend whose transfers fail with the given errno, as the kernel would report it.
+ */
+class FailingBackend : public SimulatedI2CBackend {
+public:
+  FailingBackend(std::shared_ptr<SimulatedI2CBus> bus_, int error_)
+  : SimulatedI2CBackend(std::move(bus_)), error(error_) {}
+
+  int transfer(i2c_msg * /*messages*/, uint32_t /*message_count*/) override
+  {
+    errno = error;
+    return -1;
+  }
+
+private:
+  int error;
+};
+
+std::shared_ptr<SimulatedI2CBus> make_bus(
+  uint64_t adapter_func = SimulatedI2CBus::DEFAULT_ADAPTER_FUNC)
+{
+  auto bus = make_simulated_bus(adapter_func);
+  bus->attach_device(DEVICE_ADDRESS, std::make_shared<SimulatedI2CDevice>());
+  return bus;
+}
+
+I2CInlineTransaction<> make_read(uint8_t & value)
+{
+  I2CInlineTransaction<> transaction{DEVICE_ADDRESS};
+  transaction.add_read(value);
+  return transaction;
+}
+
+}  // namespace
+
+TEST(ErrorReporting, KernelErrorsKeepTheirCode)
+{
+  for (const int error : {ENXIO, EBADF, EOPNOTSUPP, EMSGSIZE}) {
+    ThreadSafeI2CHandler handler{std::make_unique<FailingBackend>(make_bus(), error)};
+    uint8_t value = 0;
+    auto transaction = make_read(value);
+    try {
+      handler.apply_transaction(transaction);
+      FAIL() << "the transfer should fail";
+    } catch (const SysException & exception) {
+      EXPECT_EQ(exception.code(), std::error_code(error, std::generic_category()));
+    }
+  }
+}
+
+TEST(ErrorReporting, AbsentDeviceIsASysException)
+{
+  auto bus = make_bus();
+  bus->detach_device(DEVICE_ADDRESS);
+  ThreadSafeI2CHandler handler{std::make_unique<SimulatedI2CBackend>(bus)};
+  uint8_t value = 0;
+  auto transaction = make_read(value);
+  try {
+    handler.apply_transaction(transaction);
+    FAIL() << "the transfer should fail";
+  } catch (const SysException & exception) {
+    EXPECT_EQ(exception.code(), std::errc::no_such_device_or_address);
+  }
+}
+
+TEST(ErrorReporting, MissingFunctionalityIsAnIllegalOperation)
+{
+  ThreadSafeI2CHandler handler{std::make_unique<SimulatedI2CBackend>(
+      make_bus(I2CControllerFunctionalityFlags::FUNC_SMBUS_EMUL))};
+  uint8_t value = 0;
+  auto transaction = make_read(value);
+  EXPECT_THROW(handler.apply_transaction(transaction), IllegalOperationException);
+
+  // the error code of the try_ variant still compares equal to the errno
+  const auto result = handler.try_apply_transaction(transaction);
+  ASSERT_FALSE(result);
+  EXPECT_EQ(result.error(), std::errc::operation_not_supported);
+  EXPECT_EQ(result.error().value(), EOPNOTSUPP);
+}
+
+}  // namespace ros2_i2ccpp
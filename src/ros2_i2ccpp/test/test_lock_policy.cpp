@@ -0,0 +1,164 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ros2_i2ccpp/i2c_handler.hpp"
+#include "ros2_i2ccpp/lock_policy.hpp"
+#include "ros2_i2ccpp/transaction.hpp"
+#include "ros2_i2ccpp/backend/simulated_i2c_backend.hpp"
+#include "simulated_bus_fixture.hpp"
+
+namespace ros2_i2ccpp
+{
+
+namespace
+{
+
+constexpr uint16_t OTHER_DEVICE_ADDRESS = 0x51;
+
+// more threads than most machines have CPUs, so waiters both spin and sleep
+constexpr int THREAD_COUNT = 16;
+constexpr int ITERATION_COUNT = 20000;
+
+/**
+ * Runs the function on THREAD_COUNT threads at once, passing each its index.
+ */
+template<typename FunctionT>
+void run_on_threads(FunctionT function)
+{
+  std::atomic<bool> start{false};
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < THREAD_COUNT; thread++) {
+    threads.emplace_back([&start, &function, thread] {
+        while (!start.load(std::memory_order_acquire)) {
+          std::this_thread::yield();
+        }
+        function(thread);
+      });
+  }
+  start.store(true, std::memory_order_release);
+  for (auto & thread : threads) {
+    thread.join();
+  }
+}
+
+template<typename MutexT>
+class LockPolicyTest : public ::testing::Test {};
+
+using MutexTypes = ::testing::Types<spin_then_park_mutex, priority_inheritance_mutex>;
+TYPED_TEST_SUITE(LockPolicyTest, MutexTypes, );
+
+}  // namespace
+
+TYPED_TEST(LockPolicyTest, ExcludesOtherOwners)
+{
+  TypeParam mutex;
+  ASSERT_TRUE(mutex.try_lock());
+  std::thread other{[&mutex] {EXPECT_FALSE(mutex.try_lock());}};
+  other.join();
+  mutex.unlock();
+
+  std::thread next{[&mutex] {
+      ASSERT_TRUE(mutex.try_lock());
+      mutex.unlock();
+    }};
+  next.join();
+}
+
+TYPED_TEST(LockPolicyTest, NoUpdateIsLostUnderContention)
+{
+  TypeParam mutex;
+  // deliberately not atomic: a lost update shows that two threads held the lock at once
+  uint64_t counter = 0;
+  std::atomic<int> owners{0};
+  std::atomic<bool> overlapped{false};
+
+  run_on_threads([&](int) {
+      for (int i = 0; i < ITERATION_COUNT; i++) {
+        std::lock_guard<TypeParam> lock{mutex};
+        if (owners.fetch_add(1, std::memory_order_relaxed) != 0) {
+          overlapped = true;
+        }
+        counter++;
+        owners.fetch_sub(1, std::memory_order_relaxed);
+      }
+    });
+
+  EXPECT_FALSE(overlapped);
+  EXPECT_EQ(counter, static_cast<uint64_t>(THREAD_COUNT) * ITERATION_COUNT);
+}
+
+TYPED_TEST(LockPolicyTest, WakesEverySleeper)
+{
+  TypeParam mutex;
+  std::atomic<int> finished{0};
+
+  // every thread queues up behind the owner and has to be woken up in turn
+  mutex.lock();
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < THREAD_COUNT; thread++) {
+    threads.emplace_back([&mutex, &finished] {
+        std::lock_guard<TypeParam> lock{mutex};
+        finished++;
+      });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds{20});
+  EXPECT_EQ(finished, 0);
+  mutex.unlock();
+
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(finished, THREAD_COUNT);
+  EXPECT_TRUE(mutex.try_lock());
+  mutex.unlock();
+}
+
+TEST(SpinThenParkHandler, SharedByManyThreads)
+{
+  constexpr int TRANSACTION_COUNT = 500;
+
+  auto bus = make_simulated_bus();
+  auto device = std::make_shared<SimulatedI2CDevice>();
+  auto other_device = std::make_shared<SimulatedI2CDevice>();
+  fill_with_addresses(*device);
+  fill_with_addresses(*other_device);
+  other_device->get_registers()[0x10] = 0xAA;
+  bus->attach_device(DEVICE_ADDRESS, device);
+  bus->attach_device(OTHER_DEVICE_ADDRESS, other_device);
+
+  SpinThenParkI2CHandler handler{std::make_unique<SimulatedI2CBackend>(bus)};
+  std::atomic<int> wrong_reads{0};
+
+  // half the threads read each device, so a transfer sent to the other one shows up
+  run_on_threads([&](int thread) {
+      const auto address = thread % 2 == 0 ? DEVICE_ADDRESS : OTHER_DEVICE_ADDRESS;
+      const uint8_t expected = thread % 2 == 0 ? 0x10 : 0xAA;
+      for (int i = 0; i < TRANSACTION_COUNT; i++) {
+        uint8_t value = 0;
+        I2CTransactionBuilder builder{address};
+        builder.set_offset_format(I2CRegisterOffsetFormat::OFFSET_8BIT).add_read(0x10, value);
+        if (!handler.try_apply_transaction(builder.getTransaction()) || value != expected) {
+          wrong_reads++;
+        }
+      }
+    });
+
+  EXPECT_EQ(wrong_reads, 0);
+  const auto statistics = bus->get_statistics();
+  EXPECT_EQ(statistics.transfers, static_cast<uint64_t>(THREAD_COUNT) * TRANSACTION_COUNT);
+  EXPECT_EQ(statistics.naks, 0U);
+}
+
+}  // namespace ros2_i2ccpp
@@ -0,0 +1,105 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ros2_i2ccpp/constants.hpp"
+#include "ros2_i2ccpp/i2c_handler.hpp"
+#include "ros2_i2ccpp/transaction.hpp"
+#include "ros2_i2ccpp/backend/simulated_i2c_backend.hpp"
+#include "ros2_i2ccpp/impl/message_chunking.hpp"
+#include "simulated_bus_fixture.hpp"
+
+namespace ros2_i2ccpp
+{
+
+namespace
+{
+
+i2c_msg write_message() {return i2c_msg{DEVICE_ADDRESS, 0, 0, nullptr};}
+i2c_msg read_message() {return i2c_msg{DEVICE_ADDRESS, I2CMessageFlags::M_RD, 0, nullptr};}
+
+}  // namespace
+
+TEST(MessageChunking, KeepsCombinedWriteReadTogether)
+{
+  EXPECT_TRUE(is_atomic_continuation(write_message(), read_message()));
+  EXPECT_FALSE(is_atomic_continuation(read_message(), write_message()));
+  EXPECT_FALSE(is_atomic_continuation(read_message(), read_message()));
+  EXPECT_FALSE(is_atomic_continuation(write_message(), write_message()));
+
+  // a read from another device, or after an explicit STOP, starts a new group
+  auto other_device = read_message();
+  other_device.addr = DEVICE_ADDRESS + 1;
+  EXPECT_FALSE(is_atomic_continuation(write_message(), other_device));
+  auto stop = write_message();
+  stop.flags = I2CMessageFlags::M_STOP;
+  EXPECT_FALSE(is_atomic_continuation(stop, read_message()));
+
+  auto no_start = write_message();
+  no_start.flags = I2CMessageFlags::M_NOSTART;
+  EXPECT_TRUE(is_atomic_continuation(read_message(), no_start));
+}
+
+TEST(MessageChunking, SplitsBetweenGroups)
+{
+  // write+read pairs, so a chunk of 5 messages only fits 2 pairs
+  std::vector<i2c_msg> messages;
+  for (int i = 0; i < 5; i++) {
+    messages.push_back(write_message());
+    messages.push_back(read_message());
+  }
+
+  EXPECT_EQ(next_chunk_size(messages.data(), 10, 5), 4U);
+  EXPECT_EQ(next_chunk_size(messages.data(), 10, 10), 10U);
+  EXPECT_EQ(next_chunk_size(messages.data(), 10, 1), 0U);
+  EXPECT_EQ(next_chunk_size(messages.data() + 8, 2, 5), 2U);
+}
+
+TEST(MessageChunking, ChunkedTransactionReachesEveryRegister)
+{
+  auto bus = make_simulated_bus();
+  auto device = std::make_shared<SimulatedI2CDevice>();
+  fill_with_addresses(*device);
+  bus->attach_device(DEVICE_ADDRESS, device);
+  ThreadSafeI2CHandler handler{std::make_unique<SimulatedI2CBackend>(bus)};
+
+  // 30 register reads are 60 messages, more than a single transfer carries
+  std::array<uint8_t, 30> values{};
+  I2CTransactionBuilder builder{DEVICE_ADDRESS};
+  builder.set_offset_format(I2CRegisterOffsetFormat::OFFSET_8BIT).enable_chunking();
+  for (std::size_t i = 0; i < values.size(); i++) {
+    builder.add_read(static_cast<uint16_t>(2 * i), values[i]);
+  }
+  handler.apply_transaction(builder.getTransaction());
+
+  for (std::size_t i = 0; i < values.size(); i++) {
+    EXPECT_EQ(values[i], 2 * i);
+  }
+
+  // the first transfer takes the 21 pairs that fit in 42 messages
+  const auto statistics = bus->get_statistics();
+  EXPECT_EQ(statistics.transfers, 2U);
+  EXPECT_EQ(statistics.messages, 2 * values.size());
+}
+
+TEST(MessageChunking, TransactionsAreLimitedWithoutChunking)
+{
+  uint8_t value = 0;
+  I2CTransactionBuilder builder{DEVICE_ADDRESS};
+  const auto add_reads = [&builder, &value]() {
+      for (uint32_t i = 0; i <= I2CConstants::I2C_TRANSACTION_IOCTL_MAX_MSGS; i++) {
+        builder.add_read(value);
+      }
+    };
+  EXPECT_THROW(add_reads(), exceptions::IllegalOperationException);
+}
+
+}  // namespace ros2_i2ccpp
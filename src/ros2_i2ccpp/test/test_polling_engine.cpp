@@ -0,0 +1,181 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include "ros2_i2ccpp/polling_engine.hpp"
+#include "ros2_i2ccpp/triple_buffer.hpp"
+#include "ros2_i2ccpp/backend/simulated_i2c_backend.hpp"
+#include "simulated_bus_fixture.hpp"
+
+namespace ros2_i2ccpp
+{
+
+namespace
+{
+
+constexpr uint16_t OTHER_DEVICE_ADDRESS = 0x51;
+constexpr uint16_t ABSENT_DEVICE_ADDRESS = 0x52;
+constexpr auto PERIOD = std::chrono::milliseconds{5};
+constexpr auto COMPLETION_TIMEOUT = std::chrono::seconds{5};
+
+// waits until the condition holds, returns false if it did not in time
+template<typename ConditionT>
+bool wait_until(ConditionT condition)
+{
+  const auto deadline = std::chrono::steady_clock::now() + COMPLETION_TIMEOUT;
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  return true;
+}
+
+class PollingEngineTest : public SimulatedBusTest {
+protected:
+  void SetUp() override
+  {
+    SimulatedBusTest::SetUp();
+    fill_with_addresses(*device);
+    fill_with_addresses(*other_device);
+    bus->attach_device(OTHER_DEVICE_ADDRESS, other_device);
+  }
+
+  std::shared_ptr<SimulatedI2CDevice> other_device{std::make_shared<SimulatedI2CDevice>()};
+  I2CPollingEngine engine{std::make_unique<SimulatedI2CBackend>(bus)};
+};
+
+}  // namespace
+
+TEST_F(PollingEngineTest, RegistersDueTogetherShareATransfer)
+{
+  auto first = engine.add_register(DEVICE_ADDRESS, 0x10, 2, PERIOD);
+  auto second = engine.add_register(DEVICE_ADDRESS, 0x20, 1, PERIOD);
+  auto third = engine.add_register(OTHER_DEVICE_ADDRESS, 0x30, 4, 2 * PERIOD);
+
+  // once every register was read, they are due on the same ticks
+  ASSERT_TRUE(wait_until([&] {return first->get_sequence() > 0 || first->update();}));
+  ASSERT_TRUE(wait_until([&] {return second->get_sequence() > 0 || second->update();}));
+  ASSERT_TRUE(wait_until([&] {return third->get_sequence() > 0 || third->update();}));
+  EXPECT_EQ(first->get<uint16_t>(), 0x1110);
+  EXPECT_EQ(second->get<uint8_t>(), 0x20);
+  EXPECT_EQ(third->get<uint32_t>(), 0x33323130U);
+
+  // every tick reads the first two registers, and every other tick the third one as well
+  bus->reset_statistics();
+  ASSERT_TRUE(wait_until([&] {return bus->get_statistics().transfers >= 4;}));
+  const auto statistics = bus->get_statistics();
+  EXPECT_LE(statistics.messages, 6 * statistics.transfers);
+  EXPECT_GT(statistics.messages, 4 * statistics.transfers);
+  EXPECT_EQ(statistics.naks, 0U);
+}
+
+TEST_F(PollingEngineTest, FaultyDeviceDoesNotHideTheOthers)
+{
+  auto present = engine.add_register(DEVICE_ADDRESS, 0x10, 1, PERIOD);
+  auto absent = engine.add_register(ABSENT_DEVICE_ADDRESS, 0x10, 1, PERIOD);
+
+  ASSERT_TRUE(wait_until([&] {return absent->get_error_count() >= 3;}));
+  ASSERT_TRUE(wait_until([&] {
+      present->update();
+      return present->get_sequence() >= 3;
+    }));
+  EXPECT_EQ(present->get<uint8_t>(), 0x10);
+
+  // the faulty register never publishes anything
+  EXPECT_FALSE(absent->update());
+  EXPECT_EQ(absent->get_sequence(), 0U);
+
+  const auto statistics = engine.get_statistics();
+  EXPECT_GE(statistics.errors, 3U);
+  EXPECT_GE(statistics.reads, 3U);
+  // the shared transfer failed and was retried one register at a time
+  EXPECT_GT(statistics.transfers, statistics.ticks);
+}
+
+TEST_F(PollingEngineTest, RemovedRegistersAreNoLongerRead)
+{
+  auto polled_register = engine.add_register(DEVICE_ADDRESS, 0x10, 1, PERIOD);
+  ASSERT_TRUE(wait_until([&] {return polled_register->update();}));
+
+  engine.remove_register(polled_register);
+  std::this_thread::sleep_for(4 * PERIOD);
+  const auto reads = engine.get_statistics().reads;
+  std::this_thread::sleep_for(4 * PERIOD);
+  EXPECT_EQ(engine.get_statistics().reads, reads);
+}
+
+TEST(TripleBuffer, ReaderGetsTheLatestSample)
+{
+  TripleBuffer buffer{sizeof(uint32_t)};
+  EXPECT_FALSE(buffer.update());
+  EXPECT_EQ(buffer.get_read_sequence(), 0U);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t sample = 1; sample <= 3; sample++) {
+    std::memcpy(buffer.get_write_buffer(), &sample, sizeof(sample));
+    buffer.publish(start + std::chrono::milliseconds{sample});
+  }
+
+  // the samples in between were overwritten
+  ASSERT_TRUE(buffer.update());
+  uint32_t value = 0;
+  std::memcpy(&value, buffer.get_read_buffer(), sizeof(value));
+  EXPECT_EQ(value, 3U);
+  EXPECT_EQ(buffer.get_read_sequence(), 3U);
+  EXPECT_EQ(buffer.get_read_timestamp(), start + std::chrono::milliseconds{3});
+  EXPECT_FALSE(buffer.update());
+
+  const uint32_t sample = 4;
+  std::memcpy(buffer.get_write_buffer(), &sample, sizeof(sample));
+  buffer.publish(start);
+  ASSERT_TRUE(buffer.update());
+  std::memcpy(&value, buffer.get_read_buffer(), sizeof(value));
+  EXPECT_EQ(value, 4U);
+  EXPECT_EQ(buffer.get_read_sequence(), 4U);
+}
+
+TEST(TripleBuffer, ReaderNeverSeesATornSample)
+{
+  constexpr uint64_t SAMPLE_COUNT = 200000;
+  TripleBuffer buffer{2 * sizeof(uint64_t)};
+
+  // each sample holds its sequence twice, so a sample mixing two writes shows up
+  std::thread writer{[&buffer] {
+      for (uint64_t sample = 1; sample <= SAMPLE_COUNT; sample++) {
+        std::memcpy(buffer.get_write_buffer(), &sample, sizeof(sample));
+        std::memcpy(buffer.get_write_buffer() + sizeof(sample), &sample, sizeof(sample));
+        buffer.publish(std::chrono::steady_clock::now());
+      }
+    }};
+
+  uint64_t last_sequence = 0;
+  while (last_sequence < SAMPLE_COUNT) {
+    if (!buffer.update()) {
+      continue;
+    }
+    uint64_t first = 0;
+    uint64_t second = 0;
+    std::memcpy(&first, buffer.get_read_buffer(), sizeof(first));
+    std::memcpy(&second, buffer.get_read_buffer() + sizeof(first), sizeof(second));
+    if (first != buffer.get_read_sequence() || second != first || first <= last_sequence) {
+      ADD_FAILURE() << "sample " << first << "/" << second << " picked up as " <<
+        buffer.get_read_sequence() << " after " << last_sequence;
+      break;
+    }
+    last_sequence = first;
+  }
+  writer.join();
+}
+
+}  // namespace ros2_i2ccpp
@@ -0,0 +1,127 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "ros2_i2ccpp/i2c_handler.hpp"
+#include "ros2_i2ccpp/prepared_transaction.hpp"
+#include "ros2_i2ccpp/transaction.hpp"
+#include "ros2_i2ccpp/backend/simulated_i2c_backend.hpp"
+#include "simulated_bus_fixture.hpp"
+
+namespace ros2_i2ccpp
+{
+
+namespace
+{
+
+class PreparedTransactionTest : public SimulatedHandlerTest {
+protected:
+  void SetUp() override
+  {
+    SimulatedHandlerTest::SetUp();
+    builder.set_offset_format(I2CRegisterOffsetFormat::OFFSET_8BIT);
+  }
+
+  I2CTransactionBuilder builder{DEVICE_ADDRESS};
+};
+
+}  // namespace
+
+TEST_F(PreparedTransactionTest, RefreshesReadsOnEveryExecution)
+{
+  uint16_t first = 0;
+  std::array<uint8_t, 3> second{};
+  auto prepared = builder.add_read(0x10, first).add_read_in_place(0x20, second).prepare();
+  ASSERT_EQ(prepared.get_message_count(), 4U);
+  const auto * messages = prepared.get_messages();
+
+  auto & registers = device->get_registers();
+  for (uint8_t sample = 0; sample < 3; sample++) {
+    registers[0x10] = sample;
+    registers[0x11] = static_cast<uint8_t>(sample + 1);
+    registers[0x20] = static_cast<uint8_t>(0xA0 + sample);
+    registers[0x22] = static_cast<uint8_t>(0xB0 + sample);
+
+    handler.apply_transaction(prepared);
+    EXPECT_EQ(first, (sample + 1) << 8 | sample);
+    EXPECT_EQ(second[0], 0xA0 + sample);
+    EXPECT_EQ(second[2], 0xB0 + sample);
+
+    // executing it does not rebuild the messages
+    EXPECT_EQ(prepared.get_messages(), messages);
+  }
+  EXPECT_EQ(bus->get_statistics().transfers, 3U);
+}
+
+TEST_F(PreparedTransactionTest, RepeatsWrites)
+{
+  const uint8_t value = 0x5A;
+  auto prepared = builder.add_write(uint16_t{0x30}, value).prepare();
+
+  auto & registers = device->get_registers();
+  for (int i = 0; i < 2; i++) {
+    registers[0x30] = 0;
+    handler.apply_transaction(prepared);
+    EXPECT_EQ(registers[0x30], 0x5A);
+  }
+}
+
+TEST_F(PreparedTransactionTest, SurvivesAMove)
+{
+  uint8_t value = 0;
+  auto prepared = builder.add_read(0x40, value).prepare();
+  device->get_registers()[0x40] = 0x42;
+
+  auto moved = std::move(prepared);
+  handler.apply_transaction(moved);
+  EXPECT_EQ(value, 0x42);
+}
+
+TEST_F(PreparedTransactionTest, DestructionKeepsTheBoundObjects)
+{
+  uint8_t value = 0;
+  {
+    auto prepared = builder.add_read(0x40, value).prepare();
+    device->get_registers()[0x40] = 0x42;
+    handler.apply_transaction(prepared);
+    EXPECT_EQ(value, 0x42);
+
+    // the caller owns the object between executions
+    value = 0x17;
+  }
+  EXPECT_EQ(value, 0x17);
+}
+
+TEST_F(PreparedTransactionTest, OutlivesItsBoundObjects)
+{
+  auto value = std::make_unique<uint32_t>(0);
+  auto prepared = builder.add_read(0x40, *value).prepare();
+  handler.apply_transaction(prepared);
+
+  // run under ASan, destroying the transaction must not touch the freed object
+  value.reset();
+}
+
+TEST_F(PreparedTransactionTest, ReportsFailuresAndRunsAgain)
+{
+  uint8_t value = 0;
+  auto prepared = builder.add_read(0x40, value).prepare();
+
+  bus->detach_device(DEVICE_ADDRESS);
+  EXPECT_FALSE(handler.try_apply_transaction(prepared));
+
+  bus->attach_device(DEVICE_ADDRESS, device);
+  device->get_registers()[0x40] = 0x42;
+  EXPECT_TRUE(handler.try_apply_transaction(prepared));
+  EXPECT_EQ(value, 0x42);
+}
+
+}  // namespace ros2_i2ccpp
@@ -0,0 +1,119 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <exception>
+#include <memory>
+
+#include "ros2_i2ccpp/i2c_handler.hpp"
+#include "ros2_i2ccpp/register_cache.hpp"
+#include "ros2_i2ccpp/backend/simulated_i2c_backend.hpp"
+#include "simulated_bus_fixture.hpp"
+
+namespace ros2_i2ccpp
+{
+
+namespace
+{
+
+class RegisterCacheTest : public SimulatedHandlerTest {
+protected:
+  I2CRegisterCache cache{DEVICE_ADDRESS, 256};
+};
+
+}  // namespace
+
+TEST_F(RegisterCacheTest, ServesKnownRegistersAndElidesWrites)
+{
+  device->get_registers()[0x10] = 0x42;
+
+  EXPECT_EQ(cache.read(handler, 0x10), 0x42);
+  EXPECT_EQ(cache.read(handler, 0x10), 0x42);
+  cache.write(handler, 0x10, 0x42);
+  EXPECT_EQ(bus->get_statistics().transfers, 1U);
+
+  cache.write(handler, 0x10, 0x43);
+  EXPECT_EQ(device->get_registers()[0x10], 0x43);
+  EXPECT_EQ(cache.read(handler, 0x10), 0x43);
+  EXPECT_EQ(bus->get_statistics().transfers, 2U);
+
+  const auto & statistics = cache.get_statistics();
+  EXPECT_EQ(statistics.hits, 2U);
+  EXPECT_EQ(statistics.misses, 1U);
+  EXPECT_EQ(statistics.elided_writes, 1U);
+  EXPECT_EQ(statistics.writes, 1U);
+}
+
+TEST_F(RegisterCacheTest, VolatileRegistersAlwaysGoToTheDevice)
+{
+  cache.set_volatile(0x10);
+  device->get_registers()[0x10] = 0x01;
+  EXPECT_EQ(cache.read(handler, 0x10), 0x01);
+  device->get_registers()[0x10] = 0x02;
+  EXPECT_EQ(cache.read(handler, 0x10), 0x02);
+  EXPECT_EQ(bus->get_statistics().transfers, 2U);
+}
+
+TEST_F(RegisterCacheTest, ReadKeepsStagedWrite)
+{
+  device->get_registers()[0x20] = 0x11;
+
+  cache.stage(0x20, 0xAB);
+  EXPECT_EQ(cache.read(handler, 0x20), 0xAB);
+  EXPECT_EQ(cache.flush(handler), 1U);
+  EXPECT_EQ(device->get_registers()[0x20], 0xAB);
+  EXPECT_EQ(cache.read(handler, 0x20), 0xAB);
+}
+
+TEST_F(RegisterCacheTest, VolatileReadKeepsStagedWrite)
+{
+  cache.set_volatile(0x20);
+  device->get_registers()[0x20] = 0x11;
+
+  cache.stage(0x20, 0xAB);
+  EXPECT_EQ(cache.read(handler, 0x20), 0x11);
+  EXPECT_EQ(cache.get_dirty_count(), 1U);
+  EXPECT_EQ(cache.flush(handler), 1U);
+  EXPECT_EQ(device->get_registers()[0x20], 0xAB);
+}
+
+TEST_F(RegisterCacheTest, FlushMergesConsecutiveRegisters)
+{
+  cache.stage(0x10, 0x01);
+  cache.stage(0x11, 0x02);
+  cache.stage(0x12, 0x03);
+  cache.stage(0x30, 0x04);
+  cache.stage_bits(handler, 0x11, 0xF0, 0xA0);
+  EXPECT_EQ(cache.get_dirty_count(), 4U);
+  EXPECT_EQ(bus->get_statistics().transfers, 0U);
+
+  EXPECT_EQ(cache.flush(handler), 4U);
+  const auto statistics = bus->get_statistics();
+  EXPECT_EQ(statistics.transfers, 1U);
+  EXPECT_EQ(statistics.messages, 2U);
+
+  const auto & registers = device->get_registers();
+  EXPECT_EQ(registers[0x10], 0x01);
+  EXPECT_EQ(registers[0x11], 0xA2);
+  EXPECT_EQ(registers[0x12], 0x03);
+  EXPECT_EQ(registers[0x30], 0x04);
+  EXPECT_EQ(cache.flush(handler), 0U);
+}
+
+TEST_F(RegisterCacheTest, FailedFlushKeepsRegistersStaged)
+{
+  cache.stage(0x10, 0x01);
+  bus->detach_device(DEVICE_ADDRESS);
+  EXPECT_THROW(cache.flush(handler), std::exception);
+  EXPECT_EQ(cache.get_dirty_count(), 1U);
+
+  bus->attach_device(DEVICE_ADDRESS, device);
+  EXPECT_EQ(cache.flush(handler), 1U);
+  EXPECT_EQ(device->get_registers()[0x10], 0x01);
+}
+
+}  // namespace ros2_i2ccpp
@@ -0,0 +1,183 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <set>
+
+#include "ros2_i2ccpp/async_engine.hpp"
+#include "ros2_i2ccpp/i2c_handler.hpp"
+#include "ros2_i2ccpp/retry_policy.hpp"
+#include "ros2_i2ccpp/transaction.hpp"
+#include "ros2_i2ccpp/backend/simulated_i2c_backend.hpp"
+#include "simulated_bus_fixture.hpp"
+
+namespace ros2_i2ccpp
+{
+
+namespace
+{
+
+// more messages than fit in a single transfer
+constexpr uint32_t MESSAGE_COUNT = I2CConstants::I2C_TRANSACTION_IOCTL_MAX_MSGS + 8;
+
+/**
+ * Device that NAKs its address on the given STARTs, counting from 1, and counts the STARTs.
+ */
+class FlakyDevice : public SimulatedI2CDevice {
+public:
+  explicit FlakyDevice(std::set<uint32_t> naks_)
+  : naks(std::move(naks_)) {}
+
+  bool on_start(bool read) override
+  {
+    starts++;
+    if (naks.count(starts) > 0) {
+      return false;
+    }
+    return SimulatedI2CDevice::on_start(read);
+  }
+
+  uint32_t starts{0};
+
+private:
+  std::set<uint32_t> naks;
+};
+
+I2CRetryPolicy make_policy(uint32_t max_attempts)
+{
+  I2CRetryPolicy policy;
+  policy.max_attempts = max_attempts;
+  policy.initial_backoff = std::chrono::microseconds{1};
+  policy.max_backoff = std::chrono::microseconds{1};
+  return policy;
+}
+
+class RetryPolicyTest : public SimulatedHandlerTest {
+protected:
+  // replaces the device with one that NAKs the given STARTs
+  void attach(std::set<uint32_t> naks)
+  {
+    flaky_device = std::make_shared<FlakyDevice>(std::move(naks));
+    fill_with_addresses(*flaky_device);
+    bus->attach_device(DEVICE_ADDRESS, flaky_device);
+  }
+
+  std::shared_ptr<FlakyDevice> flaky_device;
+};
+
+}  // namespace
+
+TEST_F(RetryPolicyTest, RetriesNaks)
+{
+  attach({1, 2});
+  uint8_t value = 0;
+  I2CTransactionBuilder builder{DEVICE_ADDRESS};
+  builder.add_read(value);
+
+  EXPECT_FALSE(handler.try_apply_transaction(builder.getTransaction(), make_policy(2)));
+  EXPECT_EQ(flaky_device->starts, 2U);
+
+  builder.add_read(value);
+  EXPECT_TRUE(handler.try_apply_transaction(builder.getTransaction(), make_policy(2)));
+  EXPECT_EQ(flaky_device->starts, 3U);
+}
+
+TEST_F(RetryPolicyTest, DoesNotRetryMisuse)
+{
+  attach({});
+  std::array<i2c_msg, MESSAGE_COUNT> messages{};
+  std::array<uint8_t, MESSAGE_COUNT> values{};
+  for (uint32_t i = 0; i < MESSAGE_COUNT; i++) {
+    messages[i] = i2c_msg{DEVICE_ADDRESS, I2CMessageFlags::M_RD, 1, &values[i]};
+  }
+
+  // too long for a single transfer without chunking
+  const auto result = handler.try_apply_messages(messages.data(), MESSAGE_COUNT, false,
+      make_policy(3));
+  EXPECT_EQ(result.error(), std::errc::message_size);
+  EXPECT_EQ(bus->get_statistics().transfers, 0U);
+}
+
+TEST_F(RetryPolicyTest, ChunkedMessagesResumeAtTheFailedChunk)
+{
+  // the first message of the second chunk is NAKed once
+  attach({I2CConstants::I2C_TRANSACTION_IOCTL_MAX_MSGS + 1});
+  std::array<i2c_msg, MESSAGE_COUNT> messages{};
+  std::array<uint8_t, MESSAGE_COUNT> values{};
+  for (uint32_t i = 0; i < MESSAGE_COUNT; i++) {
+    messages[i] = i2c_msg{DEVICE_ADDRESS, I2CMessageFlags::M_RD, 1, &values[i]};
+  }
+
+  ASSERT_TRUE(handler.try_apply_messages(messages.data(), MESSAGE_COUNT, true, make_policy(2)));
+  EXPECT_EQ(flaky_device->starts, MESSAGE_COUNT + 1);
+  EXPECT_EQ(bus->get_statistics().transfers, 3U);
+
+  // the device pointer moved once per byte read, so nothing was read twice
+  for (uint32_t i = 0; i < MESSAGE_COUNT; i++) {
+    EXPECT_EQ(values[i], i);
+  }
+}
+
+TEST_F(RetryPolicyTest, ChunkedTransactionResumesAtTheFailedChunk)
+{
+  attach({I2CConstants::I2C_TRANSACTION_IOCTL_MAX_MSGS + 1});
+  std::array<uint8_t, MESSAGE_COUNT> values{};
+  I2CTransactionBuilder builder{DEVICE_ADDRESS};
+  builder.enable_chunking();
+  for (auto & value : values) {
+    builder.add_read(value);
+  }
+
+  auto prepared = builder.prepare();
+  ASSERT_TRUE(handler.try_apply_transaction(prepared, make_policy(2)));
+  EXPECT_EQ(flaky_device->starts, MESSAGE_COUNT + 1);
+  for (uint32_t i = 0; i < MESSAGE_COUNT; i++) {
+    EXPECT_EQ(values[i], i);
+  }
+
+  // the next execution starts over
+  ASSERT_TRUE(handler.try_apply_transaction(prepared, make_policy(2)));
+  EXPECT_EQ(flaky_device->starts, 2 * MESSAGE_COUNT + 1);
+  EXPECT_EQ(values[0], MESSAGE_COUNT);
+}
+
+TEST_F(RetryPolicyTest, EngineMakesASingleAttemptUnlessToldOtherwise)
+{
+  attach({1, 2});
+  I2CAsyncEngine engine{std::make_unique<SimulatedI2CBackend>(bus)};
+  for (uint8_t priority = 0; priority < I2CPriorityClass::PRIORITY_CLASS_COUNT; priority++) {
+    const auto policy = engine.get_retry_policy(static_cast<I2CPriorityClass>(priority));
+    EXPECT_EQ(policy.max_attempts, 1U);
+    EXPECT_EQ(policy.adapter_retries, I2CRetryPolicy::DRIVER_DEFAULT_RETRIES);
+    EXPECT_EQ(policy.adapter_timeout.count(), 0);
+  }
+
+  // writes are not repeated behind the caller's back
+  const uint8_t value = 0x5A;
+  I2CTransactionBuilder builder{DEVICE_ADDRESS};
+  builder.set_offset_format(I2CRegisterOffsetFormat::OFFSET_8BIT).add_write(uint16_t{0x30}, value);
+  auto future = engine.submit(builder.getTransaction());
+  ASSERT_EQ(future.wait_for(std::chrono::seconds{5}), std::future_status::ready);
+  EXPECT_THROW(future.get(), std::exception);
+  EXPECT_EQ(flaky_device->starts, 1U);
+
+  engine.set_retry_policy(I2CPriorityClass::PRIORITY_NORMAL,
+    I2CRetryPolicy::for_priority(I2CPriorityClass::PRIORITY_NORMAL));
+  builder.add_write(uint16_t{0x30}, value);
+  future = engine.submit(builder.getTransaction());
+  ASSERT_EQ(future.wait_for(std::chrono::seconds{5}), std::future_status::ready);
+  EXPECT_NO_THROW(future.get());
+  EXPECT_EQ(flaky_device->starts, 3U);
+  EXPECT_EQ(flaky_device->get_registers()[0x30], 0x5A);
+}
+
+}  // namespace ros2_i2ccpp
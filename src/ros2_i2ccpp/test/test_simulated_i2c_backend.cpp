@@ -0,0 +1,154 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+
+#include "ros2_i2ccpp/constants.hpp"
+#include "ros2_i2ccpp/backend/simulated_i2c_backend.hpp"
+#include "simulated_bus_fixture.hpp"
+
+namespace ros2_i2ccpp
+{
+
+namespace
+{
+
+class SimulatedI2CBackendTest : public SimulatedBusTest {
+protected:
+  void SetUp() override
+  {
+    SimulatedBusTest::SetUp();
+    ASSERT_EQ(backend.open("/dev/i2c-sim"), 0);
+  }
+
+  // fills registers from 0x20 on with a block of count bytes, preceded by its length
+  void set_block(uint8_t count)
+  {
+    auto & registers = device->get_registers();
+    registers[0x20] = count;
+    for (uint8_t i = 0; i < count; i++) {
+      registers[0x21 + i] = static_cast<uint8_t>(0xA0 + i);
+    }
+  }
+
+  SimulatedI2CBackend backend{bus};
+};
+
+}  // namespace
+
+TEST_F(SimulatedI2CBackendTest, WritesAndReadsRegisters)
+{
+  std::array<uint8_t, 4> write{0x10, 1, 2, 3};
+  i2c_msg write_message{DEVICE_ADDRESS, 0, 4, write.data()};
+  ASSERT_GE(backend.transfer(&write_message, 1), 0);
+
+  uint8_t offset = 0x10;
+  std::array<uint8_t, 3> read{};
+  std::array<i2c_msg, 2> messages{
+    i2c_msg{DEVICE_ADDRESS, 0, 1, &offset},
+    i2c_msg{DEVICE_ADDRESS, I2CMessageFlags::M_RD, 3, read.data()}};
+  ASSERT_GE(backend.transfer(messages.data(), 2), 0);
+  EXPECT_EQ(read, (std::array<uint8_t, 3>{1, 2, 3}));
+
+  const auto statistics = bus->get_statistics();
+  EXPECT_EQ(statistics.transfers, 2U);
+  EXPECT_EQ(statistics.bytes_written, 5U);
+  EXPECT_EQ(statistics.bytes_read, 3U);
+}
+
+TEST_F(SimulatedI2CBackendTest, NaksAbsentDevice)
+{
+  uint8_t byte = 0;
+  i2c_msg message{0x51, I2CMessageFlags::M_RD, 1, &byte};
+  EXPECT_LT(backend.transfer(&message, 1), 0);
+  EXPECT_EQ(errno, ENXIO);
+  EXPECT_EQ(bus->get_statistics().naks, 1U);
+}
+
+TEST_F(SimulatedI2CBackendTest, RejectsEmptyTransfers)
+{
+  EXPECT_LT(backend.transfer(nullptr, 0), 0);
+  EXPECT_EQ(errno, EINVAL);
+}
+
+TEST_F(SimulatedI2CBackendTest, BlockReadLeavesMessageUntouched)
+{
+  set_block(4);
+  uint8_t offset = 0x20;
+  std::array<uint8_t, I2C_SMBUS_BLOCK_MAX + 1> block{};
+
+  // the message array is reused, as prepared transactions and retries do
+  std::array<i2c_msg, 2> messages{
+    i2c_msg{DEVICE_ADDRESS, 0, 1, &offset},
+    i2c_msg{DEVICE_ADDRESS, I2CMessageFlags::M_RD | I2CMessageFlags::M_RECV_LEN,
+      I2C_SMBUS_BLOCK_MAX + 1, block.data()}};
+  for (int run = 0; run < 3; run++) {
+    block.fill(0);
+    block[0] = 1;
+    ASSERT_GE(backend.transfer(messages.data(), 2), 0);
+    EXPECT_EQ(messages[1].len, I2C_SMBUS_BLOCK_MAX + 1);
+    EXPECT_EQ(block[0], 4);
+    EXPECT_EQ(block[1], 0xA0);
+    EXPECT_EQ(block[4], 0xA3);
+    EXPECT_EQ(block[5], 0);
+  }
+  EXPECT_EQ(bus->get_statistics().bytes_read, 3U * 5U);
+}
+
+TEST_F(SimulatedI2CBackendTest, BlockReadReadsExtraBytes)
+{
+  // with PEC, i2c-dev is told to read a byte past the block
+  set_block(2);
+  device->get_registers()[0x23] = 0x5A;
+  uint8_t offset = 0x20;
+  std::array<uint8_t, I2C_SMBUS_BLOCK_MAX + 2> block{2};
+  std::array<i2c_msg, 2> messages{
+    i2c_msg{DEVICE_ADDRESS, 0, 1, &offset},
+    i2c_msg{DEVICE_ADDRESS, I2CMessageFlags::M_RD | I2CMessageFlags::M_RECV_LEN,
+      I2C_SMBUS_BLOCK_MAX + 2, block.data()}};
+  ASSERT_GE(backend.transfer(messages.data(), 2), 0);
+  EXPECT_EQ(block[0], 2);
+  EXPECT_EQ(block[3], 0x5A);
+  EXPECT_EQ(device->get_register_pointer(), 0x24U);
+
+  // only the bytes received take bus time
+  i2c_msg received[2] = {messages[0], messages[1]};
+  received[1].len = 4;
+  EXPECT_EQ(bus->get_statistics().busy_time, bus->get_transfer_time(received, 2));
+}
+
+TEST_F(SimulatedI2CBackendTest, BlockReadFollowsI2CDevChecks)
+{
+  set_block(4);
+  std::array<uint8_t, I2C_SMBUS_BLOCK_MAX + 1> block{};
+  i2c_msg message{DEVICE_ADDRESS, I2CMessageFlags::M_RD | I2CMessageFlags::M_RECV_LEN,
+    I2C_SMBUS_BLOCK_MAX + 1, block.data()};
+
+  // no extra byte count
+  block[0] = 0;
+  EXPECT_LT(backend.transfer(&message, 1), 0);
+  EXPECT_EQ(errno, EINVAL);
+
+  // buffer too short for the largest block
+  block[0] = 1;
+  message.len = 1;
+  EXPECT_LT(backend.transfer(&message, 1), 0);
+  EXPECT_EQ(errno, EINVAL);
+
+  // not a read
+  message.len = I2C_SMBUS_BLOCK_MAX + 1;
+  message.flags = I2CMessageFlags::M_RECV_LEN;
+  EXPECT_LT(backend.transfer(&message, 1), 0);
+  EXPECT_EQ(errno, EINVAL);
+
+  EXPECT_EQ(bus->get_statistics().transfers, 0U);
+}
+
+}  // namespace ros2_i2ccpp
@@ -0,0 +1,172 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+extern "C"
+{
+#include <linux/i2c-dev.h>
+}
+
+#include "ros2_i2ccpp/constants.hpp"
+#include "ros2_i2ccpp/transaction.hpp"
+#include "ros2_i2ccpp/backend/simulated_i2c_backend.hpp"
+#include "ros2_i2ccpp/impl/i2c_handler_impl.hpp"
+#include "ros2_i2ccpp/impl/smbus_transfer.hpp"
+#include "simulated_bus_fixture.hpp"
+
+namespace ros2_i2ccpp
+{
+
+namespace
+{
+
+constexpr uint8_t WRITE_ADDRESS = DEVICE_ADDRESS << 1;
+constexpr uint8_t READ_ADDRESS = WRITE_ADDRESS | 1;
+
+class SMBusTransferTest : public SimulatedBusTest {
+protected:
+  void SetUp() override
+  {
+    SimulatedBusTest::SetUp();
+    handler.set_addressing_mode(I2CAddressingMode::ADDRESSING_PER_MESSAGE);
+  }
+
+  // fills the registers from the given one on with a block of count bytes, preceded by its
+  // length, and returns the PEC of reading it with the given command
+  uint8_t set_block(uint8_t register_address, uint8_t command, uint8_t count)
+  {
+    auto & registers = device->get_registers();
+    std::vector<uint8_t> frame{WRITE_ADDRESS, command, READ_ADDRESS, count};
+    registers[register_address] = count;
+    for (uint8_t i = 0; i < count; i++) {
+      registers[register_address + 1 + i] = static_cast<uint8_t>(0xA0 + i);
+      frame.push_back(static_cast<uint8_t>(0xA0 + i));
+    }
+    return smbus_pec(0, frame.data(), static_cast<uint32_t>(frame.size()));
+  }
+
+  I2CHandlerImpl handler{DEVICE_ADDRESS, std::make_unique<SimulatedI2CBackend>(bus)};
+};
+
+}  // namespace
+
+TEST(SMBusTransfer, EncodesBlockReadsForI2CDev)
+{
+  for (const auto size : {I2C_SMBUS_BLOCK_DATA, I2C_SMBUS_BLOCK_PROC_CALL}) {
+    for (const bool pec : {false, true}) {
+      i2c_smbus_data data{};
+      data.block[0] = 1;
+      SMBusTransfer transfer;
+      ASSERT_EQ(transfer.encode(DEVICE_ADDRESS, 0, I2C_SMBUS_READ, 0x20, size, &data, pec), 0);
+      ASSERT_EQ(transfer.get_message_count(), 2U);
+
+      // buf[0] counts the bytes read besides the block, and the buffer fits the largest block
+      const auto & message = transfer.get_messages()[1];
+      EXPECT_EQ(message.flags, I2CMessageFlags::M_RD | I2CMessageFlags::M_RECV_LEN);
+      EXPECT_EQ(message.buf[0], pec ? 2 : 1);
+      EXPECT_EQ(message.len, I2C_SMBUS_BLOCK_MAX + message.buf[0]);
+    }
+  }
+}
+
+TEST(SMBusTransfer, AppendsPECToWrites)
+{
+  i2c_smbus_data data{};
+  data.word = 0x1234;
+  SMBusTransfer transfer;
+  ASSERT_EQ(transfer.encode(DEVICE_ADDRESS, 0, I2C_SMBUS_WRITE, 0x20, I2C_SMBUS_WORD_DATA, &data,
+    true), 0);
+  ASSERT_EQ(transfer.get_message_count(), 1U);
+
+  const auto & message = transfer.get_messages()[0];
+  const uint8_t frame[] = {WRITE_ADDRESS, 0x20, 0x34, 0x12};
+  ASSERT_EQ(message.len, 4U);
+  EXPECT_EQ(message.buf[3], smbus_pec(0, frame, sizeof(frame)));
+}
+
+TEST(SMBusTransfer, ComputesTheSMBusCRC)
+{
+  // CRC-8 check value of "123456789"
+  const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  EXPECT_EQ(smbus_pec(0, check, sizeof(check)), 0xF4);
+}
+
+TEST_F(SMBusTransferTest, WordsRoundTrip)
+{
+  handler.write_word(0x10, 0xBEEF);
+  EXPECT_EQ(device->get_registers()[0x10], 0xEF);
+  EXPECT_EQ(device->get_registers()[0x11], 0xBE);
+  EXPECT_EQ(handler.read_word(0x10), 0xBEEF);
+}
+
+TEST_F(SMBusTransferTest, BlocksRoundTrip)
+{
+  handler.write_block_data(0x10, {1, 2, 3});
+  const auto & registers = device->get_registers();
+  EXPECT_EQ(registers[0x10], 3);
+  EXPECT_EQ(registers[0x13], 3);
+
+  EXPECT_EQ(handler.read_block_data(0x10), (std::vector<uint8_t>{1, 2, 3}));
+
+  // the same message can be reused, as the kernel does not write back its length
+  set_block(0x20, 0x20, I2C_SMBUS_BLOCK_MAX);
+  I2CSMBusBlock block;
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(handler.read_block_data(0x20, block), I2C_SMBUS_BLOCK_MAX);
+    EXPECT_EQ(block.data[0], 0xA0);
+    EXPECT_EQ(block.data[I2C_SMBUS_BLOCK_MAX - 1], 0xA0 + I2C_SMBUS_BLOCK_MAX - 1);
+  }
+}
+
+TEST_F(SMBusTransferTest, BlockProcessCallReadsTheReply)
+{
+  // the device pointer moves past the written block, the reply is read from there
+  set_block(0x14, 0x10, 2);
+  const uint8_t request[] = {7, 8, 9};
+  I2CSMBusBlock reply;
+  ASSERT_EQ(handler.block_process_call(0x10, request, sizeof(request), reply), 2);
+  EXPECT_EQ(reply.data[0], 0xA0);
+  EXPECT_EQ(reply.data[1], 0xA1);
+  EXPECT_EQ(device->get_registers()[0x11], 7);
+}
+
+TEST_F(SMBusTransferTest, BlockReadChecksPEC)
+{
+  handler.set_pec(true);
+  auto & registers = device->get_registers();
+  const auto pec = set_block(0x20, 0x20, 4);
+  registers[0x25] = pec;
+
+  I2CSMBusBlock block;
+  ASSERT_EQ(handler.read_block_data(0x20, block), 4);
+  EXPECT_EQ(block.data[3], 0xA3);
+
+  registers[0x25] = static_cast<uint8_t>(pec ^ 0xFF);
+  const auto result = handler.try_read_block_data(0x20, block);
+  ASSERT_FALSE(result);
+  EXPECT_EQ(result.error(), std::errc::bad_message);
+}
+
+TEST_F(SMBusTransferTest, WordReadChecksPEC)
+{
+  handler.set_pec(true);
+  auto & registers = device->get_registers();
+  registers[0x30] = 0x34;
+  registers[0x31] = 0x12;
+  const uint8_t frame[] = {WRITE_ADDRESS, 0x30, READ_ADDRESS, 0x34, 0x12};
+  registers[0x32] = smbus_pec(0, frame, sizeof(frame));
+  EXPECT_EQ(handler.read_word(0x30), 0x1234);
+
+  registers[0x32] ^= 0x01;
+  EXPECT_EQ(handler.try_read_word(0x30).error(), std::errc::bad_message);
+}
+
+}  // namespace ros2_i2ccpp
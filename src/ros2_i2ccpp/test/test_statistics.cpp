@@ -0,0 +1,178 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "ros2_i2ccpp/statistics.hpp"
+#include "ros2_i2ccpp/transaction.hpp"
+#include "simulated_bus_fixture.hpp"
+
+namespace ros2_i2ccpp
+{
+
+namespace
+{
+
+using std::chrono::nanoseconds;
+
+using I2CStatisticsTest = SimulatedHandlerTest;
+
+}  // namespace
+
+TEST(LatencyHistogram, BucketsCoverEveryValueOnce)
+{
+  // every bucket starts right after the previous one and holds its whole range
+  for (std::size_t bucket = 0; bucket + 1 < I2CLatencyHistogram::BUCKET_COUNT; bucket++) {
+    const auto start = I2CLatencyHistogram::get_bucket_start(bucket);
+    const auto end = I2CLatencyHistogram::get_bucket_start(bucket + 1);
+    ASSERT_LT(start, end) << "bucket " << bucket;
+    ASSERT_EQ(I2CLatencyHistogram::get_bucket(start), bucket);
+    ASSERT_EQ(I2CLatencyHistogram::get_bucket(end - 1), bucket);
+
+    // within 12.5% of the values they hold
+    ASSERT_LE(8 * (end - 1 - start), start) << "bucket " << bucket;
+  }
+
+  EXPECT_EQ(I2CLatencyHistogram::get_bucket(0), 0U);
+  EXPECT_EQ(I2CLatencyHistogram::get_bucket(7), 7U);
+  EXPECT_EQ(I2CLatencyHistogram::get_bucket(8), 8U);
+  EXPECT_EQ(I2CLatencyHistogram::get_bucket(16), 16U);
+  EXPECT_EQ(I2CLatencyHistogram::get_bucket(31), 23U);
+  EXPECT_EQ(I2CLatencyHistogram::get_bucket(
+      uint64_t{1} << I2CLatencyHistogram::MAX_EXPONENT), I2CLatencyHistogram::BUCKET_COUNT - 1);
+  EXPECT_EQ(I2CLatencyHistogram::get_bucket(UINT64_MAX), I2CLatencyHistogram::BUCKET_COUNT - 1);
+}
+
+TEST(LatencyHistogram, PercentilesStayWithinBucketPrecision)
+{
+  I2CLatencyHistogram histogram;
+  EXPECT_EQ(histogram.get_percentile(50.0), nanoseconds{0});
+  EXPECT_EQ(histogram.get_min(), nanoseconds{0});
+
+  // 1 us to 1 ms, one sample each
+  for (int64_t value = 1; value <= 1000; value++) {
+    histogram.record(std::chrono::microseconds{value});
+  }
+  EXPECT_EQ(histogram.get_count(), 1000U);
+  EXPECT_EQ(histogram.get_min(), std::chrono::microseconds{1});
+  EXPECT_EQ(histogram.get_max(), std::chrono::microseconds{1000});
+  EXPECT_EQ(histogram.get_mean(), nanoseconds{500500});
+
+  for (const double percentile : {1.0, 25.0, 50.0, 90.0, 99.0, 99.9}) {
+    const auto expected = percentile * 10.0 * 1000.0;
+    const auto value = static_cast<double>(histogram.get_percentile(percentile).count());
+    EXPECT_NEAR(value, expected, expected / 8.0) << "p" << percentile;
+  }
+
+  // the extremes never leave the range of the samples
+  EXPECT_EQ(histogram.get_percentile(0.0), std::chrono::microseconds{1});
+  EXPECT_EQ(histogram.get_percentile(100.0), std::chrono::microseconds{1000});
+  EXPECT_EQ(histogram.get_percentile(150.0), std::chrono::microseconds{1000});
+}
+
+TEST(LatencyHistogram, MergeAddsTheSamples)
+{
+  I2CLatencyHistogram low;
+  I2CLatencyHistogram high;
+  I2CLatencyHistogram empty;
+  for (int i = 0; i < 3; i++) {
+    low.record(nanoseconds{100});
+    high.record(nanoseconds{10000});
+  }
+
+  low.merge(high);
+  low.merge(empty);
+  EXPECT_EQ(low.get_count(), 6U);
+  EXPECT_EQ(low.get_min(), nanoseconds{100});
+  EXPECT_EQ(low.get_max(), nanoseconds{10000});
+  EXPECT_EQ(low.get_mean(), nanoseconds{5050});
+  EXPECT_EQ(low.get_buckets()[I2CLatencyHistogram::get_bucket(100)], 3U);
+  EXPECT_EQ(low.get_buckets()[I2CLatencyHistogram::get_bucket(10000)], 3U);
+}
+
+TEST(StatisticsRecorder, MergesTheShardsOfEveryThread)
+{
+  constexpr int THREAD_COUNT = 4;
+  constexpr int TRANSFER_COUNT = 10000;
+
+  I2CStatisticsRecorder recorder;
+  std::array<uint8_t, 4> buffer{};
+
+  // each thread talks to its own device, and reads the statistics while the others record
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < THREAD_COUNT; thread++) {
+    threads.emplace_back([&recorder, &buffer, thread] {
+        const auto address = static_cast<uint16_t>(0x50 + thread);
+        std::array<i2c_msg, 2> messages{
+          i2c_msg{address, 0, 1, buffer.data()},
+          i2c_msg{address, I2CMessageFlags::M_RD, 4, buffer.data()}};
+        for (int i = 0; i < TRANSFER_COUNT; i++) {
+          const int error = i % 100 == 0 ? ENXIO : 0;
+          recorder.record_transfer(messages.data(), 2, nanoseconds{1000 * (thread + 1)}, error);
+          recorder.record_lock_wait(nanoseconds{10});
+          if (i % 1000 == 0) {
+            static_cast<void>(recorder.get_statistics());
+          }
+        }
+      });
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+
+  const auto statistics = recorder.get_statistics();
+  EXPECT_EQ(statistics.transactions, THREAD_COUNT * TRANSFER_COUNT);
+  EXPECT_EQ(statistics.messages, 2U * THREAD_COUNT * TRANSFER_COUNT);
+  EXPECT_EQ(statistics.bytes_written, 1U * THREAD_COUNT * TRANSFER_COUNT);
+  EXPECT_EQ(statistics.bytes_read, 4U * THREAD_COUNT * TRANSFER_COUNT);
+  ASSERT_EQ(statistics.errors.size(), 1U);
+  EXPECT_EQ(statistics.errors.at(ENXIO), THREAD_COUNT * TRANSFER_COUNT / 100U);
+
+  EXPECT_EQ(statistics.transfer_time.get_count(), THREAD_COUNT * TRANSFER_COUNT);
+  EXPECT_EQ(statistics.transfer_time.get_min(), nanoseconds{1000});
+  EXPECT_EQ(statistics.transfer_time.get_max(), nanoseconds{1000 * THREAD_COUNT});
+  EXPECT_EQ(statistics.lock_wait_time.get_count(), THREAD_COUNT * TRANSFER_COUNT);
+
+  ASSERT_EQ(statistics.devices.size(), static_cast<std::size_t>(THREAD_COUNT));
+  for (int thread = 0; thread < THREAD_COUNT; thread++) {
+    const auto & device = statistics.devices.at(static_cast<uint16_t>(0x50 + thread));
+    EXPECT_EQ(device.transactions, TRANSFER_COUNT);
+    EXPECT_EQ(device.errors, TRANSFER_COUNT / 100U);
+    EXPECT_EQ(device.transfer_time.get_min(), nanoseconds{1000 * (thread + 1)});
+    EXPECT_EQ(device.transfer_time.get_max(), nanoseconds{1000 * (thread + 1)});
+  }
+}
+
+TEST_F(I2CStatisticsTest, HandlerCountsItsTransfers)
+{
+  handler.enable_statistics();
+  uint16_t value = 0;
+  I2CTransactionBuilder builder{DEVICE_ADDRESS};
+  builder.set_offset_format(I2CRegisterOffsetFormat::OFFSET_8BIT).add_read(0x10, value);
+  handler.apply_transaction(builder.getTransaction());
+
+  bus->detach_device(DEVICE_ADDRESS);
+  builder.add_read(0x10, value);
+  EXPECT_FALSE(handler.try_apply_transaction(builder.getTransaction()));
+
+  const auto statistics = handler.get_statistics();
+  EXPECT_EQ(statistics.transactions, 2U);
+  EXPECT_EQ(statistics.messages, 4U);
+  EXPECT_EQ(statistics.bytes_written, 2U);
+  EXPECT_EQ(statistics.bytes_read, 4U);
+  EXPECT_EQ(statistics.errors.at(ENXIO), 1U);
+  EXPECT_EQ(statistics.transfer_time.get_count(), 2U);
+  EXPECT_EQ(statistics.lock_wait_time.get_count(), 2U);
+  EXPECT_EQ(statistics.devices.at(DEVICE_ADDRESS).transactions, 2U);
+}
+
+}  // namespace ros2_i2ccpp
@@ -0,0 +1,107 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ros2_i2ccpp/exceptions.hpp"
+#include "ros2_i2ccpp/traffic_log.hpp"
+#include "ros2_i2ccpp/backend/recording_i2c_backend.hpp"
+#include "ros2_i2ccpp/backend/simulated_i2c_backend.hpp"
+#include "ros2_i2ccpp/impl/i2c_handler_impl.hpp"
+#include "simulated_bus_fixture.hpp"
+
+namespace ros2_i2ccpp
+{
+
+namespace
+{
+
+using exceptions::IllegalOperationException;
+
+constexpr uint8_t BLOCK_REGISTER = 0x20;
+constexpr uint8_t BLOCK_SIZE = 4;
+
+class TrafficLogTest : public SimulatedBusTest {
+protected:
+  void SetUp() override
+  {
+    SimulatedBusTest::SetUp();
+    fill_with_addresses(*device);
+    device->get_registers()[BLOCK_REGISTER] = BLOCK_SIZE;
+  }
+
+  // records a session of register, SMBus and block accesses, in both addressing modes
+  void record()
+  {
+    auto recorder = std::make_shared<I2CTrafficRecorder>(log_path);
+    I2CHandlerImpl handler{DEVICE_ADDRESS, std::make_unique<RecordingI2CBackend>(
+        std::make_unique<SimulatedI2CBackend>(bus), recorder)};
+    I2CSMBusBlock block;
+    for (const auto mode :
+      {I2CAddressingMode::ADDRESSING_SLAVE_IOCTL, I2CAddressingMode::ADDRESSING_PER_MESSAGE})
+    {
+      handler.set_addressing_mode(mode);
+      handler.write_word(0x10, 0xBEEF);
+      EXPECT_EQ(handler.read_word(0x10), 0xBEEF);
+      ASSERT_EQ(handler.read_block_data(BLOCK_REGISTER, block), BLOCK_SIZE);
+      EXPECT_EQ(block.data[BLOCK_SIZE - 1], BLOCK_REGISTER + BLOCK_SIZE);
+    }
+  }
+
+  const std::string log_path{::testing::TempDir() + "traffic_log.bin"};
+};
+
+}  // namespace
+
+TEST_F(TrafficLogTest, ReplaysWhatWasRecorded)
+{
+  record();
+
+  I2CTrafficLog log{log_path};
+  EXPECT_EQ(log.get_adapters(), std::vector<std::string>{"/dev/i2c-1"});
+
+  SimulatedI2CBackend backend{bus};
+  ASSERT_EQ(backend.open("/dev/i2c-1"), 0);
+  I2CTrafficReplayer replayer{log, backend};
+  I2CTrafficReplayOptions options;
+  options.speed = 0.0;
+  const auto result = replayer.replay(options);
+
+  // per message, the block read is a transfer with M_RECV_LEN, otherwise an SMBus call
+  EXPECT_EQ(result.transfers, 3U);
+  EXPECT_EQ(result.smbus_calls, 3U);
+  EXPECT_EQ(result.result_mismatches, 0U);
+  EXPECT_EQ(result.data_mismatches, 0U);
+  EXPECT_EQ(result.recorded_duration.get_count(), 6U);
+}
+
+TEST_F(TrafficLogTest, RejectsLogsOfAnotherByteOrder)
+{
+  record();
+
+  // swap the byte order mark, as a machine of the other byte order would have written it
+  uint32_t byte_order = __builtin_bswap32(I2CTrafficLogHeader::BYTE_ORDER_MARK);
+  {
+    std::fstream file{log_path, std::ios::in | std::ios::out | std::ios::binary};
+    file.seekp(offsetof(I2CTrafficLogHeader, byte_order));
+    file.write(reinterpret_cast<const char *>(&byte_order), sizeof(byte_order));
+  }
+  EXPECT_THROW(I2CTrafficLog{log_path}, IllegalOperationException);
+
+  {
+    std::ofstream file{log_path, std::ios::binary | std::ios::trunc};
+    file << std::string(sizeof(I2CTrafficLogHeader), 'x');
+  }
+  EXPECT_THROW(I2CTrafficLog{log_path}, IllegalOperationException);
+}
+
+}  // namespace ros2_i2ccpp
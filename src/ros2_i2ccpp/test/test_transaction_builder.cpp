@@ -0,0 +1,156 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ros2_i2ccpp/i2c_handler.hpp"
+#include "ros2_i2ccpp/transaction.hpp"
+#include "ros2_i2ccpp/backend/simulated_i2c_backend.hpp"
+#include "simulated_bus_fixture.hpp"
+
+namespace ros2_i2ccpp
+{
+
+namespace
+{
+
+// flags of the messages of a transaction, M_RD for reads and 0 for writes
+std::vector<uint16_t> get_flags(I2CTransaction & transaction)
+{
+  std::vector<uint16_t> flags;
+  for (const auto & segment : transaction.getSegments()) {
+    flags.push_back(segment->get_message_flags());
+  }
+  return flags;
+}
+
+class TransactionBuilderTest : public SimulatedHandlerTest {
+protected:
+  void SetUp() override
+  {
+    SimulatedHandlerTest::SetUp();
+    fill_with_addresses(*device);
+    builder.set_offset_format(I2CRegisterOffsetFormat::OFFSET_8BIT);
+  }
+
+  I2CTransactionBuilder builder{DEVICE_ADDRESS};
+};
+
+}  // namespace
+
+TEST_F(TransactionBuilderTest, RepeatedRegisterReadWritesItsOffsetAgain)
+{
+  std::array<uint8_t, 4> first{};
+  std::array<uint8_t, 4> second{};
+  builder.add_read(0x10, first).add_read(0x10, second);
+
+  auto transaction = builder.getTransaction();
+  EXPECT_EQ(get_flags(transaction),
+    (std::vector<uint16_t>{0, I2CMessageFlags::M_RD, 0, I2CMessageFlags::M_RD}));
+
+  handler.apply_transaction(std::move(transaction));
+  EXPECT_EQ(first, (std::array<uint8_t, 4>{0x10, 0x11, 0x12, 0x13}));
+  EXPECT_EQ(second, first);
+}
+
+TEST_F(TransactionBuilderTest, ContiguousRegisterReadsSkipTheOffset)
+{
+  std::array<uint8_t, 4> first{};
+  uint16_t second = 0;
+  builder.add_read(0x10, first).add_read(0x14, second);
+
+  auto transaction = builder.getTransaction();
+  EXPECT_EQ(get_flags(transaction),
+    (std::vector<uint16_t>{0, I2CMessageFlags::M_RD, I2CMessageFlags::M_RD}));
+
+  handler.apply_transaction(std::move(transaction));
+  EXPECT_EQ(first, (std::array<uint8_t, 4>{0x10, 0x11, 0x12, 0x13}));
+  EXPECT_EQ(second, 0x1514);
+}
+
+TEST_F(TransactionBuilderTest, InPlaceReadsShareTheOffsetLogic)
+{
+  std::array<uint8_t, 2> first{};
+  std::array<uint8_t, 2> second{};
+  std::array<uint8_t, 2> third{};
+  builder.add_read_in_place(0x20, first).add_read_in_place(0x22, second)
+  .add_read_in_place(0x20, third);
+
+  auto transaction = builder.getTransaction();
+  EXPECT_EQ(get_flags(transaction),
+    (std::vector<uint16_t>{0, I2CMessageFlags::M_RD, I2CMessageFlags::M_RD, 0,
+      I2CMessageFlags::M_RD}));
+
+  handler.apply_transaction(std::move(transaction));
+  EXPECT_EQ(first, (std::array<uint8_t, 2>{0x20, 0x21}));
+  EXPECT_EQ(second, (std::array<uint8_t, 2>{0x22, 0x23}));
+  EXPECT_EQ(third, first);
+}
+
+TEST_F(TransactionBuilderTest, RegisterWritesMergeIntoOneMessage)
+{
+  const uint8_t a = 0xA1;
+  const uint16_t b = 0xB3B2;
+  builder.add_write(uint16_t{0x30}, a).add_write(uint16_t{0x31}, b);
+
+  auto transaction = builder.getTransaction();
+  ASSERT_EQ(transaction.getSegments().size(), 1U);
+  EXPECT_EQ(transaction.getSegments()[0]->get_data_size(), 4U);
+
+  handler.apply_transaction(std::move(transaction));
+  const auto & registers = device->get_registers();
+  EXPECT_EQ(registers[0x30], 0xA1);
+  EXPECT_EQ(registers[0x31], 0xB2);
+  EXPECT_EQ(registers[0x32], 0xB3);
+}
+
+TEST_F(TransactionBuilderTest, ReadAfterWriteContinuesAtTheDevicePointer)
+{
+  const uint8_t value = 0x5A;
+  uint8_t next = 0;
+  builder.add_write(uint16_t{0x40}, value).add_read(0x41, next);
+
+  auto transaction = builder.getTransaction();
+  EXPECT_EQ(get_flags(transaction), (std::vector<uint16_t>{0, I2CMessageFlags::M_RD}));
+
+  handler.apply_transaction(std::move(transaction));
+  EXPECT_EQ(next, 0x41);
+}
+
+TEST_F(TransactionBuilderTest, PreparedSMBusBlockReadRunsRepeatedly)
+{
+  for (const bool pec : {false, true}) {
+    I2CSMBusBlock block;
+    builder.set_smbus_pec(pec).add_smbus_read_block(0x20, block);
+    auto prepared = builder.prepare();
+    const auto & message = prepared.get_messages()[1];
+    const uint16_t extra_bytes = pec ? 2 : 1;
+    ASSERT_EQ(message.len, I2CConstants::SMBUS_BLOCK_MAX + extra_bytes);
+
+    for (const uint8_t count : {4, 32, 1}) {
+      auto & registers = device->get_registers();
+      std::vector<uint8_t> frame{DEVICE_ADDRESS << 1, 0x20, (DEVICE_ADDRESS << 1) | 1, count};
+      registers[0x20] = count;
+      for (uint8_t i = 0; i < count; i++) {
+        registers[0x21 + i] = static_cast<uint8_t>(count + i);
+        frame.push_back(static_cast<uint8_t>(count + i));
+      }
+      registers[0x21 + count] = smbus_pec(0, frame.data(), static_cast<uint32_t>(frame.size()));
+
+      handler.apply_transaction(prepared);
+      EXPECT_EQ(message.len, I2CConstants::SMBUS_BLOCK_MAX + extra_bytes);
+      ASSERT_EQ(block.length, count);
+      EXPECT_EQ(block.data[0], count);
+      EXPECT_EQ(block.data[count - 1], count + count - 1);
+    }
+  }
+}
+
+}  // namespace ros2_i2ccpp
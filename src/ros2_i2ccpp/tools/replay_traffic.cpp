@@ -0,0 +1,109 @@
+// Copyright (c) 2024 jncfa
+//
+// This software is released under the MIT License.
+// https://opensource.org/licenses/MIT
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+
+#include "ros2_i2ccpp/traffic_log.hpp"
+#include "ros2_i2ccpp/backend/i2c_dev_backend.hpp"
+
+namespace
+{
+
+void print_usage(const char * program)
+{
+  std::fprintf(stderr,
+    "usage: %s LOG [--adapter /dev/i2c-N] [--adapter-id ID] [--speed FACTOR]\n"
+    "\n"
+    "Re-issue the traffic recorded in LOG against an I2C adapter.\n"
+    "  --adapter     adapter to replay on, the recorded path by default\n"
+    "  --adapter-id  only replay the records of this adapter of the log, the first by default\n"
+    "  --speed       pace factor, 1 keeps the recorded pace, 0 replays as fast as possible\n",
+    program);
+}
+
+double to_us(std::chrono::nanoseconds value)
+{
+  return static_cast<double>(value.count()) / 1e3;
+}
+
+void print_histogram(const char * name, const ros2_i2ccpp::I2CLatencyHistogram & histogram)
+{
+  std::printf("%-10s p50 %10.1f us  p99 %10.1f us  max %10.1f us\n", name,
+    to_us(histogram.get_percentile(50.0)), to_us(histogram.get_percentile(99.0)),
+    to_us(histogram.get_max()));
+}
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  std::string log_path;
+  std::string adapter_path;
+  ros2_i2ccpp::I2CTrafficReplayOptions options;
+  options.adapter = 0;
+
+  for (int i = 1; i < argc; i++) {
+    const auto has_value = i + 1 < argc;
+    if (std::strcmp(argv[i], "--adapter") == 0 && has_value) {
+      adapter_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--adapter-id") == 0 && has_value) {
+      options.adapter = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--speed") == 0 && has_value) {
+      options.speed = std::atof(argv[++i]);
+    } else if (argv[i][0] != '-' && log_path.empty()) {
+      log_path = argv[i];
+    } else {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (log_path.empty() || options.adapter < 0 || options.speed < 0.0) {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  try {
+    const ros2_i2ccpp::I2CTrafficLog log{log_path};
+    const auto adapters = log.get_adapters();
+    if (static_cast<std::size_t>(options.adapter) >= adapters.size()) {
+      std::fprintf(stderr, "%s has no adapter %d\n", log_path.c_str(), options.adapter);
+      return EXIT_FAILURE;
+    }
+    if (adapter_path.empty()) {
+      adapter_path = adapters[options.adapter];
+    }
+
+    ros2_i2ccpp::I2CDevBackend backend;
+    if (backend.open(adapter_path) < 0) {
+      std::perror(adapter_path.c_str());
+      return EXIT_FAILURE;
+    }
+
+    std::printf("replaying %s (%s) on %s at %gx\n", log_path.c_str(),
+      adapters[options.adapter].c_str(), adapter_path.c_str(), options.speed);
+    ros2_i2ccpp::I2CTrafficReplayer replayer{log, backend};
+    const auto result = replayer.replay(options);
+
+    std::printf("records %llu (transfers %llu, smbus %llu) in %.3f s\n",
+      static_cast<unsigned long long>(result.records),
+      static_cast<unsigned long long>(result.transfers),
+      static_cast<unsigned long long>(result.smbus_calls),
+      static_cast<double>(result.elapsed.count()) / 1e9);
+    print_histogram("recorded", result.recorded_duration);
+    print_histogram("replayed", result.replayed_duration);
+    print_histogram("lag", result.lag);
+    std::printf("result mismatches %llu, data mismatches %llu\n",
+      static_cast<unsigned long long>(result.result_mismatches),
+      static_cast<unsigned long long>(result.data_mismatches));
+    return result.result_mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  } catch (const std::exception & exception) {
+    std::fprintf(stderr, "%s\n", exception.what());
+    return EXIT_FAILURE;
+  }
+}